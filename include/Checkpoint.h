@@ -0,0 +1,133 @@
+/**
+ * @file
+ *
+ * Declaration of the CheckpointWriter and CheckpointReader classes
+ */
+
+#ifndef _CHECKPOINT_H
+#define _CHECKPOINT_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <stdexcept>
+#include <type_traits>
+
+class Flower;
+struct VisualStimulusInfo;
+struct PlantTypeConfig;
+
+
+/**
+ * The CheckpointWriter class accumulates the complete dynamic state of a model
+ * (see EvoBeeModel::saveCheckpoint()) and writes it to a checkpoint file.
+ *
+ * A checkpoint file starts with a magic string, a byte order marker and the
+ * format version, followed by the state written by each model component in a
+ * fixed order, and ends with an end marker. Values are stored in the native byte
+ * order of the machine that wrote the file.
+ *
+ * Pointers between model objects cannot be stored directly, so they are replaced
+ * by stable handles: a Flower is identified by its id, a PlantTypeConfig by its
+ * index in ModelParams::getPlantTypeConfigs(), and a VisualStimulusInfo by the
+ * vis-data table to which it belongs and its index in that table.
+ */
+class CheckpointWriter {
+
+public:
+    CheckpointWriter();
+
+    /**
+     * Append a value of a trivially copyable type
+     */
+    template<typename T>
+    void write(T val)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "CheckpointWriter::write requires a trivially copyable type");
+        char bytes[sizeof(T)];
+        std::memcpy(bytes, &val, sizeof(T));
+        m_Buf.append(bytes, sizeof(T));
+    }
+
+    void writeString(const std::string& str);
+
+    void writeFlowerHandle(const Flower* pFlower);
+
+    void writePlantTypeConfigHandle(const PlantTypeConfig* pPTC);
+
+    void writeVisDataHandle(const VisualStimulusInfo* pVSI);
+
+    /**
+     * Append the end marker and write the checkpoint to the specified file. The
+     * data is first written to a temporary file which is then renamed, so an
+     * existing checkpoint at the same path is never left partially overwritten.
+     */
+    void writeFile(const std::string& path);
+
+private:
+    std::string m_Buf;
+};
+
+
+/**
+ * The CheckpointReader class reads back a checkpoint file written by a
+ * CheckpointWriter. Values must be read in the same order in which they were
+ * written. A std::runtime_error is thrown if the file is invalid, truncated,
+ * or refers to objects that do not exist in the current model.
+ */
+class CheckpointReader {
+
+public:
+    /**
+     * Read the whole of the specified checkpoint file and check its header
+     */
+    CheckpointReader(const std::string& path);
+
+    template<typename T>
+    T read()
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "CheckpointReader::read requires a trivially copyable type");
+        need(sizeof(T));
+        T val;
+        std::memcpy(&val, m_Buf.data() + m_iPos, sizeof(T));
+        m_iPos += sizeof(T);
+        return val;
+    }
+
+    std::string readString();
+
+    /**
+     * Record that the specified flower is available for resolving flower handles.
+     * All flowers must be registered before any handles referring to them are read.
+     */
+    void registerFlower(Flower* pFlower);
+
+    Flower* readFlowerHandle();
+
+    const PlantTypeConfig* readPlantTypeConfigHandle();
+
+    const VisualStimulusInfo* readVisDataHandle();
+
+    /**
+     * Read a count of items that are expected to match a count in the current model,
+     * throwing an exception naming the items if it does not
+     */
+    void expectCount(std::size_t count, const char* itemName);
+
+    /**
+     * Check that all of the checkpoint data has been read
+     */
+    void finish();
+
+private:
+    void need(std::size_t numBytes) const;
+
+    std::string m_Buf;
+    std::size_t m_iPos;     ///< Offset of next value to read from m_Buf
+    std::unordered_map<unsigned int, Flower*> m_FlowerMap;  ///< Registered flowers, indexed by id
+};
+
+#endif /* _CHECKPOINT_H */
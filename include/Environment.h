@@ -10,7 +10,9 @@
 #include <vector>
 #include <memory>
 #include <cmath>
+#include <mutex>
 #include "Patch.h"
+#include "GenerationArena.h"
 #include "AbstractHive.h"
 #include "PlantTypeDistributionConfig.h"
 #include "Position.h"
@@ -22,6 +24,9 @@ using FlowerPtrVector = std::vector<Flower*>;
 
 class FloweringPlant;
 class EvoBeeModel;
+struct VisitedFlowerMemory;
+class CheckpointWriter;
+class CheckpointReader;
 
 
 /**
@@ -51,6 +56,43 @@ struct LocalDensityConstraint {
 };
 
 
+/**
+ * The FlowerSpatialIndex struct
+ * A flat, structure-of-arrays copy of the static per-flower data required by the
+ * neighbourhood searches (Environment::findNearestUnvisitedFlower and
+ * Environment::findRandomUnvisitedFlower). Entries are sorted by patch index, in the
+ * same order as the flowers are held in each Patch, and patchStart[i]..patchStart[i+1]
+ * gives the range of entries belonging to patch i. The index holds non-owning pointers
+ * to the flowers, so it must be rebuilt whenever plants are added to or removed from
+ * patches (i.e. at the start of each generation).
+ */
+struct FlowerSpatialIndex {
+
+    void clear();
+
+    std::vector<float>        x;          ///< x coordinate of each flower
+    std::vector<float>        y;          ///< y coordinate of each flower
+    std::vector<Flower*>      flowers;    ///< pointer to the Flower object itself
+    std::vector<int>          patchStart; ///< offset of first entry for each patch (size is numPatches+1)
+    std::vector<int>          patchFlowerDistance; ///< Chebyshev distance (in patches) from each patch to the
+                                                   ///<   nearest patch holding a flower
+};
+
+
+/**
+ * The GenerationBuffer struct
+ * Holds all of the plants of one generation, sorted by patch index (so that the plants
+ * on each patch form a contiguous range), together with the arena from which their
+ * flowers and stigma pollen are allocated. The Environment has two of these, which are
+ * used alternately by successive generations (see Environment::initialiseNewGeneration).
+ */
+struct GenerationBuffer {
+    GenerationArena arena;  ///< Storage for the flowers of the plants (declared first so that
+                            ///<   it outlives the plants when the buffer is destroyed)
+    PlantVector     plants; ///< All of the plants in the generation, in patch order
+};
+
+
 /**
  * The Environment class...
  */
@@ -161,7 +203,7 @@ public:
     /**
      * Search for flowers in the local patch and its 8 closest neighbours
      * (Moore neighbourhood), and return a pointer to the closest flower found
-     * that is not in the supplied list of excluded flowers, or nullptr if none found.
+     * that is not in the supplied set of excluded flowers, or nullptr if none found.
      * Optionally, a Pollinator may be supplied as the final argument
      * (pPollinator), which, if present, only considers flowers that the
      * Pollinator can detect (as determined by calling its isDetected(reflectanceInfo)
@@ -182,7 +224,7 @@ public:
      * current position will not be considered).
      */
     Flower* findNearestUnvisitedFlower(const fPos &fpos,
-        const std::vector<Flower*>& excludeVec,
+        const VisitedFlowerMemory& excludeSet,
         float fRadius = 1.0,
         bool excludeCurrentPos = true,
         Pollinator* pPollinator = nullptr);
@@ -190,7 +232,7 @@ public:
     /**
      * Search for flowers in the local patch and its 8 closest neighbours
      * (Moore neighbourhood), and return a pointer to a randomly selected found flower
-     * that is not in the supplied list of excluded flowers, or nullptr if none found.
+     * that is not in the supplied set of excluded flowers, or nullptr if none found.
      *
      * @param fRadius (default value = 1.0) specifies a maximum search radius.
      * If this is given a zero or negative value, then it is ignored, and all flowers
@@ -207,10 +249,19 @@ public:
      * current position will not be considered).
      */
     Flower* findRandomUnvisitedFlower(const fPos &fpos,
-        const std::vector<Flower*>& excludeVec,
+        const VisitedFlowerMemory& excludeSet,
         float fRadius = 1.0,
         bool excludeCurrentPos = true);
 
+    /**
+     * Returns the Chebyshev distance, in patches, from the patch containing the given
+     * position to the nearest patch that holds a flower (0 if the patch itself holds
+     * one). If there are no flowers at all, the value returned is larger than the
+     * distance between any two patches. Used by pollinators to tell when they are
+     * too far from any flower to find one (see Pollinator::countFlowerlessSteps()).
+     */
+    int getPatchFlowerDistance(const fPos& fpos) const;
+
     /*
      * Returns a random float position within the environment
      */
@@ -240,6 +291,14 @@ public:
      */
     float getPollinatedFracSpecies1() const;
 
+    /**
+     * Update the running count of pollinated plants of the given species.
+     * This is called by FloweringPlant::setPollinated whenever a plant's pollination
+     * status changes, and it allows getPollinatedFracAll() and getPollinatedFracSpecies1()
+     * to return their results without having to scan through all plants.
+     */
+    void updatePollinatedPlantCount(unsigned int speciesId, bool pollinated);
+
     /**
      * Add a pointer to a pollinator to the Environment's aggregate list of all
      * pollinators. This is called in the Hive constructor, and the individual
@@ -265,6 +324,18 @@ public:
      */
     FlowerPtrVector& getAllFlowerPtrVector();
 
+    /**
+     * Write the state of all plants, flowers and pollinators to a checkpoint
+     */
+    void saveState(CheckpointWriter& writer) const;
+
+    /**
+     * Replace all plants, and the state of all pollinators, with those saved in
+     * a checkpoint (see saveState()). The environment must have been constructed
+     * from the same configuration as the one that wrote the checkpoint.
+     */
+    void loadState(CheckpointReader& reader);
+
 
 private:
     void initialisePlants();     // private helper method used in constructor
@@ -274,9 +345,19 @@ private:
     void resetLocalDensityCounts();
     bool localDensityLimitReached(const iPos& newPatchPos) const;
     void incrementLocalDensityCount(const iPos& newPatchPos);
+    int  getLocalDensityConstraintIdx(const iPos& patchPos) const;
 
     void introduceRandomNewFlowerSpecies(std::vector<FloweringPlant>& newPlants);
 
+    // private methods for managing the storage of successive generations of plants
+    GenerationArena& getNextGenerationArena();
+    void installNewPlants();
+
+    void rebuildFlowerIndex();   // private helper method to refresh m_FlowerIndex
+    void buildPatchFlowerDistances(); // private helper method used by rebuildFlowerIndex()
+
+    void resetPlantCounts();     // private helper method to recalculate m_SpeciesPlantCounts etc.
+
     PatchVector   m_Patches;     ///< All patches are stored in a 1D vector for speed of access
     HivePtrVector m_Hives;       ///< Collection of all hives in the environment
     int           m_iNumPatches; ///< Num patches (stored for convenience)
@@ -296,10 +377,29 @@ private:
 
     bool          m_bFlowerPtrVectorInitialised; ///< Indicates whether m_AllFlowers is current
 
+    std::vector<unsigned int> m_SpeciesPlantCounts;      ///< Number of plants of each species (indexed by species id)
+    std::vector<unsigned int> m_SpeciesPollinatedCounts; ///< Number of pollinated plants of each species (indexed by species id)
+    unsigned int  m_iNumPlants;           ///< Total number of plants in the environment
+    unsigned int  m_iNumPollinatedPlants; ///< Total number of pollinated plants in the environment
+    std::mutex    m_PlantCountMutex;      ///< Guards the pollinated plant counts when pollinators are
+                                          ///<   stepped concurrently (see ParallelStepper)
+
+    FlowerSpatialIndex m_FlowerIndex; ///< Cell-sorted index of all flowers used by the
+                                      ///  neighbourhood search methods. This is rebuilt
+                                      ///  at the start of each generation.
+
+    GenerationBuffer m_GenerationBuffers[2]; ///< Plants of the current generation, and storage
+                                             ///  for those of the next (see installNewPlants())
+    int           m_iCurGenerationBuffer;    ///< Index in m_GenerationBuffers of current generation
+    PlantVector   m_NewPlants;   ///< Plants created for the next generation, in the order in which
+                                 ///  they were created (kept between generations to reuse its storage)
+
     std::vector<LocalDensityConstraint> m_LocalDensityConstraints; ///< List of local plant density
                                                                    /// constraints, as defined by those
                                                                    /// PlantTypeDistributions for which
                                                                    /// reproLocalDensityConstrained=true
+    std::vector<int> m_PatchLocalDensityConstraintIdx; ///< Index in m_LocalDensityConstraints of the constraint
+                                                       ///  that applies to each patch (or -1 if none)
     const EvoBeeModel* m_pModel;
 };
 
@@ -7,7 +7,7 @@
 #ifndef _EVOBEEEXPERIMENT_H
 #define _EVOBEEEXPERIMENT_H
 
-#include <thread>
+#include <string>
 #include "EvoBeeModel.h"
 #include "EventManager.h"
 #include "Logger.h"
@@ -36,6 +36,12 @@ public:
 
     void run();
 
+    /**
+     * Returns the path of the checkpoint file for the specified generation of
+     * the current run (see the checkpoint-period parameter)
+     */
+    static std::string getCheckpointPath(unsigned int gen);
+
     EvoBeeModel     m_Model;
     EventManager    m_EventManager;
     Logger          m_Logger;
@@ -45,12 +51,12 @@ private:
     bool            m_bVis;
     int             m_iVisUpdatePeriod;
     int             m_iLogUpdatePeriod;
-    std::thread     m_threadLog;
 
     // private helper functions
     void runStandardExperiment();
     void runMarkerPointSimilarityTest();
     void runMatchConfidenceTest();
+    void runParallelStepBenchmark();
     void callLoggerMethod(void (Logger::*pLoggerMethod)());
 };
 
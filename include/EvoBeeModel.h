@@ -8,7 +8,12 @@
 #define _EVOBEEMODEL_H
 
 #include <random>
+#include <memory>
+#include <string>
 #include "Environment.h"
+#include "RngEngine.h"
+#include "PollinatorStructs.h"
+#include "ParallelStepper.h"
 
 /**
  * The EvoBeeModel class ...
@@ -32,6 +37,26 @@ public:
     */
     void initialiseNewGeneration();
 
+    /**
+     * Write the complete dynamic state of the model (generation and step counters,
+     * all plants, flowers and pollinators, the RNG state and the id counters) to
+     * the specified checkpoint file
+     */
+    void saveCheckpoint(const std::string& path) const;
+
+    /**
+     * Restore the complete dynamic state of the model from a checkpoint file
+     * written by saveCheckpoint(). The model must have been constructed from the
+     * same configuration as the one that wrote the checkpoint. Continuing the
+     * run from the restored state gives exactly the same results as the
+     * original run would have done.
+     *
+     * If bRestoreRng is false, the RNG state stored in the checkpoint is skipped
+     * and the RNG carries on from its current state (as seeded by seedRng()), so
+     * the run continues from the restored state with a different random sequence.
+     */
+    void restoreCheckpoint(const std::string& path, bool bRestoreRng = true);
+
     /**
      * Get current generation number
      */
@@ -42,20 +67,44 @@ public:
      */
     unsigned int getStepNumber() const {return m_iStep;}
 
+    /**
+     * Get the number of pollinators that have not yet completed their foraging
+     * bout in the current generation. Once this reaches zero, further steps of
+     * the generation have no effect.
+     */
+    std::size_t getNumActivePollinators();
+
+    /**
+     * Get the counts of the foraging steps taken by all pollinators so far in the
+     * current generation. These are not stored in checkpoints, so they start
+     * again from zero after a checkpoint is restored.
+     */
+    const PollinatorStepCounts& getGenStepCounts() const {return m_GenStepCounts;}
+
     /**
      * Return a reference to the model's Environment object
      */
     Environment& getEnv() {return m_Env;}
 
+    /**
+     * Set the number of threads used to step the pollinators. A value of 0 selects
+     * the original serial stepping code; a value of 1 or more selects the tiled
+     * ParallelStepper (whose results are independent of the number of threads).
+     * If the pollinators cannot be stepped concurrently, a warning is printed and
+     * the serial code is used.
+     */
+    void setStepThreads(unsigned int numThreads);
+
     /**
      * Seed the model's RNG from the seed specified in ModelParams
      */
     static void seedRng();
 
     /**
-     * EvoBeeModel owns an RNG engine for use by all components in the model
+     * EvoBeeModel owns an RNG engine for use by all components in the model.
+     * Each thread has its own copy of the engine (see ParallelStepper).
      */
-    static std::mt19937 m_sRngEngine;
+    static thread_local RngEngine m_sRngEngine;
 
     static std::uniform_real_distribution<float> m_sDirectionDistrib;   ///< Uniform distrib 0.0--TWOPI
 
@@ -67,6 +116,15 @@ private:
     unsigned int    m_iGen;     ///< Current generation number
     unsigned int    m_iStep;    ///< Current step number within current generation
     Environment     m_Env;      ///< The model owns the one and only
+    std::unique_ptr<ParallelStepper> m_pParallelStepper; ///< Used for multi-threaded stepping
+                                                         ///<   (nullptr for serial stepping)
+    PollinatorPtrVector m_ActivePollinators; ///< Pollinators that have not yet completed their bout in
+                                             ///<   the current generation (shuffled in place each step)
+    bool            m_bActivePollinatorsStale; ///< Does m_ActivePollinators need to be rebuilt
+                                               ///<   from the environment before it is next used?
+    PollinatorStepCounts m_GenStepCounts; ///< Counts of the pollinator steps taken in the current generation
+
+    void refreshActivePollinators();
 
     static bool m_sbRngInitialised;
 };
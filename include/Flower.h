@@ -11,11 +11,12 @@
 #include "ReflectanceInfo.h"
 #include "Position.h"
 #include "PlantTypeConfig.h"
-#include "Pollen.h"
-
-using PollenVector = std::vector<Pollen>;
+#include "PollenStore.h"
 
 class FloweringPlant;
+struct FlowerStateRecord;
+class CheckpointWriter;
+class CheckpointReader;
 
 /**
  * The LandingInfo struct
@@ -43,6 +44,13 @@ public:
     Flower( FloweringPlant* pPlant, const Flower& parentFlower,
             const fPos& pos, const ReflectanceInfo& reflectance);
 
+    /**
+     * Constructor to restore a flower of the specified plant from a checkpoint
+     * (see saveState()). The flower's stigma pollen is restored separately by
+     * loadStigmaPollen().
+     */
+    Flower(FloweringPlant* pPlant, CheckpointReader& reader);
+
     // "Rule of 5" methods - https://en.wikipedia.org/wiki/Rule_of_three_(C%2B%2B_programming)
     Flower(const Flower& other);
     Flower(Flower&& other) noexcept;
@@ -66,6 +74,38 @@ public:
      */
     std::string getStateString() const;
 
+    /**
+     * Returns a record of the flower's current state for use in a log snapshot
+     */
+    FlowerStateRecord captureState() const;
+
+    /**
+     * Write the flower's dynamic state, apart from its stigma pollen, to a checkpoint
+     */
+    void saveState(CheckpointWriter& writer) const;
+
+    /**
+     * Write the flower's stigma pollen to a checkpoint. This is saved separately
+     * from the rest of the flower's state because the pollen refers to its source
+     * flowers, which must all have been restored before the pollen can be.
+     */
+    void saveStigmaPollen(CheckpointWriter& writer) const;
+
+    /**
+     * Restore the flower's stigma pollen from a checkpoint (see saveStigmaPollen())
+     */
+    void loadStigmaPollen(CheckpointReader& reader);
+
+    /**
+     * Returns the next available unique flower id (for checkpointing)
+     */
+    static unsigned int getNextFreeId() {return m_sNextFreeId;}
+
+    /**
+     * Set the next available unique flower id (when restoring from a checkpoint)
+     */
+    static void setNextFreeId(unsigned int id) {m_sNextFreeId = id;}
+
     /**
      *
      */
@@ -119,13 +159,13 @@ public:
      * store has been exceeded. It is the responsibility of the pollinator to
      * perform such a check after it has called this method.
      */
-    int transferAntherPollenToPollinator(PollenVector& pollinatorStore);
+    int transferAntherPollenToPollinator(PollenStore& pollinatorStore);
 
     /**
-     * Transfer some pollen grains from the specified pollinator's store
-     * to the flower's stigma, if possible. Whether of not we allow pollen
-     * from a different species to be deposited is determined by the flower's
-     * m_bPollenClogging flag. If any of the deposited pollen is from the same
+     * Transfer some pollen grains, chosen at random, from the specified
+     * pollinator's store to the flower's stigma, if possible. Whether of not we
+     * allow pollen from a different species to be deposited is determined by the
+     * flower's m_bPollenClogging flag. If any of the deposited pollen is from the same
      * species, the flower will be pollinated. If we are unable to transfer
      * as much pollen from the pollinator as requested (because of limited
      * capacity of the stigma), then the excess is simply removed from the
@@ -139,7 +179,7 @@ public:
      *
      * @return The number of grains transferred
      */
-    int transferPollenFromPollinator(PollenVector& pollinatorStore, int suggestedNum);
+    int transferPollenFromPollinator(PollenStore& pollinatorStore, int suggestedNum);
 
     /**
      * Respond to a pollinator's request for nectar. Provide the full amount
@@ -187,7 +227,8 @@ private:
     ReflectanceInfo m_Reflectance;      ///< Flower reflectance info
     bool            m_bPollinated;      ///< Is the flower pollinated?
     int             m_iAntherPollen;    ///< Amount of collectable pollen remaining
-    PollenVector    m_StigmaPollen;     ///< Collection of deposited Pollen grains on stigma
+    PollenVector    m_StigmaPollen;     ///< Collection of deposited Pollen grains on stigma (held inline
+                                        ///<   if few enough, else allocated from the flower's GenerationArena)
     int             m_iAvailableNectar; ///< Amount of nectar currently available for collection by pollinators
     float           m_fTemperature;     ///< Current temperature of flower
     LandingInfo     m_LandingInfo;      ///< Information about homo- and heterospecific landings on this flower
@@ -200,6 +241,13 @@ private:
     bool    m_bPollenCloggingPartial;
     const std::vector<unsigned int>& m_CloggingSpeciesVec;
 
+    /**
+     * The largest number of slots for pollen grains that are set aside on a stigma
+     * when its pollen first overflows the inline storage (the stigma can still hold
+     * more grains than this if its capacity allows, but its storage then has to grow)
+     */
+    static constexpr int m_sMaxInitialStigmaSlots = 16;
+
     /**
      * Record of next available unique ID number to be assigned to a new Flower
      */
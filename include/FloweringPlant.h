@@ -15,9 +15,21 @@
 #include "ReflectanceInfo.h"
 #include "Flower.h"
 #include "Position.h"
+#include "GenerationArena.h"
+#include "SmallVector.h"
+#include "evobeeConfig.h"
 
 
 class Patch;
+class CheckpointWriter;
+class CheckpointReader;
+
+/**
+ * Flowers of a plant. Plants with up to evobee_INLINE_FLOWERS flowers (set in
+ * CMakeLists.txt) store them inline, and larger ones are allocated from the arena
+ * of the plant's generation.
+ */
+using FlowerVector = SmallVector<Flower, evobee_INLINE_FLOWERS, ArenaAllocator<Flower>>;
 
 
 /**
@@ -27,14 +39,24 @@ class FloweringPlant {
 
 public:
     /**
-     * Constructor for creating a new plant at the beginning of a simulation
+     * Constructor for creating a new plant at the beginning of a simulation.
+     * The plant's flowers are allocated from the specified arena (as are those
+     * of the plants created by the other constructors).
      */
-    FloweringPlant(const PlantTypeConfig& typeConfig, const fPos& pos, Patch* pPatch);
+    FloweringPlant(const PlantTypeConfig& typeConfig, const fPos& pos, Patch* pPatch,
+                   GenerationArena& arena);
 
     /**
      * Constructor for creating an offspring plant from a pollinated parent plant
      */
-    FloweringPlant(const FloweringPlant* pParent, const fPos& pos, Patch* pPatch, bool mutate);
+    FloweringPlant(const FloweringPlant* pParent, const fPos& pos, Patch* pPatch, bool mutate,
+                   GenerationArena& arena);
+
+    /**
+     * Constructor for restoring a plant (and its flowers) from a checkpoint
+     * (see saveState())
+     */
+    FloweringPlant(CheckpointReader& reader, Patch* pPatch, GenerationArena& arena);
 
     // "Rule of 5" methods - https://en.wikipedia.org/wiki/Rule_of_three_(C%2B%2B_programming)
     FloweringPlant(const FloweringPlant& other);
@@ -43,6 +65,23 @@ public:
     FloweringPlant& operator= (const FloweringPlant& other);
     FloweringPlant& operator= (FloweringPlant&& other) noexcept;
 
+    /**
+     * Write the plant's dynamic state, including that of its flowers (apart from
+     * their stigma pollen, see Flower::saveStigmaPollen()), to a checkpoint
+     */
+    void saveState(CheckpointWriter& writer) const;
+
+    /**
+     * Write the static state of the FloweringPlant class (id counters and the
+     * species map) to a checkpoint
+     */
+    static void saveStaticState(CheckpointWriter& writer);
+
+    /**
+     * Restore the static state of the FloweringPlant class from a checkpoint
+     */
+    static void loadStaticState(CheckpointReader& reader);
+
     /**
      * Static method to register a species in the species map, given a species name.
      * If the name is not already in the map, then a new speciesId is assigned to it
@@ -108,7 +147,8 @@ public:
     /**
      * Return a reference to this plant's vector of flowers
      */
-    std::vector<Flower>& getFlowers() {return m_Flowers;}
+    FlowerVector& getFlowers() {return m_Flowers;}
+    const FlowerVector& getFlowers() const {return m_Flowers;}
 
     /**
      * Returns the distance between the plant and the specified point
@@ -150,8 +190,9 @@ public:
     static void initialiseRandomIntroMaps(int initNumSpeciesPerBin);
 
     /**
-     * A static method to construct the clogging map, which should be called once only,
-     * at the start of a run when all params have been read from the config file
+     * A static method to construct the clogging map (and the dense clogging matrix
+     * derived from it), which should be called once only, at the start of a run when
+     * all params have been read from the config file
      */
     static void constructCloggingMap(std::vector<PlantTypeConfig>& ptcs);
 
@@ -197,7 +238,7 @@ private:
     unsigned int            m_id;           ///< Unique ID number for this plant
     unsigned int            m_SpeciesId;    ///< ID number of the species of this plant
     fPos                    m_Position;
-    std::vector<Flower>     m_Flowers;
+    FlowerVector            m_Flowers;
     bool                    m_bHasLeaf;
     ReflectanceInfo         m_LeafReflectance;
     bool                    m_bPollinated;  ///< Have any of this plant's flowers been pollinated?
@@ -253,6 +294,27 @@ private:
      */
     static std::map<unsigned int, std::vector<unsigned int>> m_sCloggingMap;
 
+    /**
+     * A dense version of m_sCloggingMap used for fast lookups during the run. This is a
+     * row-major square bit matrix indexed by species id, where the entry at
+     * [pollenSpeciesId * m_sCloggingMatrixDim + flowerSpeciesId] is set if pollen of the
+     * first species clogs the stigmas of the second species.
+     */
+    static std::vector<bool> m_sCloggingMatrix;
+
+    /**
+     * The number of rows and columns in m_sCloggingMatrix. This is always greater than
+     * the largest species id registered so far.
+     */
+    static unsigned int m_sCloggingMatrixDim;
+
+    /**
+     * Ensure that m_sCloggingMatrix has a row and column for every species id below
+     * numSpeciesIds, growing it if necessary. Any existing entries are preserved, and
+     * new species do not clog, and are not clogged by, any other species.
+     */
+    static void growCloggingMatrix(unsigned int numSpeciesIds);
+
     /**
      * A flag to indicate the situation where pollen from all plant species clogs the stigmas of all
      * other species' flowers. This is calculated at the start of the run and is used for efficiency
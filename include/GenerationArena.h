@@ -0,0 +1,130 @@
+/**
+ * @file
+ *
+ * Declaration of the GenerationArena class and the ArenaAllocator class template
+ */
+
+#ifndef _GENERATIONARENA_H
+#define _GENERATIONARENA_H
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <cstddef>
+#include <type_traits>
+
+
+/**
+ * The GenerationArena class provides the storage for the flowers, and the stigma
+ * pollen, of one generation of plants (see Environment::initialiseNewGeneration()).
+ *
+ * Memory is handed out by bumping an offset through a contiguous block, and
+ * individual allocations are never freed. Instead, once all of the objects allocated
+ * from the arena have been destroyed, the whole arena is reset and its memory reused
+ * for a later generation. If a generation needs more memory than the arena holds, a
+ * further block is added, and when the arena is next reset, its blocks are merged into
+ * a single block large enough for everything that was allocated from them. So after
+ * the first few generations, an arena normally consists of a single block, and creating
+ * a new generation does not touch the heap at all.
+ *
+ * Allocation is thread-safe, as stigmas may be allocated their storage while
+ * pollinators are being stepped concurrently (see ParallelStepper).
+ */
+class GenerationArena {
+
+public:
+    GenerationArena();
+
+    GenerationArena(const GenerationArena&) = delete;
+    GenerationArena& operator=(const GenerationArena&) = delete;
+
+    /**
+     * Return a pointer to numBytes of uninitialised storage with the specified
+     * alignment (which must be no stricter than that of std::max_align_t)
+     */
+    void* allocate(std::size_t numBytes, std::size_t alignment);
+
+    /**
+     * Make sure that the arena's first block holds at least numBytes, so that this
+     * much can subsequently be allocated from it without adding further blocks.
+     * This can only be called when nothing has been allocated since the arena was
+     * last reset.
+     */
+    void reserve(std::size_t numBytes);
+
+    /**
+     * Release everything that has been allocated from the arena, so that its memory can
+     * be reused. All objects allocated from the arena must have been destroyed first.
+     */
+    void reset();
+
+    /**
+     * Returns the number of bytes that have been allocated since the arena was last
+     * reset (including any padding required for alignment)
+     */
+    std::size_t getBytesUsed() const {return m_iBytesUsed;}
+
+private:
+    /**
+     * Append a new block, large enough for an allocation of numBytes, to m_Blocks
+     */
+    void addBlock(std::size_t numBytes);
+
+    static constexpr std::size_t m_sMinBlockSize = 1 << 16; ///< Smallest block that will be added to the arena
+
+    std::vector<std::unique_ptr<unsigned char[]>> m_Blocks; ///< Blocks of storage, in the order in which they were added
+    std::vector<std::size_t> m_BlockSizes;  ///< Size of each block in m_Blocks
+    std::size_t     m_iBlockOffset;         ///< Number of bytes allocated from the last block in m_Blocks
+    std::size_t     m_iBytesUsed;           ///< Total number of bytes allocated since the arena was last reset
+    std::mutex      m_Mutex;                ///< Guards allocations made while pollinators are stepped concurrently
+};
+
+
+/**
+ * The ArenaAllocator class template is a standard library compatible allocator that
+ * allocates from a GenerationArena. Deallocation does nothing, as the memory is
+ * reclaimed when the arena is reset.
+ */
+template<typename T>
+class ArenaAllocator {
+
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    explicit ArenaAllocator(GenerationArena* pArena) noexcept : m_pArena(pArena) {}
+
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : m_pArena(other.getArena()) {}
+
+    T* allocate(std::size_t num)
+    {
+        return static_cast<T*>(m_pArena->allocate(num * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T*, std::size_t) noexcept {}
+
+    /**
+     * Returns the arena from which this allocator allocates
+     */
+    GenerationArena* getArena() const noexcept {return m_pArena;}
+
+private:
+    GenerationArena* m_pArena;  ///< (non-owning) pointer to the arena from which memory is allocated
+};
+
+template<typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) noexcept
+{
+    return (a.getArena() == b.getArena());
+}
+
+template<typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) noexcept
+{
+    return (a.getArena() != b.getArena());
+}
+
+#endif /* _GENERATIONARENA_H */
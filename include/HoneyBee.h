@@ -36,7 +36,7 @@ public:
     /**
      *
      */
-    std::string getStateString() const override final;
+    void captureState(PollinatorStatesSnapshot& snapshot) const override final;
 
     /**
      *
@@ -8,6 +8,9 @@
 #define _HYMENOPTERA_H
 
 #include <string>
+#include <set>
+#include <unordered_map>
+#include <functional>
 #include "PollinatorConfig.h"
 #include "Pollinator.h"
 
@@ -28,7 +31,11 @@ public:
 
     //void step() override = 0;
 
-    std::string getStateString() const override;
+    void captureState(PollinatorStatesSnapshot& snapshot) const override;
+
+    void saveState(CheckpointWriter& writer) const override;
+
+    void loadState(CheckpointReader& reader) override;
 
     const std::string& getTypeName() const override;
 
@@ -38,6 +45,14 @@ public:
      */
     bool isDetected(const ReflectanceInfo& rinfo) const override;
 
+    /**
+     * Overridden implementation of the method to compare a given stimulus with the
+     * pollinator's current target. This looks up the confidence level in a table
+     * precomputed for every pair of entries in the vis-data, falling back to the
+     * base class calculation if the table is not available.
+     */
+    float confidenceMatchesTarget(const ReflectanceInfo& stimulus) const override;
+
     static const std::vector<VisualStimulusInfo>& getVisData() {return m_sVisData;}
 
 protected:
@@ -61,14 +76,27 @@ protected:
 
     /**
      * Returns information about the pollinator's current preferences for
-     * a stimulus with the specified characteristic wavelength
+     * a stimulus with the specified characteristic wavelength.
+     *
+     * The const versions of these methods return a copy of the current preferences,
+     * whereas the non-const versions give this pollinator its own modifiable copy of
+     * the entry (see m_VisPrefOverlay) and return a reference to it.
      */
-    const VisualPreferenceInfo& getVisPrefInfoFromWavelengthConst(Wavelength lambda) const;
+    VisualPreferenceInfo        getVisPrefInfoFromWavelengthConst(Wavelength lambda) const;
     VisualPreferenceInfo&       getVisPrefInfoFromWavelength(Wavelength lambda);
 
-    const VisualPreferenceInfo& getVisPrefInfoFromStimulusInfo(const VisualStimulusInfo* pVisStimInfo) const;
+    VisualPreferenceInfo        getVisPrefInfoFromStimulusInfo(const VisualStimulusInfo* pVisStimInfo) const;
     VisualPreferenceInfo&       getVisPrefInfoFromStimulusInfo(const VisualStimulusInfo* pVisStimInfo);
 
+    /**
+     * Returns information about the pollinator's current preferences for the given
+     * stimulus (e.g. a flower's reflectance), using the stimulus's cached vis-data index
+     * if available. The result is the same as calling getVisPrefInfoFromWavelength()
+     * with the stimulus's characteristic wavelength.
+     */
+    VisualPreferenceInfo        getVisPrefInfoFromReflectanceConst(const ReflectanceInfo& rinfo) const;
+    VisualPreferenceInfo&       getVisPrefInfoFromReflectance(const ReflectanceInfo& rinfo);
+
     /**
      * Overridden implementation of method to determine whether the pollinator should
      * harvest the specified flower using its visual perception. This is a special case
@@ -84,12 +112,47 @@ protected:
 
 
 private:
-    std::vector<VisualPreferenceInfo>       m_VisualPreferences;///< record of the pollinator's current preferences for
-                                                                ///< difference visual stimuli. This visual preferences vector
-                                                                ///< contains an entry for every entry in m_sVisData.
-                                                                ///< When ColourSystem == ARBITRARY_DOMINANT_WAVELENGTHS each
-                                                                ///< VisualPreferenceInfo entry in the vector has a pointer to
-                                                                ///< the corresponding VisualStimulusInfo entry in m_sVisData.
+    using VisPrefRankKey = std::pair<float, int>;
+
+    std::vector<float>                      m_VisPrefBaseProbLandNonTarget;
+                                                                ///< this pollinator's individual baseProbLandNonTarget for each
+                                                                ///< entry in m_sVisPrefPrototypes, or empty if these are all the
+                                                                ///< same as the prototypes' (i.e. there is no individual variation)
+
+    std::vector<unsigned int>               m_VisPrefBaseRanking;
+                                                                ///< indices of m_sVisPrefPrototypes ordered as m_sVisPrefPrototypeRanking
+                                                                ///< but by this pollinator's individual baseProbLandNonTarget (only
+                                                                ///< used if m_VisPrefBaseProbLandNonTarget is not empty, and built
+                                                                ///< when first needed)
+
+    mutable std::unordered_map<std::size_t, VisualPreferenceInfo> m_VisPrefOverlay;
+                                                                ///< the pollinator's own copies of the visual preferences it has
+                                                                ///< modified since the last reset, indexed as m_sVisPrefPrototypes.
+                                                                ///< Any other preference is still at its base values, apart from
+                                                                ///< any pending attenuation. (This is mutable because preference
+                                                                ///< attenuation is applied lazily when an entry is next read.)
+
+    mutable std::set<VisPrefRankKey, std::greater<VisPrefRankKey>> m_VisPrefRanking;
+                                                                ///< the entries of m_VisPrefOverlay ordered by an upper bound
+                                                                ///< on their probLandNonTarget (see getVisPrefRankKey()), used
+                                                                ///< to find the best non-target preference without a full scan
+
+    std::size_t                             m_VisPrefPristineCursor;
+                                                                ///< position in the base ranking before which every entry is
+                                                                ///< known to be in m_VisPrefOverlay
+
+    int                                     m_iNumAttenuations; ///< number of preference attenuation rounds since the last reset
+
+    static std::vector<VisualPreferenceInfo> m_sVisPrefPrototypes;
+                                                                ///< the baseline visual preferences shared by all pollinators,
+                                                                ///< with an entry for every entry in m_sVisData and in the same
+                                                                ///< order. When ColourSystem == ARBITRARY_DOMINANT_WAVELENGTHS each
+                                                                ///< entry has a pointer to the corresponding VisualStimulusInfo
+                                                                ///< entry in m_sVisData.
+
+    static std::vector<unsigned int>        m_sVisPrefPrototypeRanking;
+                                                                ///< indices of m_sVisPrefPrototypes in descending order of
+                                                                ///< baseProbLandNonTarget (ascending index order for ties)
 
     static std::vector<VisualStimulusInfo>  m_sVisData;         ///< vector containing data relating to pollinator's
                                                                 ///< visual sensation of stimuli at different
@@ -132,6 +195,15 @@ private:
                                                                 ///< colour preferences for hoverflies as described in Fig 5 of
                                                                 ///< Lunau & Wacht, J. Comp. Physiol A (1994).
 
+    static std::vector<float>       m_sVisMatchConfidenceTable; ///< confidence of match between each pair of entries in m_sVisData,
+                                                                ///< indexed by [stimulusIdx * m_sVisData.size() + targetIdx]. This is
+                                                                ///< left empty if the table would be too large to be worth storing.
+
+    static std::vector<int>         m_sVisDataIdxFromId;        ///< index in m_sVisData of the entry with each id, offset by
+                                                                ///< m_sVisDataMinId (only used under ARBITRARY_DOMINANT_WAVELENGTHS)
+
+    static int                      m_sVisDataMinId;            ///< the smallest id of any entry in m_sVisData
+
     static bool                     m_sbStaticsInitialised;     ///< Flags whether statics have been initialised from config file
 
     /**
@@ -144,6 +216,21 @@ private:
     void attenuatePreferences();
     void updateVisualPrefsFickleCircumspect(const Flower* pFlower, int nectarCollected);
     void updateVisualPrefsStay(const Flower* pFlower, int nectarCollected);
+    std::size_t getNumVisPrefs() const;
+    std::size_t getVisPrefIdxFromWavelength(Wavelength lambda) const;
+    std::size_t getVisPrefIdxFromStimulusInfo(const VisualStimulusInfo* pVisStimInfo) const;
+    std::size_t getVisPrefIdxFromReflectance(const ReflectanceInfo& rinfo) const;
+    VisualPreferenceInfo getVisPrefConst(std::size_t idx) const;
+    VisualPreferenceInfo& getVisPref(std::size_t idx);
+    VisualPreferenceInfo makeBaseVisPref(std::size_t idx) const;
+    float getBaseProbLandNonTarget(std::size_t idx) const;
+    const std::vector<unsigned int>& getVisPrefBaseRanking();
+    void clearVisPrefOverlay();
+    void syncVisPref(VisualPreferenceInfo& vpi, std::size_t idx) const;
+    void rebuildVisPrefRanking();
+    void updateVisPrefRanking(std::size_t idx, float oldProbLandNonTarget) const;
+    int findBestNonTargetVisPref(float& probLandNonTarget);
+    static VisPrefRankKey getVisPrefRankKey(const VisualPreferenceInfo& vpi, float probLandNonTarget, std::size_t idx);
     void pickRandomTarget();
     void initialiseInnateTarget();
     void initialiseInnateTargetRegular();
@@ -156,6 +243,9 @@ private:
     static const VisualStimulusInfo& getSingleVisStimInfoFromWavelength(Wavelength lambda);
     static std::size_t getVisualDataVectorIdx(Wavelength lambda);
     static float getBaseProbLandNonTargetInnate(Wavelength lambda);
+    static void buildVisPrefPrototypes();
+    static void buildVisMatchConfidenceTable();
+    static int getVisMatchTableIdx(const ReflectanceInfo& rinfo);
 };
 
 #endif /* _HYMENOPTERA_H */
@@ -0,0 +1,396 @@
+/**
+ * @file
+ *
+ * Declaration of the binary log file format support classes
+ */
+
+#ifndef _LOGBINARY_H
+#define _LOGBINARY_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <type_traits>
+
+
+/**
+ * Definition of the allowable formats of the main log file
+ */
+enum class LogFormat {
+    TEXT,       ///< Comma separated values, one record per line (see docs/evobee-log-files.md)
+    BINARY      ///< Typed columnar chunks (see BinaryChunkWriter), convertible to TEXT with evobee-logcat
+};
+
+
+/**
+ * The type of the values stored in a column of a binary log file
+ */
+enum class BinaryColumnType : std::uint8_t {U8, U16, U32, U64, I32, I64, F32, STR};
+
+/**
+ * The encoding used to store the values of a (non-STR) column in a binary log chunk
+ */
+enum class BinaryColumnEncoding : std::uint8_t {
+    PLAIN,          ///< numRows fixed-width values
+    CONSTANT,       ///< a single fixed-width value, shared by all rows
+    DELTA_VARINT    ///< (integer columns only) the difference between each value and the
+                    ///<   previous one (the first is relative to 0), zigzag encoded as a
+                    ///<   LEB128 varint
+};
+
+/**
+ * Description of a single column in a table of a binary log chunk
+ */
+struct BinaryColumnSchema {
+    std::string      name;
+    BinaryColumnType type;
+};
+
+/**
+ * Description of a single table in a binary log chunk
+ */
+struct BinaryTableSchema {
+    std::string name;
+    std::vector<BinaryColumnSchema> columns;
+};
+
+/**
+ * Description of the tables that make up a binary log chunk for a given log record type
+ */
+struct BinaryRecordSchema {
+    char tag;       ///< The log-flag associated with the record type (e.g. 'Q', 'F', 'f')
+    std::vector<BinaryTableSchema> tables;
+};
+
+
+/**
+ * The BinaryLogSchema class defines the layout of all record types in a binary
+ * log file.
+ *
+ * A binary log file starts with a header containing a magic string, the format
+ * version, and a description of this schema (see writeHeader()). The rest of the
+ * file is a sequence of chunks, each of which holds the data from a single log
+ * event (i.e. one LogSnapshot). A chunk consists of:
+ *   - u64 chunk size in bytes (excluding this field)
+ *   - u8  record type tag
+ *   - u32 generation number
+ *   - u32 step number
+ *   - for each table of the record type's schema:
+ *       - u64 number of rows
+ *       - for each column, the values of all rows stored contiguously. Numeric
+ *         columns start with a u8 BinaryColumnEncoding, chosen by the writer to
+ *         minimise the size of the column. STR values are stored as a u32 length
+ *         followed by the characters.
+ *
+ * All values are stored in the native byte order of the machine that wrote the
+ * file. The header includes a byte order marker so that readers can check this.
+ */
+class BinaryLogSchema {
+
+public:
+    /**
+     * Returns the schema of the record type with the specified tag. Throws
+     * std::runtime_error if the tag is unknown.
+     */
+    static const BinaryRecordSchema& getRecordSchema(char tag);
+
+    /**
+     * Returns the schemas of all record types
+     */
+    static const std::vector<BinaryRecordSchema>& getAllRecordSchemas();
+
+    /**
+     * Append the binary log file header to buf
+     */
+    static void writeHeader(std::string& buf);
+
+    /**
+     * Read and check the binary log file header at the start of data. Returns
+     * the size of the header in bytes. Throws std::runtime_error if the data does
+     * not start with a valid header, or if the schema it describes differs from
+     * the one used by this version of the program.
+     */
+    static std::size_t readHeader(const char* data, std::size_t size);
+
+    static const char*   m_sMagic;      ///< Magic string at start of binary log files
+    static const std::uint32_t m_sVersion;  ///< Version number of the binary log format
+};
+
+
+/**
+ * The BinaryChunkWriter class appends a single chunk to a binary log buffer.
+ *
+ * Tables and columns must be written in the order given by the record type's
+ * schema. The type of each column written is checked against the schema.
+ */
+class BinaryChunkWriter {
+
+public:
+    BinaryChunkWriter(std::string& buf, char tag, unsigned int gen, unsigned int step);
+
+    /**
+     * Start the next table of the chunk, which will have numRows rows
+     */
+    void beginTable(std::size_t numRows);
+
+    /**
+     * Write the next column of the current table, with the value of row i
+     * given by getter(i)
+     */
+    template<typename T, typename Getter>
+    void column(Getter getter)
+    {
+        checkColumn(typeOf<T>());
+
+        std::vector<T> vals(m_iNumRows);
+        bool bConstant = (m_iNumRows > 0);
+        for (std::size_t i = 0; i < m_iNumRows; ++i)
+        {
+            vals[i] = getter(i);
+            bConstant = bConstant && (vals[i] == vals[0]);
+        }
+
+        if (bConstant)
+        {
+            appendValue<std::uint8_t>((std::uint8_t)BinaryColumnEncoding::CONSTANT);
+            appendValue<T>(vals[0]);
+            return;
+        }
+
+        if constexpr (std::is_integral_v<T>)
+        {
+            std::size_t varintSize = 0;
+            T prev = 0;
+            for (T val : vals)
+            {
+                varintSize += varintLength(zigzagDelta(prev, val));
+                prev = val;
+            }
+
+            if (varintSize < vals.size() * sizeof(T))
+            {
+                appendValue<std::uint8_t>((std::uint8_t)BinaryColumnEncoding::DELTA_VARINT);
+                prev = 0;
+                for (T val : vals)
+                {
+                    appendVarint(zigzagDelta(prev, val));
+                    prev = val;
+                }
+                return;
+            }
+        }
+
+        appendValue<std::uint8_t>((std::uint8_t)BinaryColumnEncoding::PLAIN);
+        m_Buf.append(reinterpret_cast<const char*>(vals.data()), vals.size() * sizeof(T));
+    }
+
+    /**
+     * Write the next column of the current table, which must be of type STR
+     */
+    template<typename Getter>
+    void stringColumn(Getter getter)
+    {
+        checkColumn(BinaryColumnType::STR);
+        for (std::size_t i = 0; i < m_iNumRows; ++i)
+        {
+            const std::string& str = getter(i);
+            appendValue<std::uint32_t>(str.size());
+            m_Buf.append(str);
+        }
+    }
+
+    /**
+     * Finish the chunk (this must be called once all tables have been written)
+     */
+    void finish();
+
+    template<typename T>
+    static BinaryColumnType typeOf();
+
+    /**
+     * Returns the zigzag encoding of the difference between two integer values
+     * (with wrap around, so that the original value can always be recovered)
+     */
+    template<typename T>
+    static std::uint64_t zigzagDelta(T prev, T val)
+    {
+        std::int64_t delta = (std::int64_t)((std::uint64_t)val - (std::uint64_t)prev);
+        return ((std::uint64_t)delta << 1) ^ (std::uint64_t)(delta >> 63);
+    }
+
+private:
+    static std::size_t varintLength(std::uint64_t val)
+    {
+        std::size_t len = 1;
+        while (val >= 0x80)
+        {
+            val >>= 7;
+            ++len;
+        }
+        return len;
+    }
+
+    void appendVarint(std::uint64_t val)
+    {
+        while (val >= 0x80)
+        {
+            m_Buf += (char)((val & 0x7F) | 0x80);
+            val >>= 7;
+        }
+        m_Buf += (char)val;
+    }
+
+    void checkColumn(BinaryColumnType type);
+
+    template<typename T>
+    void appendValue(T val)
+    {
+        char bytes[sizeof(T)];
+        std::memcpy(bytes, &val, sizeof(T));
+        m_Buf.append(bytes, sizeof(T));
+    }
+
+    std::string&        m_Buf;
+    std::size_t         m_iChunkStart;  ///< Offset in m_Buf of the chunk size field
+    const BinaryRecordSchema& m_Schema;
+    std::size_t         m_iTable;       ///< Index of the current table in m_Schema
+    std::size_t         m_iColumn;      ///< Index of the next column in the current table
+    std::size_t         m_iNumRows;     ///< Number of rows in the current table
+};
+
+
+/**
+ * The BinaryChunkReader class reads the contents of a single chunk of a binary
+ * log file (see BinaryChunkWriter)
+ */
+class BinaryChunkReader {
+
+public:
+    /**
+     * Constructor. data points to the start of a chunk, and size is the number
+     * of bytes available from data onwards.
+     */
+    BinaryChunkReader(const char* data, std::size_t size);
+
+    char getTag() const {return m_Tag;}
+    unsigned int getGen() const {return m_iGen;}
+    unsigned int getStep() const {return m_iStep;}
+
+    /**
+     * Returns the total size of the chunk in bytes (i.e. the offset of the next chunk)
+     */
+    std::size_t getChunkSize() const {return m_iChunkSize;}
+
+    /**
+     * Start reading the next table of the chunk, and return its number of rows
+     */
+    std::size_t beginTable();
+
+    /**
+     * Read the next column of the current table, calling setter(i, value) for
+     * each row i
+     */
+    template<typename T, typename Setter>
+    void column(Setter setter)
+    {
+        checkColumn(BinaryChunkWriter::typeOf<T>());
+
+        auto encoding = (BinaryColumnEncoding)readValue<std::uint8_t>();
+        switch (encoding) {
+        case BinaryColumnEncoding::PLAIN: {
+            for (std::size_t i = 0; i < m_iNumRows; ++i)
+            {
+                setter(i, readValue<T>());
+            }
+            break;
+        }
+        case BinaryColumnEncoding::CONSTANT: {
+            T val = readValue<T>();
+            for (std::size_t i = 0; i < m_iNumRows; ++i)
+            {
+                setter(i, val);
+            }
+            break;
+        }
+        case BinaryColumnEncoding::DELTA_VARINT: {
+            if constexpr (std::is_integral_v<T>)
+            {
+                std::uint64_t prev = 0;
+                for (std::size_t i = 0; i < m_iNumRows; ++i)
+                {
+                    std::uint64_t zz = readVarint();
+                    std::uint64_t delta = (zz >> 1) ^ (~(zz & 1) + 1);
+                    prev += delta;
+                    setter(i, (T)prev);
+                }
+                break;
+            }
+            [[fallthrough]];
+        }
+        default: {
+            throw std::runtime_error("Invalid column encoding in binary log chunk");
+        }
+        }
+    }
+
+    /**
+     * Read the next column of the current table, which must be of type STR
+     */
+    template<typename Setter>
+    void stringColumn(Setter setter)
+    {
+        checkColumn(BinaryColumnType::STR);
+        for (std::size_t i = 0; i < m_iNumRows; ++i)
+        {
+            std::uint32_t len = readValue<std::uint32_t>();
+            need(len);
+            setter(i, std::string(m_pData + m_iPos, len));
+            m_iPos += len;
+        }
+    }
+
+    /**
+     * Check that all tables of the chunk have been read
+     */
+    void finish() const;
+
+private:
+    void checkColumn(BinaryColumnType type);
+    void need(std::size_t numBytes) const;
+    std::uint64_t readVarint();
+
+    template<typename T>
+    T readValue()
+    {
+        need(sizeof(T));
+        T val;
+        std::memcpy(&val, m_pData + m_iPos, sizeof(T));
+        m_iPos += sizeof(T);
+        return val;
+    }
+
+    const char*     m_pData;
+    std::size_t     m_iChunkSize;
+    std::size_t     m_iPos;         ///< Offset of next value to read from m_pData
+    char            m_Tag;
+    unsigned int    m_iGen;
+    unsigned int    m_iStep;
+    const BinaryRecordSchema* m_pSchema;
+    std::size_t     m_iTable;
+    std::size_t     m_iColumn;
+    std::size_t     m_iNumRows;
+};
+
+
+template<> inline BinaryColumnType BinaryChunkWriter::typeOf<std::uint8_t>()  {return BinaryColumnType::U8;}
+template<> inline BinaryColumnType BinaryChunkWriter::typeOf<std::uint16_t>() {return BinaryColumnType::U16;}
+template<> inline BinaryColumnType BinaryChunkWriter::typeOf<std::uint32_t>() {return BinaryColumnType::U32;}
+template<> inline BinaryColumnType BinaryChunkWriter::typeOf<std::uint64_t>() {return BinaryColumnType::U64;}
+template<> inline BinaryColumnType BinaryChunkWriter::typeOf<std::int32_t>()  {return BinaryColumnType::I32;}
+template<> inline BinaryColumnType BinaryChunkWriter::typeOf<std::int64_t>()  {return BinaryColumnType::I64;}
+template<> inline BinaryColumnType BinaryChunkWriter::typeOf<float>()         {return BinaryColumnType::F32;}
+
+#endif /* _LOGBINARY_H */
@@ -0,0 +1,265 @@
+/**
+ * @file
+ *
+ * Declaration of the LogSnapshot class and its subclasses
+ */
+
+#ifndef _LOGSNAPSHOT_H
+#define _LOGSNAPSHOT_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include "ReflectanceInfo.h"
+#include "PollinatorEnums.h"
+
+class BinaryChunkReader;
+
+
+/**
+ * The LogSnapshot class is the base class of immutable snapshots of model state
+ * captured by the Logger.
+ *
+ * A snapshot is captured on the simulation thread and contains copies of all of
+ * the data needed to produce a set of log records, so that it can later be
+ * formatted and written out (possibly on a separate writer thread) without
+ * referring back to the model.
+ */
+class LogSnapshot {
+
+public:
+    virtual ~LogSnapshot() {}
+
+    /**
+     * Format the snapshot and append the resulting log lines to the specified buffer
+     */
+    virtual void write(std::string& buf) const = 0;
+
+    /**
+     * Append the snapshot to the specified buffer as a binary log chunk
+     * (see BinaryLogSchema)
+     */
+    virtual void writeBinary(std::string& buf) const = 0;
+
+    /**
+     * Reconstruct a snapshot from a binary log chunk. The text written by the
+     * write() method of the returned snapshot is identical to that written by
+     * the original snapshot.
+     */
+    static std::unique_ptr<LogSnapshot> readBinary(BinaryChunkReader& reader);
+};
+
+
+/**
+ * The state of a single visual preference of a pollinator at the time of a snapshot
+ */
+struct VisualPreferenceRecord {
+    Wavelength  lambda;
+    float       probLandTarget;
+    float       probLandNonTarget;
+};
+
+/**
+ * The state of a single pollinator at the time of a snapshot
+ * (see Pollinator::captureState)
+ */
+struct PollinatorStateRecord {
+    const std::string* pTypeName;   ///< Pointer to the pollinator class's (static) type name
+    unsigned int id;
+    float       x;
+    float       y;
+    float       heading;
+    int         numFlowersVisitedInBout;
+    int         latestActionStepnum;
+    PollinatorCurrentStatus latestActionStatus;
+    Wavelength  latestActionFlowerLambda;
+    int         latestActionReward;
+    bool        latestActionJudgedToMatchTarget;
+    bool        hasVisualState;     ///< Are the following fields used? (only for Hymenoptera)
+    Wavelength  targetWavelength;
+    std::size_t prefsBegin;         ///< Index of first entry in PollinatorStatesSnapshot::prefs
+    std::size_t prefsEnd;           ///< One past the index of the last entry in PollinatorStatesSnapshot::prefs
+};
+
+/**
+ * A snapshot of the full state of all pollinators (log-flags "Q" and "P")
+ */
+class PollinatorStatesSnapshot : public LogSnapshot {
+
+public:
+    PollinatorStatesSnapshot(char tag, unsigned int gen, unsigned int step) :
+        m_Tag(tag), m_iGen(gen), m_iStep(step) {}
+
+    void write(std::string& buf) const override;
+    void writeBinary(std::string& buf) const override;
+    static std::unique_ptr<LogSnapshot> readBinary(BinaryChunkReader& reader);
+
+    /**
+     * Append the state of a single pollinator to buf (without the leading tag, gen and step)
+     */
+    void writeRecord(std::string& buf, const PollinatorStateRecord& rec) const;
+
+    std::vector<PollinatorStateRecord>  records;
+    std::vector<VisualPreferenceRecord> prefs;
+
+private:
+    std::vector<std::string> m_TypeNames; ///< Storage for type names of snapshots read by readBinary()
+    char         m_Tag;
+    unsigned int m_iGen;
+    unsigned int m_iStep;
+};
+
+
+/**
+ * The performance of a single pollinator with a single plant species
+ */
+struct PollinatorPerformanceRecord {
+    unsigned int speciesId;
+    int          numLandings;
+    int          numPollinations;
+    int          numPollenGrainsInStore;
+};
+
+/**
+ * A summary of the performance of all pollinators (log-flags "p")
+ */
+class PollinatorSummarySnapshot : public LogSnapshot {
+
+public:
+    PollinatorSummarySnapshot(unsigned int gen) : m_iGen(gen) {}
+
+    void write(std::string& buf) const override;
+    void writeBinary(std::string& buf) const override;
+    static std::unique_ptr<LogSnapshot> readBinary(BinaryChunkReader& reader);
+
+    std::vector<unsigned int>  pollinatorIds;
+    std::vector<std::size_t>   perfBegin;   ///< Index of first entry in perf for each pollinator
+    std::vector<PollinatorPerformanceRecord> perf;
+
+private:
+    unsigned int m_iGen;
+};
+
+
+/**
+ * The state of a single flower at the time of a snapshot (see Flower::captureState)
+ */
+struct FlowerStateRecord {
+    unsigned int id;
+    unsigned int speciesId;
+    float       x;
+    float       y;
+    Wavelength  lambda;
+    bool        pollinated;
+    int         antherPollen;
+    std::size_t numStigmaPollen;
+    int         availableNectar;
+};
+
+/**
+ * A snapshot of the full state of all flowers (log-flags "G")
+ */
+class FlowerStatesSnapshot : public LogSnapshot {
+
+public:
+    FlowerStatesSnapshot(unsigned int gen, unsigned int step) : m_iGen(gen), m_iStep(step) {}
+
+    void write(std::string& buf) const override;
+    void writeBinary(std::string& buf) const override;
+    static std::unique_ptr<LogSnapshot> readBinary(BinaryChunkReader& reader);
+
+    /**
+     * Append the state of a single flower to buf (without the leading tag, gen and step)
+     */
+    static void writeRecord(std::string& buf, const FlowerStateRecord& rec);
+
+    std::vector<FlowerStateRecord> records;
+
+private:
+    unsigned int m_iGen;
+    unsigned int m_iStep;
+};
+
+
+/**
+ * The number of pollen grains from a given source wavelength on a flower's stigma
+ */
+struct PollenSourceRecord {
+    Wavelength   lambda;
+    int          count;
+    unsigned int sourceFlowerId;
+};
+
+/**
+ * The state of a single flower and the pollen on its stigma
+ */
+struct FlowerPollenRecord {
+    unsigned int id;
+    bool         pollinated;
+    Wavelength   lambda;
+    std::size_t  sourcesBegin;  ///< Index of first entry in FlowersFullSnapshot::sources
+    std::size_t  sourcesEnd;    ///< One past the index of the last entry in FlowersFullSnapshot::sources
+};
+
+/**
+ * The state of a single plant and its flowers
+ */
+struct PlantRecord {
+    unsigned int id;
+    unsigned int speciesId;
+    float        x;
+    float        y;
+    unsigned int localityId;
+    std::size_t  flowersBegin;  ///< Index of first entry in FlowersFullSnapshot::flowers
+    std::size_t  flowersEnd;    ///< One past the index of the last entry in FlowersFullSnapshot::flowers
+};
+
+/**
+ * A snapshot of all plants and the pollen on their flowers' stigmas (log-flags "F")
+ */
+class FlowersFullSnapshot : public LogSnapshot {
+
+public:
+    FlowersFullSnapshot(unsigned int gen) : m_iGen(gen) {}
+
+    void write(std::string& buf) const override;
+    void writeBinary(std::string& buf) const override;
+    static std::unique_ptr<LogSnapshot> readBinary(BinaryChunkReader& reader);
+
+    std::vector<PlantRecord>        plants;
+    std::vector<FlowerPollenRecord> flowers;
+    std::vector<PollenSourceRecord> sources;
+
+private:
+    unsigned int m_iGen;
+};
+
+
+/**
+ * A snapshot of a table of summary counts (log-flags "f", "g", "m", "n" and "s").
+ *
+ * Each row is written as "tag,gen,step,key[,name],value1,value2,...", where the
+ * name field is only present if names is non-empty.
+ */
+class SummaryCountsSnapshot : public LogSnapshot {
+
+public:
+    SummaryCountsSnapshot(char tag, unsigned int gen, unsigned int step, std::size_t numValuesPerRow) :
+        m_Tag(tag), m_iGen(gen), m_iStep(step), m_iNumValuesPerRow(numValuesPerRow) {}
+
+    void write(std::string& buf) const override;
+    void writeBinary(std::string& buf) const override;
+    static std::unique_ptr<LogSnapshot> readBinary(BinaryChunkReader& reader);
+
+    std::vector<long>        keys;      ///< Key of each row
+    std::vector<std::string> names;     ///< Optional name of each row
+    std::vector<long>        values;    ///< numValuesPerRow values for each row
+
+private:
+    char         m_Tag;
+    unsigned int m_iGen;
+    unsigned int m_iStep;
+    std::size_t  m_iNumValuesPerRow;
+};
+
+#endif /* _LOGSNAPSHOT_H */
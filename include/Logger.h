@@ -10,6 +10,14 @@
 #include <string>
 #include <iostream>
 #include <filesystem>
+#include <fstream>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include "SpscQueue.h"
+#include "LogSnapshot.h"
 
 class EvoBeeModel;
 class Environment;
@@ -17,6 +25,15 @@ class Environment;
 
 /**
  * The Logger class ...
+ *
+ * Each log method captures an immutable LogSnapshot of the data it needs on the
+ * simulation thread. If the use-log-threads config option is set, the snapshot
+ * is passed on a bounded lock-free queue to a dedicated writer thread which
+ * formats it and writes it to the log file; otherwise it is written immediately.
+ *
+ * The main log file is kept open for the whole run with a large output buffer,
+ * and is only flushed when flush() or finishWriting() are called (or when the
+ * buffer fills up).
  */
 class Logger {
 
@@ -24,6 +41,9 @@ public:
     Logger(EvoBeeModel* pModel);
     ~Logger();
 
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
     /**
      *
      */
@@ -84,6 +104,28 @@ public:
      */
     void logFlowerInfoInterPhaseSummary();
 
+    /**
+     * Log the number of steps taken by all pollinators at the end of each foraging
+     * phase, broken down by the outcome of each step
+     * Designated by log-flags="s" in the JSON config file
+     */
+    void logPollinatorStepsInterPhaseSummary();
+
+    /**
+     * Flush all log records submitted so far to the main log file. If a writer
+     * thread is in use, the flush is performed by that thread once it has written
+     * all preceding snapshots.
+     */
+    void flush();
+
+    /**
+     * Wait for the writer thread (if any) to write all outstanding snapshots,
+     * then stop it, close the main log file and report the writer thread's
+     * back-pressure statistics in the run info file.
+     * It is safe to call this more than once.
+     */
+    void finishWriting();
+
     /**
      *
      */
@@ -91,7 +133,12 @@ public:
 
 private:
 
-    std::ofstream openLogFile(); // a private helper method
+    void openLogFile();     // a private helper method
+    void flushLogFile();    // a private helper method
+
+    void submit(std::unique_ptr<LogSnapshot> pSnapshot);
+    void writeSnapshot(const LogSnapshot* pSnapshot);
+    void writerLoop();
 
     std::filesystem::path m_LogDir;
     std::filesystem::path m_MainLogFilePath;
@@ -110,6 +157,25 @@ private:
 
     EvoBeeModel* m_pModel;
     Environment* m_pEnv;
+
+    static constexpr std::size_t m_sLogBufferSize = 1 << 20; ///< Size of the main log file's output buffer
+    static constexpr std::size_t m_sQueueCapacity = 64; ///< Max number of snapshots awaiting the writer thread
+
+    std::vector<char>   m_LogBuffer;        ///< Output buffer for m_LogStream (declared first so it outlives the stream)
+    std::ofstream       m_LogStream;        ///< Main log file (opened on first use)
+    std::string         m_strLineBuffer;    ///< Reusable buffer for formatting snapshots
+
+    SpscQueue<std::unique_ptr<LogSnapshot>> m_Queue; ///< Snapshots awaiting the writer thread
+    std::thread         m_WriterThread;
+    std::atomic<bool>   m_bWriterStop;      ///< Set when the writer thread should drain the queue and exit
+    std::atomic<bool>   m_bWriterFailed;    ///< Set if the writer thread has thrown an exception
+    std::exception_ptr  m_pWriterException; ///< Exception thrown by the writer thread
+    bool                m_bFinished;        ///< Has finishWriting() been called?
+
+    unsigned long       m_iNumSnapshots;    ///< Number of snapshots submitted
+    unsigned long       m_iNumProducerWaits;///< Number of submissions that found the queue full
+    double              m_fProducerWaitSecs;///< Total time the simulation thread spent waiting for the queue
+    std::size_t         m_iMaxQueueDepth;   ///< Maximum number of snapshots seen in the queue
 };
 
 #endif /* _LOGGER_H */
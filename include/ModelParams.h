@@ -16,6 +16,8 @@
 #include "PollinatorConfig.h"
 #include "ReflectanceInfo.h"
 #include "EvoBeeExperiment.h"
+#include "RngEngine.h"
+#include "LogBinary.h"
 
 
 /**
@@ -46,6 +48,7 @@ public:
     static void setLogUpdatePeriod(int p);
     static void setLogInterGenUpdatePeriod(int p);
     static void setLogThreads(bool useThreads) {m_bUseLogThreads = useThreads;}
+    static void setLogFormat(const std::string& formatstr);
     static void setLogDir(const std::string& dir);
     static void setLogFinalDir(const std::string& dir);
     static void setLogRunName(const std::string& name);
@@ -59,6 +62,11 @@ public:
     static void setGenTerminationIntParam(int p);
     static void setGenTerminationFloatParam(float p);
     static void setRngSeedStr(const std::string& seed, bool bRewriteJsonEntry = false);
+    static void setRngType(const std::string& typestr);
+    static void setPollinatorStepThreads(int threads);
+    static void setPollinatorFastForward(bool fastForward) {m_bPollinatorFastForward = fastForward;}
+    static void setCheckpointPeriod(int p);
+    static void setResumeCheckpointFile(const std::string& path) {m_strResumeCheckpointFile = path;}
     static void setPtdAutoDistribs(bool bAutoDistribs);
     static void setPtdAutoDistribNumRows(int rows);
     static void setPtdAutoDistribNumCols(int cols);
@@ -81,6 +89,20 @@ public:
     static void setColourSystem(const std::string& cs);
 
     static void setTestNumber(unsigned int num);
+    static void setNumReplicates(unsigned int num);
+    static void setNumReplicateWorkers(unsigned int num);
+    static void setBranchAtGen(int gen);
+    static void setBranchesFile(const std::string& path) {m_strBranchesFile = path;}
+    static void setBranchNumber(unsigned int num) {m_iBranchNumber = num;}
+
+    /**
+     * Discard everything that processing a configuration file adds to, rather
+     * than overwrites: the hive, plant type distribution, plant type and pollinator
+     * configs, and the log flags. This allows a modified version of the configuration
+     * to be processed again from scratch (see --branches), provided that
+     * postprocess() has not yet been called.
+     */
+    static void clearConfigSections();
 
     /// perform any necessary global post-processing after config file has been read in
     static void postprocess();
@@ -110,10 +132,12 @@ public:
     static bool  logFlowersIntraPhaseSummary() {return m_bLogFlowersIntraPhaseSummary;}
     static bool  logFlowerMPsInterPhaseSummary() {return m_bLogFlowerMPsInterPhaseSummary;}
     static bool  logFlowerInfoInterPhaseSummary() {return m_bLogFlowerInfoInterPhaseSummary;}
+    static bool  logPollinatorStepsInterPhaseSummary() {return m_bLogPollinatorStepsInterPhaseSummary;}
     static bool  logFinalDirSet() {return !m_strLogFinalDir.empty();}
     static int   getLogUpdatePeriod() {return m_iLogUpdatePeriod;}
     static int   getLogInterGenUpdatePeriod() {return m_iLogInterGenUpdatePeriod;}
     static bool  useLogThreads() {return m_bUseLogThreads;}
+    static LogFormat getLogFormat() {return m_LogFormat;}
     static bool  verbose() {return m_bVerbose;}
     static bool  commandLineQuiet() {return m_bCommandLineQuiet;}
     static int   getSimTerminationNumGens() {return m_iSimTerminationNumGens;}
@@ -126,6 +150,12 @@ public:
     static int   getPtdRandomIntroOngoingPatchSquareLength() {return m_iPtdRandomIntroOngoingPatchSquareLength;}
     static MarkerPoint getEnvBackgroundReflectanceMP() {return m_EnvBackgroundReflectanceMP;}
     static const std::string& getRngSeedStr() {return m_strRngSeed;}
+    static RngType getRngType() {return m_RngType;}
+    static int   getPollinatorStepThreads() {return m_iPollinatorStepThreads;}
+    static bool  pollinatorFastForward() {return m_bPollinatorFastForward;}
+    static int   getCheckpointPeriod() {return m_iCheckpointPeriod;}
+    static const std::string& getResumeCheckpointFile() {return m_strResumeCheckpointFile;}
+    static bool  resumeFromCheckpoint() {return !m_strResumeCheckpointFile.empty();}
     static const std::string& getLogDir() {return m_strLogDir;}
     static const std::string& getLogFinalDir() {return m_strLogFinalDir;}
     static const std::string& getLogRunName() {return m_strLogRunName;}
@@ -137,7 +167,15 @@ public:
     static int   getNumPlantTypes() {return m_PlantTypes.size();}
     static PollinatorConfig* getPollinatorConfigPtr(const std::string& pollinatorName);
     static unsigned int getTestNumber() {return m_iTestNumber;}
+    static unsigned int getNumReplicates() {return m_iNumReplicates;}
+    static unsigned int getNumReplicateWorkers() {return m_iNumReplicateWorkers;}
+    static int   getBranchAtGen() {return m_iBranchAtGen;}
+    static bool  branching() {return (m_iBranchAtGen > 0);}
+    static const std::string& getBranchesFile() {return m_strBranchesFile;}
+    static unsigned int getBranchNumber() {return m_iBranchNumber;}
     static ColourSystem getColourSystem() {return m_ColourSystem;}
+    static const std::vector<VisualStimulusInfo>& getVisData();
+    static int   getVisDataIdx(const ReflectanceInfo& rinfo);
 
     static nlohmann::json& getJson() {return m_Json;}
 
@@ -150,7 +188,6 @@ private:
     static void initialiseAutoGenPtdSpeciesPatchMap(std::vector<const std::string*>& speciesPatchMap);
     static const std::string getAutoGenPtdSpeciesForPatch(int x, int y, std::vector<const std::string*>& speciesPatchMap);
     static void pairPlantTypeConfigsToVisData();
-    static const std::vector<VisualStimulusInfo>& getVisData();
 
 
     // data members
@@ -181,6 +218,7 @@ private:
     static bool  m_bLogFlowersIntraPhaseSummary;      ///< Log summary flower info every m_iLogUpdatePeriod steps
     static bool  m_bLogFlowerMPsInterPhaseSummary;    ///< Log summary of flower marker points at end of each generation, every m_iLogInterGenUpdatePeriod gens
     static bool  m_bLogFlowerInfoInterPhaseSummary;   ///< Log summary of flower info aggregared by VisualStimulusInfo id at each of each gen, every m_iLogInterGenUpdatePeriod gens
+    static bool  m_bLogPollinatorStepsInterPhaseSummary; ///< Log counts of pollinator steps taken at end of each generation, every m_iLogInterGenUpdatePeriod gens
     static int   m_iLogUpdatePeriod;        ///< Number of model steps between each update of logger for log..IntraPhase methods
     static int   m_iLogInterGenUpdatePeriod;///< Number of generations between each update of logger for log..InterPhase methods
     static std::string m_strLogDir;         ///< Directory name for logging output during a run
@@ -188,6 +226,7 @@ private:
                                             ///<   (if blank, files are kept in m_strLogDir)
     static std::string m_strLogRunName;     ///< Run name to be used as prefix for log filenames
     static bool  m_bUseLogThreads;          ///< Use a separate thread for writing log files?
+    static LogFormat m_LogFormat;           ///< Format of the main log file
     static bool  m_bVerbose;                ///< Should progress messages be printed on stdout?
     static bool  m_bCommandLineQuiet;       ///< Was the -q option used on command line?
     static bool  m_bInitialised;            ///< Flag to indicate that parmas have been intiialised
@@ -218,6 +257,12 @@ private:
     static std::string  m_strNoSpecies;     ///< String representing the absence of a plant species in an area, used internally only
     static unsigned int m_sNextFreePtdcId;  ///< Each PlantTypeDistributionConfig gets its own unique id
     static std::string m_strRngSeed;        ///< Seed string used to seed RNG
+    static RngType m_RngType;               ///< Algorithm used by the model's RNG engine
+    static int   m_iPollinatorStepThreads;  ///< Number of threads for stepping pollinators (0 = original serial code)
+    static bool  m_bPollinatorFastForward;  ///< Skip the flower search on steps where a pollinator is too far from any flower to find one?
+    static int   m_iCheckpointPeriod;       ///< Number of generations between each model checkpoint (0 = no checkpoints)
+    static std::string m_strResumeCheckpointFile;   ///< Checkpoint file from which to resume the run (if blank,
+                                                    ///<   start a new run)
     static std::vector<HiveConfig> m_Hives; ///< Configuration info for each hive
     static std::vector<PlantTypeDistributionConfig> m_PlantDists;   ///< Config of plant distributions
     static std::vector<PlantTypeConfig> m_PlantTypes;               ///< Config of plant types
@@ -227,6 +272,13 @@ private:
     static unsigned int m_iTestNumber;      ///< Specifies that we should run a special test on the
                                             ///<   code rather than a normal run (default value is 0
                                             ///<   which means do a normal run).
+    static unsigned int m_iNumReplicates;   ///< Number of independent replicate runs of the config to perform
+    static unsigned int m_iNumReplicateWorkers; ///< Maximum number of replicate (or branch) runs to perform concurrently
+    static int   m_iBranchAtGen;            ///< Generation at which a branched experiment splits into its branches
+                                            ///<   (0 = no branching)
+    static std::string m_strBranchesFile;   ///< File holding the config overrides for each branch
+    static unsigned int m_iBranchNumber;    ///< If this is a branch of a branched experiment, its number (counting
+                                            ///<   from 1), otherwise 0
 
     static bool m_bSyntheticRegularMarkerPointsAdded; ///< This flag is used for internal checking during system initialisation
 
@@ -0,0 +1,102 @@
+/**
+ * @file
+ *
+ * Declaration of the ParallelStepper class
+ */
+
+#ifndef _PARALLELSTEPPER_H
+#define _PARALLELSTEPPER_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include "RngEngine.h"
+
+class Environment;
+class Pollinator;
+
+
+/**
+ * The ParallelStepper class steps all pollinators in the environment using
+ * multiple threads.
+ *
+ * The environment is divided into square tiles of patches, and pollinators are
+ * assigned to tiles according to their position at the start of the step. The
+ * tiles are then processed in four checkerboard phases (according to the parity
+ * of their x and y tile coordinates). The tile size is chosen to be at least twice
+ * the maximum reach of any pollinator in a single step (see
+ * Pollinator::getMaxStepReach()), so pollinators in different tiles of the same
+ * phase can never visit or inspect the same flower, and tiles in the same phase
+ * can therefore be processed concurrently.
+ *
+ * Within each tile, pollinators are stepped in the order in which they appear
+ * in the vector passed to step(). Together with the use of per-pollinator random
+ * number streams (RngType::PHILOX), this means that the results of a run are
+ * identical for any number of threads. Note that they are not identical to those
+ * of the serial path in EvoBeeModel::step(), because the order in which
+ * pollinators are stepped is different.
+ */
+class ParallelStepper {
+
+public:
+    /**
+     * Constructor. Creates numThreads-1 worker threads (the calling thread also
+     * processes tiles). The model's RNG should be seeded before this is called.
+     */
+    ParallelStepper(Environment* pEnv, unsigned int numThreads);
+    ~ParallelStepper();
+
+    ParallelStepper(const ParallelStepper&) = delete;
+    ParallelStepper& operator=(const ParallelStepper&) = delete;
+
+    /**
+     * Returns false if the pollinators in the environment cannot be stepped
+     * concurrently, because at least one of them has an unbounded reach
+     */
+    bool available() const {return m_iTileSize > 0;}
+
+    /**
+     * Returns the side length (in patches) of the tiles used to partition the
+     * environment
+     */
+    int getTileSize() const {return m_iTileSize;}
+
+    /**
+     * Returns the total number of threads used to step the pollinators
+     */
+    unsigned int getNumThreads() const {return m_iNumThreads;}
+
+    /**
+     * Perform one step of each of the specified pollinators
+     */
+    void step(const std::vector<Pollinator*>& pollinators);
+
+private:
+    void workerLoop(RngEngine rng);
+    void runPhase();
+    void processTiles();
+
+    Environment*    m_pEnv;         ///< (non-owned) pointer to the Environment
+    unsigned int    m_iNumThreads;  ///< Total number of threads, including the calling thread
+    int             m_iTileSize;    ///< Side length of each tile in patches (0 if unavailable)
+    int             m_iNumTilesX;   ///< Number of tiles in x direction
+    int             m_iNumTilesY;   ///< Number of tiles in y direction
+
+    std::vector<std::vector<Pollinator*>> m_TilePollinators; ///< Pollinators assigned to each tile
+    std::vector<int> m_PhaseTiles;  ///< Indices of the non-empty tiles in the current phase
+    std::atomic<std::size_t> m_iNextPhaseTile; ///< Index into m_PhaseTiles of next tile to process
+
+    std::vector<std::thread> m_Workers;
+    std::mutex      m_Mutex;
+    std::condition_variable m_cvStart;  ///< Signals workers that a new phase is ready
+    std::condition_variable m_cvDone;   ///< Signals calling thread that all workers are idle
+    unsigned int    m_iPhaseCounter;    ///< Incremented each time a new phase is started
+    unsigned int    m_iNumBusyWorkers;  ///< Number of workers still processing the current phase
+    bool            m_bShutdown;        ///< Set when the worker threads should exit
+    std::exception_ptr m_pException;    ///< First exception thrown by a worker in the current phase
+};
+
+#endif /* _PARALLELSTEPPER_H */
@@ -18,6 +18,32 @@ class Environment;
 
 using PlantVector = std::vector<FloweringPlant>;
 
+
+/**
+ * The PlantRangeT class template refers to a contiguous range of plants, and is used
+ * to give access to the plants in a Patch (which are held by the Environment, see
+ * Environment::installNewPlants())
+ */
+template<typename T>
+class PlantRangeT {
+
+public:
+    PlantRangeT() : m_pBegin(nullptr), m_pEnd(nullptr) {}
+    PlantRangeT(T* pBegin, T* pEnd) : m_pBegin(pBegin), m_pEnd(pEnd) {}
+
+    T* begin() const {return m_pBegin;}
+    T* end() const {return m_pEnd;}
+    std::size_t size() const {return (std::size_t)(m_pEnd - m_pBegin);}
+    bool empty() const {return (m_pBegin == m_pEnd);}
+
+private:
+    T* m_pBegin;
+    T* m_pEnd;
+};
+
+using PlantRange = PlantRangeT<FloweringPlant>;
+using ConstPlantRange = PlantRangeT<const FloweringPlant>;
+
 /**
  * The Patch class ...
  */
@@ -38,23 +64,21 @@ public:
     const iPos& getPosition() const {return m_Position;}
 
     /**
-     * Create a new plant object based upon the specified config objects and add
-     * it to this patch at the specified position
+     * Return the patch's unique index number in the Environment
      */
-    void addPlant(const PlantTypeConfig& typeConfig, const fPos& pos);
-
+    int getPosIdx() const {return m_posIdx;}
 
     /**
-     * Add an existing plant to the patch.
-     * A move constructor is used, so the instance of the plant passed in as a parameter
-     * is wiped when the method is finished. This is used during the reproduction procedure.
+     * Return a pointer to the Environment to which this patch belongs
      */
-    void addPlant(FloweringPlant& plant);
+    Environment* getEnvironment() const {return m_pEnv;}
 
     /**
-     * Delete all plants from this patch
+     * Set the range of plants that are on this patch. The plants themselves are
+     * owned by the Environment, which calls this whenever a new generation of
+     * plants is installed (see Environment::installNewPlants()).
      */
-    void killAllPlants();
+    void setFloweringPlants(const PlantRange& plants) {m_FloweringPlants = plants;}
 
     /**
      *
@@ -64,12 +88,15 @@ public:
     /**
      *
      */
-    PlantVector& getFloweringPlants() {return m_FloweringPlants;}
+    PlantRange getFloweringPlants() {return m_FloweringPlants;}
 
     /**
      *
      */
-    const PlantVector& getFloweringPlants() const {return m_FloweringPlants;}
+    ConstPlantRange getFloweringPlants() const
+    {
+        return ConstPlantRange(m_FloweringPlants.begin(), m_FloweringPlants.end());
+    }
 
     /**
      * Explicitly set the constraints on plant reproduction and seed flow for
@@ -162,7 +189,7 @@ private:
     int             m_posIdx;       ///< The patch's unique index number in the Environment
     iPos            m_Position;     ///< The patch's coordinates in Environment (derived from m_posIdx)
     //ReflectanceInfo m_BackgroundReflectance; ///< The patch's background reflectance properties
-    PlantVector     m_FloweringPlants;       ///< All of the flowering plants on this patch
+    PlantRange      m_FloweringPlants;       ///< All of the flowering plants on this patch
 
     // The following parameters place restrictions on plant reproduction
     bool            m_bReproConstraintsSetExplicitly;
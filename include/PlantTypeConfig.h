@@ -30,6 +30,7 @@ struct PlantTypeConfig {
         pollenCloggingAll(false),
         pollenCloggingPartial(false),
         initNectar(100),
+        initTemp(20.0),
         numFlowers(1),
         hasLeaf(false),
         reproSeedDispersalGlobal(false),
@@ -15,10 +15,10 @@ class Flower;
  * The Pollen class ...
  */
 struct Pollen {
-    Pollen(const Flower* pFlower, unsigned int _speciesId) : 
+    Pollen(const Flower* pFlower, unsigned int _speciesId, int _numLandings = 0) :
         pSource(pFlower),
-        speciesId(_speciesId), 
-        numLandings(0)
+        speciesId(_speciesId),
+        numLandings(_numLandings)
     {}
 
     // copy constructor
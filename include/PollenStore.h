@@ -0,0 +1,188 @@
+/**
+ * @file
+ *
+ * Declaration of the PollenStore class
+ */
+
+#ifndef _POLLENSTORE_H
+#define _POLLENSTORE_H
+
+#include <vector>
+#include <algorithm>
+#include "Pollen.h"
+#include "GenerationArena.h"
+#include "SmallVector.h"
+#include "evobeeConfig.h"
+
+/**
+ * Pollen on a stigma. Stigmas holding up to evobee_INLINE_STIGMA_POLLEN grains (set in
+ * CMakeLists.txt) store them inline, and larger ones are allocated from the arena of
+ * the flower's generation.
+ */
+using PollenVector = SmallVector<Pollen, evobee_INLINE_STIGMA_POLLEN, ArenaAllocator<Pollen>>;
+
+class Flower;
+class CheckpointWriter;
+class CheckpointReader;
+
+
+/**
+ * The PollenCohort struct represents all of the grains of pollen in a
+ * PollenStore that were collected from the same flower on the same visit.
+ * These grains are indistinguishable from each other, so we just keep a count
+ * of them.
+ */
+struct PollenCohort {
+    const Flower*   pSource;        ///< The flower from which the grains were collected
+    unsigned int    speciesId;      ///< The species of the source flower
+    int             pickupVisit;    ///< Value of the store's visit counter when the grains were collected
+    int             count;          ///< Number of grains remaining in the cohort
+};
+
+
+/**
+ * The PollenStore class holds the pollen being carried by a pollinator.
+ *
+ * Rather than storing each grain separately, grains are grouped into cohorts
+ * (see PollenCohort), which are held in the order in which they were collected.
+ * The number of flower landings each grain has experienced since it was
+ * collected is implicit in the difference between the store's visit counter
+ * and the cohort's pickupVisit, so recording a landing is a constant time
+ * operation, and grains that have exceeded the carryover limit are always at
+ * the front of the store and can be dropped a whole cohort at a time.
+ *
+ * Whenever grains leave the store (to a stigma, to the air, or to bring the
+ * store down to its capacity), they are chosen uniformly at random from the
+ * grains in the store. Rather than picking grains one at a time, the number
+ * taken from each cohort is drawn in a single pass over the cohorts (see
+ * splitRandomGrains()), so removing grains costs time proportional to the
+ * number of cohorts, and moving them to a stigma additionally costs time
+ * proportional to the number of grains moved.
+ */
+class PollenStore {
+
+public:
+    PollenStore();
+
+    /**
+     * Add num grains collected from the specified flower
+     */
+    void add(const Flower* pSource, unsigned int speciesId, int num);
+
+    /**
+     * Record that the pollinator has landed on another flower, incrementing
+     * the landing count of every grain in the store
+     */
+    void recordLanding() {++m_iNumVisits;}
+
+    /**
+     * Remove all grains whose landing count exceeds maxLandings
+     */
+    void removeGrainsWithLandingsOver(int maxLandings);
+
+    /**
+     * Remove num grains (or all grains, if the store holds fewer than num)
+     * chosen at random, and return the number removed.
+     * Takes time proportional to the number of cohorts.
+     */
+    int removeRandomGrains(int num);
+
+    /**
+     * Remove up to num grains, chosen at random from those whose source flower
+     * satisfies the predicate allowed(const Flower*), and append them to dest
+     * in random order. Returns the number of grains moved, which is less than num
+     * if the store holds fewer than num allowed grains.
+     * Takes time proportional to the number of cohorts plus the number of grains moved.
+     */
+    template<typename Allowed>
+    int moveRandomGrains(int num, Allowed allowed, PollenVector& dest)
+    {
+        // weight each cohort by its count if its grains are allowed, or zero otherwise
+        m_Weights.resize(m_Cohorts.size());
+        int totalWeight = 0;
+        for (std::size_t i = 0; i < m_Cohorts.size(); ++i)
+        {
+            m_Weights[i] = allowed(m_Cohorts[i].pSource) ? m_Cohorts[i].count : 0;
+            totalWeight += m_Weights[i];
+        }
+
+        int numMoved = std::min(num, totalWeight);
+        if (numMoved <= 0)
+        {
+            return 0;
+        }
+
+        // decide how many grains to take from each cohort, then move them all
+        splitRandomGrains(numMoved, totalWeight);
+        dest.reserve(dest.size() + numMoved);
+        for (std::size_t i = 0; i < m_Cohorts.size(); ++i)
+        {
+            PollenCohort& cohort = m_Cohorts[i];
+            for (int j = 0; j < m_Weights[i]; ++j)
+            {
+                dest.emplace_back(cohort.pSource, cohort.speciesId, m_iNumVisits - cohort.pickupVisit);
+            }
+            cohort.count -= m_Weights[i];
+        }
+
+        // the grains were appended cohort by cohort, so put them in random order
+        shuffleLastGrains(dest, numMoved);
+
+        m_iNumGrains -= numMoved;
+        removeEmptyCohorts();
+        return numMoved;
+    }
+
+    /**
+     * Remove all grains from the store
+     */
+    void clear();
+
+    /**
+     * Returns the total number of grains in the store
+     */
+    int size() const {return m_iNumGrains;}
+
+    bool empty() const {return (m_iNumGrains == 0);}
+
+    /**
+     * Returns the number of grains in the store of the specified plant species
+     */
+    int getNumGrains(unsigned int speciesId) const;
+
+    const std::vector<PollenCohort>& getCohorts() const {return m_Cohorts;}
+
+    void saveState(CheckpointWriter& writer) const;
+
+    void loadState(CheckpointReader& reader);
+
+private:
+    /**
+     * On entry, m_Weights holds the number of grains in each cohort that may be
+     * chosen, and totalWeight is their sum. On return, m_Weights holds the number
+     * of grains chosen from each cohort, for a choice of num of those grains
+     * uniformly at random (num must be no more than totalWeight).
+     */
+    void splitRandomGrains(int num, int totalWeight);
+
+    /**
+     * Returns a draw from the hypergeometric distribution: the number of marked
+     * items in a random sample of numDraws items taken without replacement from
+     * populationSize items, of which numMarked are marked
+     */
+    static int sampleHypergeometric(int numDraws, int numMarked, int populationSize);
+
+    /**
+     * Randomly shuffle the last num grains in pollen
+     */
+    static void shuffleLastGrains(PollenVector& pollen, int num);
+
+    void removeEmptyCohorts();
+
+    std::vector<PollenCohort> m_Cohorts;    ///< Non-empty cohorts, in the order in which they were collected
+    int             m_iNumGrains;           ///< Total number of grains in all cohorts
+    int             m_iNumVisits;           ///< Number of flower landings since the store was last cleared
+    std::vector<int> m_Weights;             ///< Working space used when choosing grains from the cohorts
+};
+
+#endif /* _POLLENSTORE_H */
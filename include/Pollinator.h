@@ -15,12 +15,15 @@
 #include "AbstractHive.h"
 #include "Environment.h"
 #include "Flower.h"
-#include "Pollen.h"
+#include "PollenStore.h"
 #include "PollinatorConfig.h"
 #include "PollinatorEnums.h"
 #include "PollinatorStructs.h"
 
 class Environment;
+class PollinatorStatesSnapshot;
+class CheckpointWriter;
+class CheckpointReader;
 
 /**
  * The Pollinator class ...
@@ -62,6 +65,15 @@ public:
      */
     virtual void step();
 
+    /**
+     * Returns an upper bound on the distance between the pollinator's position at
+     * the start of a call to step() and any flower it might visit or inspect during
+     * that step, or a negative value if there is no such bound (i.e. when using the
+     * random-global foraging strategy). Used to determine which pollinators can
+     * safely be stepped concurrently.
+     */
+    float getMaxStepReach() const;
+
     /**
      *
      */
@@ -93,7 +105,34 @@ public:
      * Returns a string representation of the pollinator's current state, suitable
      * for writing to a log file
      */
-    virtual std::string getStateString() const;
+    std::string getStateString() const;
+
+    /**
+     * Append a record of the pollinator's current state to a log snapshot.
+     * Subclasses that hold additional state may override this to add it to the
+     * record (see Hymenoptera::captureState).
+     */
+    virtual void captureState(PollinatorStatesSnapshot& snapshot) const;
+
+    /**
+     * Add the counts of the foraging steps taken by the pollinator since this was last
+     * called to the given totals, and clear them. This is called by the model after
+     * every step, so the counts do not need to be saved in checkpoints.
+     */
+    void transferStepCounts(PollinatorStepCounts& totals);
+
+    /**
+     * Write the pollinator's dynamic state to a checkpoint. Subclasses that hold
+     * additional state should override this and loadState() to include it
+     * (see Hymenoptera::saveState).
+     */
+    virtual void saveState(CheckpointWriter& writer) const;
+
+    /**
+     * Restore the pollinator's dynamic state from a checkpoint (see saveState()).
+     * All flowers referred to by the pollinator must already have been restored.
+     */
+    virtual void loadState(CheckpointReader& reader);
 
     /**
      *
@@ -110,6 +149,11 @@ public:
      */
     static unsigned int getMaxIdIssued() {return m_sNextFreeId-1;}
 
+    /**
+     * Set the next available unique pollinator id (when restoring from a checkpoint)
+     */
+    static void setNextFreeId(unsigned int id) {m_sNextFreeId = id;}
+
     /**
      *
      */
@@ -138,7 +182,7 @@ public:
      * returns a confidence level between 0.0 and 1.0 that the stimulus matches
      * the target.
      */
-    float confidenceMatchesTarget(const ReflectanceInfo& stimulus) const;
+    virtual float confidenceMatchesTarget(const ReflectanceInfo& stimulus) const;
 
     /**
      * Returns the pollinator's current target marker point.
@@ -216,6 +260,26 @@ protected:
      */
     virtual int visitFlower(Flower* pFlower);
 
+    /**
+     * Make a foraging step in which the pollinator is known to be out of range of
+     * every flower. This has the same effect as a step of the pollinator's foraging
+     * strategy in which no flower is found, but without searching for flowers.
+     */
+    void forageFlowerless();
+
+    /**
+     * Returns the number of steps following the current one on which the pollinator
+     * is certain not to find any flower, given its current position and the largest
+     * move it can make in a step. Only meaningful for the foraging strategies that
+     * search the local neighbourhood for flowers.
+     */
+    int countFlowerlessSteps() const;
+
+    /**
+     * Returns an upper bound on the distance moved by the pollinator in a single step.
+     */
+    float getMaxMoveLength() const;
+
     /**
      * Move in a random direction by a distance determined by m_fStepLength.
      */
@@ -318,6 +382,12 @@ protected:
     static float getVisHexDistance(const VisualStimulusInfo& infoStimulus, const VisualStimulusInfo& infoTarget,
                                    bool usePureSpectralPoints = false);
 
+    /**
+     * Convert a distance in hexagonal colour space between a stimulus and a target into
+     * a confidence level that the two match, according to the vis-match parameters
+     */
+    static float getVisMatchConfidence(float hexDistance);
+
 
     // protected data members
     unsigned int    m_id;       ///< Unique ID number for this pollinator
@@ -332,11 +402,17 @@ protected:
     PollinatorLatestAction m_LatestAction;      ///< Record of the latest action made by the pollinator,
                                                 ///<   updated at each step
 
+    PollinatorStepCounts m_StepCounts;          ///< Counts of the pollinator's foraging steps that have not
+                                                ///<   yet been collected by the model (see transferStepCounts())
+
+    int             m_iNumFlowerlessSteps;      ///< Number of forthcoming steps on which the pollinator is too far
+                                                ///<   from any flower to find one (see countFlowerlessSteps())
+
     int             m_iNumFlowersVisitedInBout; ///< Number of flowers visited so far in current bout
 
     int             m_iCollectedNectar;         ///< Total amount of nectar currently collected from flowers
 
-    PollenVector    m_PollenStore;              ///< Container for Pollen currently being carried
+    PollenStore     m_PollenStore;              ///< Container for Pollen currently being carried
 
     iPos            m_MovementAreaTopLeft;      ///< Boundary of area in which pollinator is allowed to move
                                                 ///<  (see AbstractHive::getInitForageAreaTopLeft() for
@@ -361,10 +437,10 @@ protected:
     unsigned int    m_uiVisitedFlowerMemorySize;///< The maximum number of recently visited flowers that
                                                 ///<   the pollinator can remember
 
-    std::vector<Flower*> m_RecentlyVisitedFlowers;  ///< A record of the ids for recently visited
-                                                    ///<   flowers (up to maximum length defined
+    VisitedFlowerMemory m_RecentlyVisitedFlowers;   ///< A record of recently visited flowers
+                                                    ///<   (up to maximum length defined
                                                     ///<   by m_uiVisitedFlowerMemorySize)
-                                                    ///<   NB: this vector records individual Flower ids,
+                                                    ///<   NB: this records individual Flowers,
                                                     ///<   in contrast to m_PreviousLandingSpeciesId
                                                     ///<   which records the previous *speciesId*
 
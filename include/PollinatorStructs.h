@@ -2,12 +2,17 @@
  * @file
  *
  * Declaration of structs associated with Pollinators:
- * PollinatorPerformanceInfo, VisualStimulusInfo, VisualPreferenceInfo
+ * PollinatorPerformanceInfo, PollinatorStepCounts, VisualStimulusInfo,
+ * VisualPreferenceInfo, VisitedFlowerMemory, PollinatorLatestAction
  */
 
 #ifndef _POLLINATORSTRUCTS_H
 #define _POLLINATORSTRUCTS_H
 
+#include <vector>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
 #include "PollinatorEnums.h"
 #include "ReflectanceInfo.h"
 #include "Flower.h"
@@ -25,6 +30,31 @@ struct PollinatorPerformanceInfo {
 };
 
 
+/**
+ * The PollinatorStepCounts struct
+ * Counts of the foraging steps taken by one or more pollinators, broken down by
+ * the outcome of each step (see Pollinator::step())
+ */
+struct PollinatorStepCounts {
+    PollinatorStepCounts() : numSteps(0), numFlowerVisits(0), numLandingsDeclined(0), numNoFlowerSeen(0) {}
+    inline void reset() {numSteps = 0; numFlowerVisits = 0; numLandingsDeclined = 0; numNoFlowerSeen = 0;}
+
+    PollinatorStepCounts& operator+=(const PollinatorStepCounts& other)
+    {
+        numSteps += other.numSteps;
+        numFlowerVisits += other.numFlowerVisits;
+        numLandingsDeclined += other.numLandingsDeclined;
+        numNoFlowerSeen += other.numNoFlowerSeen;
+        return *this;
+    }
+
+    unsigned long numSteps;             ///< number of foraging steps taken
+    unsigned long numFlowerVisits;      ///< number of steps on which a flower was visited
+    unsigned long numLandingsDeclined;  ///< number of steps on which a flower was found but not landed on
+    unsigned long numNoFlowerSeen;      ///< number of steps on which no candidate flower was found
+};
+
+
 /**
  * The VisualStimulusInfo struct
  * Defines data associated with pollinator's visual system and hexagon colour representation.
@@ -69,10 +99,10 @@ struct VisualStimulusInfo {
  */
 struct VisualPreferenceInfo {
     VisualPreferenceInfo() : lambda(NO_MARKER_POINT), pVisStimInfo(nullptr),
-        probLandTarget(1.0), probLandNonTarget(1.0), baseProbLandTarget(1.0), baseProbLandNonTarget(1.0) {}
+        probLandTarget(1.0), probLandNonTarget(1.0), attenuationStamp(0), baseProbLandTarget(1.0), baseProbLandNonTarget(1.0) {}
 
     VisualPreferenceInfo(Wavelength _lambda, float _baseProbLandTarget, float _baseProbLandNonTarget)
-        : lambda(_lambda), pVisStimInfo(nullptr),
+        : lambda(_lambda), pVisStimInfo(nullptr), attenuationStamp(0),
           baseProbLandTarget((_baseProbLandTarget < 0.0) ? 0.0 : ((_baseProbLandTarget > 1.0) ? 1.0 : _baseProbLandTarget)),
           baseProbLandNonTarget((_baseProbLandNonTarget < 0.0) ? 0.0 : ((_baseProbLandNonTarget > 1.0) ? 1.0 : _baseProbLandNonTarget))
     {
@@ -81,7 +111,7 @@ struct VisualPreferenceInfo {
     }
 
     VisualPreferenceInfo(const VisualStimulusInfo* _pVisStimInfo, float _baseProbLandTarget, float _baseProbLandNonTarget)
-        : lambda(_pVisStimInfo->getWavelength()), pVisStimInfo(_pVisStimInfo),
+        : lambda(_pVisStimInfo->getWavelength()), pVisStimInfo(_pVisStimInfo), attenuationStamp(0),
           baseProbLandTarget((_baseProbLandTarget < 0.0) ? 0.0 : ((_baseProbLandTarget > 1.0) ? 1.0 : _baseProbLandTarget)),
           baseProbLandNonTarget((_baseProbLandNonTarget < 0.0) ? 0.0 : ((_baseProbLandNonTarget > 1.0) ? 1.0 : _baseProbLandNonTarget))
     {
@@ -130,6 +160,24 @@ struct VisualPreferenceInfo {
         constrainProbLandNonTarget();
     }
 
+    /**
+     * Apply numRounds successive decrements of delta to probLandNonTarget, exactly as if
+     * decrementProbLandNonTarget(delta) had been called numRounds times
+     */
+    void attenuateProbLandNonTarget(int numRounds, float delta)
+    {
+        for (; numRounds > 0; --numRounds)
+        {
+            float prevProbLandNonTarget = probLandNonTarget;
+            decrementProbLandNonTarget(delta);
+            if (probLandNonTarget == prevProbLandNonTarget)
+            {
+                // the value has reached a fixed point, so further rounds will not change it
+                break;
+            }
+        }
+    }
+
     void setAsTarget()
     {
         probLandTarget = baseProbLandTarget;
@@ -168,6 +216,7 @@ struct VisualPreferenceInfo {
     {
         probLandTarget = baseProbLandTarget;
         probLandNonTarget = baseProbLandNonTarget;
+        attenuationStamp = 0;
     }
 
 private:
@@ -186,11 +235,175 @@ public:
                                 ///> if it thinks the marker point does not match its current target. Expressed as a number between 0.0 - 1.0.
                                 ///> Note that prefTarget and prefNonTarget are independent and do not need to sum to 1.0.
 
+    int attenuationStamp;       ///> The number of the pollinator's preference attenuation rounds that have already been
+                                ///> applied to (or skipped by) probLandNonTarget. Rounds after this are applied lazily
+                                ///> when the preference is next used (see Hymenoptera::attenuatePreferences()).
+
     const float baseProbLandTarget;     ///> The pollinators base value for probLandTarget before any learning has occured (or after a reset)
     const float baseProbLandNonTarget;  ///> This pollinator's base value for probLandNonTarget before any learning has occured (or after a reset)
 };
 
 
+/**
+ * The VisitedFlowerMemory struct
+ * Records the flowers most recently visited by a pollinator, up to a fixed memory size.
+ * Flowers are remembered in the order in which they were visited, and when the memory
+ * is full the oldest flower is forgotten to make room for the newest (FIFO).
+ * As well as the ordered list, a small open-addressed hash table of the remembered
+ * flowers is maintained, so that contains() is a constant time operation regardless
+ * of the memory size.
+ */
+struct VisitedFlowerMemory {
+    using const_iterator = std::vector<Flower*>::const_iterator;
+
+    VisitedFlowerMemory() : memorySize(0), mask(0) {}
+
+    explicit VisitedFlowerMemory(unsigned int _memorySize) : memorySize(_memorySize), mask(0)
+    {
+        // size the hash table to a power of two that is at least twice the memory size,
+        // to keep the load factor (and therefore the probe lengths) low
+        size_t capacity = 8;
+        while (capacity < 2 * (size_t)memorySize)
+        {
+            capacity <<= 1;
+        }
+        slots.assign(capacity, HashSlot());
+        mask = capacity - 1;
+        flowers.reserve(memorySize + 1);
+    }
+
+    /// Is the given flower currently remembered?
+    bool contains(const Flower* pFlower) const
+    {
+        if (flowers.empty())
+        {
+            return false;
+        }
+
+        for (size_t i = hashIdx(pFlower); slots[i].pFlower != nullptr; i = (i + 1) & mask)
+        {
+            if (slots[i].pFlower == pFlower)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /// Record a visit to the given flower, forgetting the oldest remembered flower if necessary
+    void remember(Flower* pFlower)
+    {
+        if (memorySize == 1)
+        {
+            if (!flowers.empty())
+            {
+                hashErase(flowers[0]);
+                flowers.clear();
+            }
+            flowers.push_back(pFlower);
+            hashInsert(pFlower);
+        }
+        else if (memorySize > 1)
+        {
+            flowers.push_back(pFlower);
+            hashInsert(pFlower);
+            if (flowers.size() > memorySize)
+            {
+                hashErase(flowers.front());
+                flowers.erase(flowers.begin());
+            }
+        }
+    }
+
+    void clear()
+    {
+        if (!flowers.empty())
+        {
+            std::fill(slots.begin(), slots.end(), HashSlot());
+            flowers.clear();
+        }
+    }
+
+    bool   empty() const {return flowers.empty();}
+    size_t size() const  {return flowers.size();}
+
+    const_iterator begin() const {return flowers.begin();}  ///< iterate from oldest to newest
+    const_iterator end() const   {return flowers.end();}
+
+private:
+    struct HashSlot {
+        HashSlot() : pFlower(nullptr), count(0) {}
+        const Flower* pFlower;
+        unsigned int count;     ///< number of times this flower appears in the ordered list
+    };
+
+    size_t hashIdx(const Flower* pFlower) const
+    {
+        // Fibonacci hashing of the pointer value (the low bits are dropped as they are
+        // always zero due to alignment)
+        uint64_t h = ((uint64_t)(uintptr_t)pFlower >> 3) * 0x9E3779B97F4A7C15ULL;
+        return (size_t)(h >> 32) & mask;
+    }
+
+    void hashInsert(const Flower* pFlower)
+    {
+        size_t i = hashIdx(pFlower);
+        while ((slots[i].pFlower != nullptr) && (slots[i].pFlower != pFlower))
+        {
+            i = (i + 1) & mask;
+        }
+        slots[i].pFlower = pFlower;
+        ++(slots[i].count);
+    }
+
+    void hashErase(const Flower* pFlower)
+    {
+        size_t i = hashIdx(pFlower);
+        while (slots[i].pFlower != pFlower)
+        {
+            assert(slots[i].pFlower != nullptr);
+            i = (i + 1) & mask;
+        }
+
+        if (--(slots[i].count) > 0)
+        {
+            return;
+        }
+
+        // remove the entry using backward-shift deletion, so that no tombstones are
+        // needed and subsequent lookups still find entries further along the probe chain
+        size_t j = i;
+        while (true)
+        {
+            slots[i] = HashSlot();
+            while (true)
+            {
+                j = (j + 1) & mask;
+                if (slots[j].pFlower == nullptr)
+                {
+                    return;
+                }
+                size_t k = hashIdx(slots[j].pFlower);
+                // move slots[j] back to i unless its home slot k lies cyclically in (i, j]
+                if ((i <= j) ? ((i < k) && (k <= j)) : ((i < k) || (k <= j)))
+                {
+                    continue;
+                }
+                break;
+            }
+            slots[i] = slots[j];
+            i = j;
+        }
+    }
+
+    unsigned int          memorySize;   ///< The maximum number of flowers remembered
+    std::vector<Flower*>  flowers;      ///< Remembered flowers, ordered from oldest to newest
+    std::vector<HashSlot> slots;        ///< Open-addressed (linear probing) hash table of remembered flowers
+    size_t                mask;         ///< slots.size()-1 (slots.size() is always a power of two)
+};
+
+
 struct PollinatorLatestAction
 {
     PollinatorLatestAction() :
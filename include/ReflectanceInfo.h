@@ -28,21 +28,29 @@ enum class ColourSystem {
 class ReflectanceInfo {
 
 public:
-    ReflectanceInfo() : m_MarkerPoint(NO_MARKER_POINT), m_pVisDataPtr(nullptr) {};
-    ReflectanceInfo(const ReflectanceInfo& other) : m_MarkerPoint(other.m_MarkerPoint), m_pVisDataPtr(other.m_pVisDataPtr) {};
+    ReflectanceInfo() : m_MarkerPoint(NO_MARKER_POINT), m_pVisDataPtr(nullptr), m_iVisDataIdx(-1) {};
+    ReflectanceInfo(const ReflectanceInfo& other) : m_MarkerPoint(other.m_MarkerPoint), m_pVisDataPtr(other.m_pVisDataPtr),
+                                                    m_iVisDataIdx(other.m_iVisDataIdx) {};
     //ReflectanceInfo(MarkerPoint mp) : m_MarkerPoint(mp) {};
-    ReflectanceInfo(MarkerPoint mp, const VisualStimulusInfo* pVSI) : m_MarkerPoint(mp), m_pVisDataPtr(pVSI) {};
+    ReflectanceInfo(MarkerPoint mp, const VisualStimulusInfo* pVSI) : m_MarkerPoint(mp), m_pVisDataPtr(pVSI), m_iVisDataIdx(-1) {};
 
     bool hasMarkerPoint() const {return m_MarkerPoint != NO_MARKER_POINT;}
     MarkerPoint getMarkerPoint() const {return m_MarkerPoint;}
-    void setMarkerPoint(MarkerPoint mp) {m_MarkerPoint = mp;}
+    void setMarkerPoint(MarkerPoint mp) {m_MarkerPoint = mp; m_iVisDataIdx = -1;}
 
     const VisualStimulusInfo* getVisDataPtr() const {return m_pVisDataPtr;}
-    void setVisDataPtr(const VisualStimulusInfo* pVSI) {m_pVisDataPtr = pVSI;}
+    void setVisDataPtr(const VisualStimulusInfo* pVSI) {m_pVisDataPtr = pVSI; m_iVisDataIdx = -1;}
+
+    /**
+     * Returns the cached index in the vis-data of the first entry with this stimulus's
+     * characteristic wavelength, or -1 if this has not been set (see ModelParams::getVisDataIdx())
+     */
+    int getVisDataIdx() const {return m_iVisDataIdx;}
+    void setVisDataIdx(int idx) {m_iVisDataIdx = idx;}
 
     Wavelength getCharacteristicWavelength() const;
 
-    void reset() {m_MarkerPoint = NO_MARKER_POINT; m_pVisDataPtr = nullptr;}
+    void reset() {m_MarkerPoint = NO_MARKER_POINT; m_pVisDataPtr = nullptr; m_iVisDataIdx = -1;}
 
 private:
     MarkerPoint m_MarkerPoint; ///< This is only used when ColourSystem == REGULAR_MARKER_POINTS
@@ -53,6 +61,9 @@ private:
                                              ///<   ModelParams::pairPlantTypeConfigsToVisData()).
                                              ///<   This is only used when ColourSystem == ARBITRARY_DOMINANT_WAVELENGTHS
 
+    int m_iVisDataIdx;  ///< Cached index of the vis-data entry used to look up a pollinator's perception of and
+                        ///<   preference for this stimulus. This is set when a Flower is created, and is reset
+                        ///<   to -1 (meaning not known) whenever the marker point or vis-data pointer changes.
 
 };
 
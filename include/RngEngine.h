@@ -0,0 +1,139 @@
+/**
+ * @file
+ *
+ * Declaration of the RngEngine class
+ */
+
+#ifndef _RNGENGINE_H
+#define _RNGENGINE_H
+
+#include <random>
+#include <array>
+#include <cstdint>
+
+class CheckpointWriter;
+class CheckpointReader;
+
+/**
+ * Definition of the different random number generator algorithms available
+ */
+enum class RngType {
+    MT19937,    ///< A single sequential Mersenne Twister stream (the original EvoBee behaviour)
+    PHILOX      ///< Counter-based Philox4x32-10 generator, with independent streams per model component
+};
+
+/**
+ * The purposes for which independent random number streams are drawn when using
+ * a counter-based generator. Each purpose is mixed into the generator key, so
+ * streams for different purposes never overlap even if their counters coincide.
+ */
+enum class RngStreamPurpose : std::uint32_t {
+    GLOBAL = 0,                 ///< Any draws made outside of a more specific stream
+    PLANT_INITIALISATION,       ///< Placement of the initial population of plants
+    POLLINATOR_INITIALISATION,  ///< Construction of hives and pollinators
+    POLLINATOR_SCHEDULING,      ///< Order in which pollinators are stepped
+    POLLINATOR_STEP,            ///< A single step of an individual pollinator
+    POLLINATOR_RESET,           ///< Resetting an individual pollinator at the start of a generation
+    REPRODUCTION                ///< Construction of a new generation of plants
+};
+
+/**
+ * The RngEngine class is the random number engine used throughout the model.
+ *
+ * It satisfies the requirements of a UniformRandomBitGenerator with the same
+ * output range as std::mt19937, so it can be passed directly to the standard
+ * library distributions and algorithms.
+ *
+ * In RngType::MT19937 mode it simply wraps a std::mt19937 engine, so results are
+ * identical to those of earlier versions of EvoBee for a given seed. In
+ * RngType::PHILOX mode it uses the counter-based Philox4x32-10 algorithm
+ * (Salmon et al. 2011), keyed by the seed string, and setStream() selects an
+ * independent stream identified by (purpose, generation, step, id). The numbers
+ * drawn from a stream therefore depend only on the seed and the stream's
+ * identity, and not on the order in which different streams are consumed.
+ */
+class RngEngine {
+
+public:
+    using result_type = std::uint32_t;
+
+    RngEngine();
+
+    static constexpr result_type min() {return 0;}
+    static constexpr result_type max() {return 0xFFFFFFFF;}
+
+    /**
+     * Return the next random number from the current stream
+     */
+    result_type operator()()
+    {
+        if (m_Type == RngType::MT19937)
+        {
+            return static_cast<result_type>(m_MtEngine());
+        }
+        if (m_iBufferPos == m_Buffer.size())
+        {
+            generateBlock();
+        }
+        return m_Buffer[m_iBufferPos++];
+    }
+
+    /**
+     * Seed the engine. In PHILOX mode the key is derived from the seed sequence,
+     * and the stream is reset to RngStreamPurpose::GLOBAL.
+     */
+    void seed(std::seed_seq& seq);
+
+    /**
+     * Select the algorithm used by the engine. This should be called before seed().
+     */
+    void setType(RngType type) {m_Type = type;}
+
+    RngType getType() const {return m_Type;}
+
+    /**
+     * Select the stream from which subsequent numbers are drawn, and rewind it to
+     * its start. This has no effect in MT19937 mode, where all numbers are drawn
+     * from a single sequential stream.
+     */
+    void setStream(RngStreamPurpose purpose,
+                   std::uint32_t gen = 0,
+                   std::uint32_t step = 0,
+                   std::uint32_t id = 0)
+    {
+        if (m_Type == RngType::PHILOX)
+        {
+            m_Counter = {0, id, gen, step};
+            m_StreamKey = {m_Key[0], m_Key[1] ^ (static_cast<std::uint32_t>(purpose) * 0x9E3779B9u)};
+            m_iBufferPos = m_Buffer.size();
+        }
+    }
+
+    /**
+     * Write the complete state of the engine (in either mode) to a checkpoint
+     */
+    void saveState(CheckpointWriter& writer) const;
+
+    /**
+     * Restore the state of the engine from a checkpoint. Throws std::runtime_error
+     * if the checkpoint was written by an engine of a different type.
+     */
+    void loadState(CheckpointReader& reader);
+
+private:
+    /**
+     * Fill m_Buffer with the Philox output for the current counter, then
+     * advance the block counter
+     */
+    void generateBlock();
+
+    RngType             m_Type;         ///< Algorithm in use
+    std::mt19937        m_MtEngine;     ///< Engine used in MT19937 mode
+    std::array<std::uint32_t, 2> m_Key;         ///< Philox key derived from the seed
+    std::array<std::uint32_t, 2> m_StreamKey;   ///< m_Key mixed with the current stream purpose
+    std::array<std::uint32_t, 4> m_Counter;     ///< Philox counter {block, id, gen, step}
+    std::array<std::uint32_t, 4> m_Buffer;      ///< Output of the most recently generated block
+    std::size_t         m_iBufferPos;   ///< Index of next unused value in m_Buffer
+};
+
+#endif /* _RNGENGINE_H */
@@ -0,0 +1,274 @@
+/**
+ * @file
+ *
+ * Declaration and implementation of the SmallVector class template
+ */
+
+#ifndef _SMALLVECTOR_H
+#define _SMALLVECTOR_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+#include <cassert>
+
+
+/**
+ * The SmallVector class template is a vector-like container that holds up to N
+ * elements inline (i.e. within the SmallVector object itself), and only allocates
+ * storage (using the specified allocator) when it has to hold more than that.
+ *
+ * This is used for the flowers of a plant and the pollen on a stigma, where the
+ * number of elements is usually small and known in advance (see FloweringPlant
+ * and Flower). Only the small subset of the std::vector interface that is needed
+ * by the rest of the code is provided. Iterators are plain pointers, and are
+ * invalidated whenever the container grows or is moved.
+ */
+template<typename T, std::size_t N, typename Alloc = std::allocator<T>>
+class SmallVector {
+
+    static_assert(N > 0, "SmallVector must have an inline capacity of at least one element");
+
+    using AllocTraits = std::allocator_traits<Alloc>;
+
+public:
+    using value_type = T;
+    using allocator_type = Alloc;
+    using size_type = std::size_t;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    explicit SmallVector(const Alloc& alloc = Alloc()) :
+        m_Alloc(alloc),
+        m_pData(inlineData()),
+        m_iSize(0),
+        m_iCapacity(N)
+    {}
+
+    SmallVector(const SmallVector& other) :
+        m_Alloc(AllocTraits::select_on_container_copy_construction(other.m_Alloc)),
+        m_pData(inlineData()),
+        m_iSize(0),
+        m_iCapacity(N)
+    {
+        copyElementsFrom(other);
+    }
+
+    SmallVector(SmallVector&& other) noexcept :
+        m_Alloc(std::move(other.m_Alloc)),
+        m_pData(inlineData()),
+        m_iSize(0),
+        m_iCapacity(N)
+    {
+        takeElementsFrom(other);
+    }
+
+    ~SmallVector()
+    {
+        clear();
+        releaseStorage();
+    }
+
+    SmallVector& operator= (const SmallVector& other)
+    {
+        if (this != &other)
+        {
+            clear();
+            if constexpr (AllocTraits::propagate_on_container_copy_assignment::value)
+            {
+                if (m_Alloc != other.m_Alloc)
+                {
+                    releaseStorage();
+                }
+                m_Alloc = other.m_Alloc;
+            }
+            copyElementsFrom(other);
+        }
+        return *this;
+    }
+
+    SmallVector& operator= (SmallVector&& other) noexcept
+    {
+        if (this != &other)
+        {
+            clear();
+            if constexpr (AllocTraits::propagate_on_container_move_assignment::value)
+            {
+                releaseStorage();
+                m_Alloc = std::move(other.m_Alloc);
+            }
+            takeElementsFrom(other);
+        }
+        return *this;
+    }
+
+    iterator begin() {return m_pData;}
+    iterator end() {return m_pData + m_iSize;}
+    const_iterator begin() const {return m_pData;}
+    const_iterator end() const {return m_pData + m_iSize;}
+
+    T* data() {return m_pData;}
+    const T* data() const {return m_pData;}
+
+    T& operator[](size_type idx) {assert(idx < m_iSize); return m_pData[idx];}
+    const T& operator[](size_type idx) const {assert(idx < m_iSize); return m_pData[idx];}
+
+    T& back() {assert(m_iSize > 0); return m_pData[m_iSize-1];}
+    const T& back() const {assert(m_iSize > 0); return m_pData[m_iSize-1];}
+
+    size_type size() const {return m_iSize;}
+    size_type capacity() const {return m_iCapacity;}
+    bool empty() const {return (m_iSize == 0);}
+
+    /**
+     * Returns true if the elements are currently held inline, without any allocated storage
+     */
+    bool isInline() const {return (m_pData == inlineData());}
+
+    allocator_type get_allocator() const {return m_Alloc;}
+
+    /**
+     * Make sure that the container can hold at least num elements without growing
+     */
+    void reserve(size_type num)
+    {
+        if (num > m_iCapacity)
+        {
+            T* pNew = AllocTraits::allocate(m_Alloc, num);
+            moveElementsTo(pNew);
+            deallocateStorage();
+            m_pData = pNew;
+            m_iCapacity = num;
+        }
+    }
+
+    template<typename... Args>
+    T& emplace_back(Args&&... args)
+    {
+        if (m_iSize < m_iCapacity)
+        {
+            AllocTraits::construct(m_Alloc, m_pData + m_iSize, std::forward<Args>(args)...);
+        }
+        else
+        {
+            // the new element is constructed before the existing ones are moved, in case
+            // any of the arguments refer to an existing element
+            size_type newCapacity = std::max(2 * m_iCapacity, m_iSize + 1);
+            T* pNew = AllocTraits::allocate(m_Alloc, newCapacity);
+            AllocTraits::construct(m_Alloc, pNew + m_iSize, std::forward<Args>(args)...);
+            moveElementsTo(pNew);
+            deallocateStorage();
+            m_pData = pNew;
+            m_iCapacity = newCapacity;
+        }
+        return m_pData[m_iSize++];
+    }
+
+    void push_back(const T& val) {emplace_back(val);}
+    void push_back(T&& val) {emplace_back(std::move(val));}
+
+    /**
+     * Destroy all of the elements. Any allocated storage is kept for reuse.
+     */
+    void clear() noexcept
+    {
+        for (size_type i = 0; i < m_iSize; ++i)
+        {
+            AllocTraits::destroy(m_Alloc, m_pData + i);
+        }
+        m_iSize = 0;
+    }
+
+private:
+    T* inlineData() {return reinterpret_cast<T*>(m_Inline);}
+    const T* inlineData() const {return reinterpret_cast<const T*>(m_Inline);}
+
+    /**
+     * Move the elements to the uninitialised storage at pDest, and destroy the originals
+     * (m_iSize is left unchanged)
+     */
+    void moveElementsTo(T* pDest) noexcept
+    {
+        static_assert(std::is_nothrow_move_constructible<T>::value,
+            "SmallVector elements must be nothrow move constructible");
+
+        for (size_type i = 0; i < m_iSize; ++i)
+        {
+            AllocTraits::construct(m_Alloc, pDest + i, std::move(m_pData[i]));
+            AllocTraits::destroy(m_Alloc, m_pData + i);
+        }
+    }
+
+    /**
+     * Give back the allocated storage (if any) that m_pData points to, without
+     * touching the elements or resetting m_pData
+     */
+    void deallocateStorage() noexcept
+    {
+        if (!isInline())
+        {
+            AllocTraits::deallocate(m_Alloc, m_pData, m_iCapacity);
+        }
+    }
+
+    /**
+     * Give back any allocated storage and revert to the inline storage. The container
+     * must be empty.
+     */
+    void releaseStorage() noexcept
+    {
+        assert(m_iSize == 0);
+        deallocateStorage();
+        m_pData = inlineData();
+        m_iCapacity = N;
+    }
+
+    /**
+     * Append copies of the elements of other (this container must be empty)
+     */
+    void copyElementsFrom(const SmallVector& other)
+    {
+        reserve(other.m_iSize);
+        for (const T& elem : other)
+        {
+            AllocTraits::construct(m_Alloc, m_pData + m_iSize, elem);
+            ++m_iSize;
+        }
+    }
+
+    /**
+     * Take the elements of other (this container must be empty), leaving other empty.
+     * Allocated storage is taken over directly if our allocator can free it, otherwise
+     * the elements are moved one by one.
+     */
+    void takeElementsFrom(SmallVector& other) noexcept
+    {
+        if (!other.isInline() && isInline() && (m_Alloc == other.m_Alloc))
+        {
+            m_pData = other.m_pData;
+            m_iSize = other.m_iSize;
+            m_iCapacity = other.m_iCapacity;
+            other.m_pData = other.inlineData();
+            other.m_iSize = 0;
+            other.m_iCapacity = N;
+        }
+        else
+        {
+            reserve(other.m_iSize);
+            other.moveElementsTo(m_pData);
+            m_iSize = other.m_iSize;
+            other.m_iSize = 0;
+        }
+    }
+
+    Alloc       m_Alloc;        ///< Allocator used when the elements do not fit inline
+    T*          m_pData;        ///< Pointer to the elements (either m_Inline or allocated storage)
+    size_type   m_iSize;        ///< Number of elements held
+    size_type   m_iCapacity;    ///< Number of elements that can be held without growing
+    alignas(T) unsigned char m_Inline[N * sizeof(T)];  ///< Inline storage for up to N elements
+};
+
+#endif /* _SMALLVECTOR_H */
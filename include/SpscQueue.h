@@ -0,0 +1,96 @@
+/**
+ * @file
+ *
+ * Declaration and implementation of the SpscQueue class template
+ */
+
+#ifndef _SPSCQUEUE_H
+#define _SPSCQUEUE_H
+
+#include <vector>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+/**
+ * The SpscQueue class template is a bounded, lock-free, single-producer
+ * single-consumer FIFO queue, implemented as a ring buffer.
+ *
+ * tryPush() must only be called from one (producer) thread and tryPop() from one
+ * (consumer) thread. Neither method ever blocks; callers are responsible for
+ * deciding what to do when the queue is full or empty.
+ */
+template<typename T>
+class SpscQueue {
+
+public:
+    /**
+     * Constructor. The queue can hold up to capacity items.
+     */
+    explicit SpscQueue(std::size_t capacity) :
+        m_Buffer(capacity + 1),
+        m_iHead(0),
+        m_iTail(0)
+    {}
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    /**
+     * Attempt to add an item to the back of the queue. Returns false (leaving
+     * item unchanged) if the queue is full.
+     */
+    bool tryPush(T& item)
+    {
+        std::size_t tail = m_iTail.load(std::memory_order_relaxed);
+        std::size_t next = increment(tail);
+        if (next == m_iHead.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        m_Buffer[tail] = std::move(item);
+        m_iTail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Attempt to remove the item at the front of the queue. Returns false if
+     * the queue is empty.
+     */
+    bool tryPop(T& item)
+    {
+        std::size_t head = m_iHead.load(std::memory_order_relaxed);
+        if (head == m_iTail.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        item = std::move(m_Buffer[head]);
+        m_iHead.store(increment(head), std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Returns the number of items currently in the queue. This is only an
+     * estimate if called while the other thread is using the queue.
+     */
+    std::size_t size() const
+    {
+        std::size_t head = m_iHead.load(std::memory_order_acquire);
+        std::size_t tail = m_iTail.load(std::memory_order_acquire);
+        return (tail >= head) ? (tail - head) : (tail + m_Buffer.size() - head);
+    }
+
+    /**
+     * Returns the maximum number of items the queue can hold
+     */
+    std::size_t capacity() const {return m_Buffer.size() - 1;}
+
+private:
+    std::size_t increment(std::size_t idx) const {return (idx + 1 == m_Buffer.size()) ? 0 : idx + 1;}
+
+    std::vector<T> m_Buffer;            ///< Ring buffer (one slot is always left empty)
+    alignas(64) std::atomic<std::size_t> m_iHead; ///< Index of next item to pop (written by consumer)
+    alignas(64) std::atomic<std::size_t> m_iTail; ///< Index of next free slot (written by producer)
+};
+
+#endif /* _SPSCQUEUE_H */
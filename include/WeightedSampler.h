@@ -0,0 +1,74 @@
+/**
+ * @file
+ *
+ * Declaration of the WeightedSampler class
+ */
+
+#ifndef _WEIGHTEDSAMPLER_H
+#define _WEIGHTEDSAMPLER_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+
+/**
+ * The WeightedSampler class draws items at random, without replacement, from a
+ * multiset in which item i (for i = 0..n-1) appears weight[i] times. Each draw
+ * returns item i with probability proportional to its remaining weight, and then
+ * reduces that weight by one, so a sequence of draws has the same distribution as
+ * a walk through a shuffled vector holding weight[i] copies of each item i.
+ *
+ * Items are proposed using Walker's alias method over the weights at the time the
+ * alias table was built, and a proposed item is accepted with probability equal to
+ * its remaining weight divided by its weight in the table. The table is rebuilt from
+ * the remaining weights whenever their total falls to half of the table's total, so
+ * each draw takes constant expected time, and the cost of setting up the sampler is
+ * proportional to the number of items rather than to their total weight.
+ */
+class WeightedSampler {
+
+public:
+    /**
+     * Construct a sampler for items with the given weights (items with zero
+     * weight are never drawn)
+     */
+    explicit WeightedSampler(std::vector<unsigned int> weights);
+
+    /**
+     * Is there any weight left to draw?
+     */
+    bool empty() const {return (m_iRemainingWeight == 0);}
+
+    /**
+     * Returns the total weight of all items that have not yet been drawn
+     */
+    std::uint64_t getRemainingWeight() const {return m_iRemainingWeight;}
+
+    /**
+     * Draw an item at random, in proportion to the remaining weights, and reduce
+     * its weight by one. Throws an exception if the sampler is empty.
+     *
+     * @return The index of the item drawn
+     */
+    std::size_t draw();
+
+private:
+    /**
+     * (Re)build the alias table from the current remaining weights
+     */
+    void buildAliasTable();
+
+    std::vector<unsigned int>  m_Weights;          ///< Remaining weight of each item
+    std::uint64_t              m_iRemainingWeight; ///< Total of m_Weights
+
+    std::vector<std::size_t>   m_TableItems;       ///< Items with nonzero weight when the table was built
+    std::vector<unsigned int>  m_TableWeights;     ///< Weights of m_TableItems when the table was built
+    std::uint64_t              m_iTableWeight;     ///< Total of m_TableWeights
+    std::vector<std::uint64_t> m_Thresholds;       ///< Each column of the table has m_iTableWeight slots, of
+                                                   ///<   which the first m_Thresholds[col] belong to the column's
+                                                   ///<   own entry and the rest to the entry m_Aliases[col]
+    std::vector<std::size_t>   m_Aliases;          ///< Alias entry of each column of the table
+};
+
+#endif /* _WEIGHTEDSAMPLER_H */
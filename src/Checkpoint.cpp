@@ -0,0 +1,268 @@
+/**
+ * @file
+ *
+ * Implementation of the CheckpointWriter and CheckpointReader classes
+ */
+
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include "ModelParams.h"
+#include "Hymenoptera.h"
+#include "Flower.h"
+#include "Checkpoint.h"
+
+namespace
+{
+    const char* checkpointMagic = "EVOBEECKPT";
+    const std::uint32_t byteOrderMarker = 0x01020304;
+    const std::uint32_t checkpointVersion = 2;
+    const std::uint32_t endMarker = 0x454E4421; // "END!"
+
+    // VisualStimulusInfo objects live either in the vis-data of the pollinator
+    // config (pointed to by PlantTypeConfigs and flowers) or in the copy of it
+    // held by Hymenoptera (pointed to by pollinator targets)
+    enum class VisDataTable : std::uint8_t {NONE, MODEL_PARAMS, HYMENOPTERA};
+
+    bool inTable(const VisualStimulusInfo* pVSI, const std::vector<VisualStimulusInfo>& table)
+    {
+        return (!table.empty()) && (pVSI >= table.data()) && (pVSI < table.data() + table.size());
+    }
+}
+
+
+CheckpointWriter::CheckpointWriter()
+{
+    m_Buf.append(checkpointMagic);
+    write<std::uint32_t>(byteOrderMarker);
+    write<std::uint32_t>(checkpointVersion);
+}
+
+
+void CheckpointWriter::writeString(const std::string& str)
+{
+    write<std::uint32_t>(str.size());
+    m_Buf.append(str);
+}
+
+
+void CheckpointWriter::writeFlowerHandle(const Flower* pFlower)
+{
+    write<std::uint32_t>((pFlower == nullptr) ? 0 : pFlower->getId());
+}
+
+
+void CheckpointWriter::writePlantTypeConfigHandle(const PlantTypeConfig* pPTC)
+{
+    const std::vector<PlantTypeConfig>& ptcs = ModelParams::getPlantTypeConfigs();
+    if ((pPTC < ptcs.data()) || (pPTC >= ptcs.data() + ptcs.size()))
+    {
+        throw std::runtime_error("Unable to checkpoint a plant with an unknown PlantTypeConfig");
+    }
+    write<std::uint32_t>(pPTC - ptcs.data());
+}
+
+
+void CheckpointWriter::writeVisDataHandle(const VisualStimulusInfo* pVSI)
+{
+    if (pVSI == nullptr)
+    {
+        write<VisDataTable>(VisDataTable::NONE);
+        write<std::uint32_t>(0);
+        return;
+    }
+
+    if (ModelParams::getColourSystem() == ColourSystem::ARBITRARY_DOMINANT_WAVELENGTHS)
+    {
+        const std::vector<VisualStimulusInfo>& visData = ModelParams::getVisData();
+        if (inTable(pVSI, visData))
+        {
+            write<VisDataTable>(VisDataTable::MODEL_PARAMS);
+            write<std::uint32_t>(pVSI - visData.data());
+            return;
+        }
+    }
+
+    const std::vector<VisualStimulusInfo>& hymVisData = Hymenoptera::getVisData();
+    if (inTable(pVSI, hymVisData))
+    {
+        write<VisDataTable>(VisDataTable::HYMENOPTERA);
+        write<std::uint32_t>(pVSI - hymVisData.data());
+        return;
+    }
+
+    throw std::runtime_error("Unable to checkpoint a pointer to unknown vis-data");
+}
+
+
+void CheckpointWriter::writeFile(const std::string& path)
+{
+    write<std::uint32_t>(endMarker);
+
+    std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream ofs(tmpPath, std::ofstream::binary | std::ofstream::trunc);
+        if (!ofs)
+        {
+            std::stringstream msg;
+            msg << "Unable to open checkpoint file " << tmpPath << " for writing";
+            throw std::runtime_error(msg.str());
+        }
+        ofs.write(m_Buf.data(), m_Buf.size());
+        ofs.close();
+        if (!ofs)
+        {
+            std::stringstream msg;
+            msg << "Error writing checkpoint file " << tmpPath;
+            throw std::runtime_error(msg.str());
+        }
+    }
+
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0)
+    {
+        std::stringstream msg;
+        msg << "Unable to rename checkpoint file " << tmpPath << " to " << path;
+        throw std::runtime_error(msg.str());
+    }
+}
+
+
+CheckpointReader::CheckpointReader(const std::string& path) :
+    m_iPos(0)
+{
+    std::ifstream ifs(path, std::ifstream::binary);
+    if (!ifs)
+    {
+        std::stringstream msg;
+        msg << "Unable to open checkpoint file " << path;
+        throw std::runtime_error(msg.str());
+    }
+    std::stringstream contents;
+    contents << ifs.rdbuf();
+    m_Buf = contents.str();
+
+    std::size_t magicLen = std::strlen(checkpointMagic);
+    if ((m_Buf.size() < magicLen) || (m_Buf.compare(0, magicLen, checkpointMagic) != 0))
+    {
+        std::stringstream msg;
+        msg << "File " << path << " is not an EvoBee checkpoint file";
+        throw std::runtime_error(msg.str());
+    }
+    m_iPos = magicLen;
+
+    if (read<std::uint32_t>() != byteOrderMarker)
+    {
+        throw std::runtime_error("Checkpoint file was written on a machine with a different byte order");
+    }
+    if (read<std::uint32_t>() != checkpointVersion)
+    {
+        throw std::runtime_error("Checkpoint file was written with an incompatible version of the checkpoint format");
+    }
+}
+
+
+std::string CheckpointReader::readString()
+{
+    std::uint32_t len = read<std::uint32_t>();
+    need(len);
+    std::string str(m_Buf, m_iPos, len);
+    m_iPos += len;
+    return str;
+}
+
+
+void CheckpointReader::registerFlower(Flower* pFlower)
+{
+    m_FlowerMap[pFlower->getId()] = pFlower;
+}
+
+
+Flower* CheckpointReader::readFlowerHandle()
+{
+    std::uint32_t id = read<std::uint32_t>();
+    if (id == 0)
+    {
+        return nullptr;
+    }
+
+    auto it = m_FlowerMap.find(id);
+    if (it == m_FlowerMap.end())
+    {
+        std::stringstream msg;
+        msg << "Checkpoint refers to unknown flower " << id;
+        throw std::runtime_error(msg.str());
+    }
+    return it->second;
+}
+
+
+const PlantTypeConfig* CheckpointReader::readPlantTypeConfigHandle()
+{
+    std::uint32_t idx = read<std::uint32_t>();
+    const std::vector<PlantTypeConfig>& ptcs = ModelParams::getPlantTypeConfigs();
+    if (idx >= ptcs.size())
+    {
+        throw std::runtime_error("Checkpoint refers to a plant type that is not in the current configuration");
+    }
+    return &(ptcs[idx]);
+}
+
+
+const VisualStimulusInfo* CheckpointReader::readVisDataHandle()
+{
+    VisDataTable table = read<VisDataTable>();
+    std::uint32_t idx = read<std::uint32_t>();
+
+    const std::vector<VisualStimulusInfo>* pVisData = nullptr;
+    switch (table)
+    {
+        case VisDataTable::NONE:
+            return nullptr;
+        case VisDataTable::MODEL_PARAMS:
+            if (ModelParams::getColourSystem() == ColourSystem::ARBITRARY_DOMINANT_WAVELENGTHS)
+            {
+                pVisData = &ModelParams::getVisData();
+            }
+            break;
+        case VisDataTable::HYMENOPTERA:
+            pVisData = &Hymenoptera::getVisData();
+            break;
+    }
+
+    if ((pVisData == nullptr) || (idx >= pVisData->size()))
+    {
+        throw std::runtime_error("Checkpoint refers to vis-data that is not in the current configuration");
+    }
+    return &((*pVisData)[idx]);
+}
+
+
+void CheckpointReader::expectCount(std::size_t count, const char* itemName)
+{
+    std::uint64_t savedCount = read<std::uint64_t>();
+    if (savedCount != count)
+    {
+        std::stringstream msg;
+        msg << "Checkpoint contains " << savedCount << " " << itemName << " but the current configuration has "
+            << count << ". Checkpoints must be resumed with the configuration that created them.";
+        throw std::runtime_error(msg.str());
+    }
+}
+
+
+void CheckpointReader::finish()
+{
+    if ((read<std::uint32_t>() != endMarker) || (m_iPos != m_Buf.size()))
+    {
+        throw std::runtime_error("Checkpoint file contents do not match the checkpoint format");
+    }
+}
+
+
+void CheckpointReader::need(std::size_t numBytes) const
+{
+    if (m_iPos + numBytes > m_Buf.size())
+    {
+        throw std::runtime_error("Checkpoint file is truncated or corrupt");
+    }
+}
@@ -1,9 +1,11 @@
 /**
  * @file
  *
- * Implementation of the Environment class and LocalDensityConstraint class
+ * Implementation of the Environment class, LocalDensityConstraint class and
+ * FlowerSpatialIndex class
  */
 
+#include <algorithm>
 #include <cassert>
 #include <vector>
 #include <iostream>
@@ -20,6 +22,9 @@
 #include "HoneyBee.h"
 #include "Position.h"
 #include "FloweringPlant.h"
+#include "PollinatorStructs.h"
+#include "Checkpoint.h"
+#include "WeightedSampler.h"
 #include "Environment.h"
 
 
@@ -29,8 +34,21 @@ bool LocalDensityConstraint::posInArea(const iPos& pos) const
 }
 
 
+void FlowerSpatialIndex::clear()
+{
+    x.clear();
+    y.clear();
+    flowers.clear();
+    patchStart.clear();
+    patchFlowerDistance.clear();
+}
+
+
 Environment::Environment(EvoBeeModel* pModel) :
     m_bFlowerPtrVectorInitialised(false),
+    m_iNumPlants(0),
+    m_iNumPollinatedPlants(0),
+    m_iCurGenerationBuffer(0),
     m_pModel(pModel)
 {
     assert(ModelParams::initialised());
@@ -53,8 +71,14 @@ Environment::Environment(EvoBeeModel* pModel) :
     }
 
     // Initialise Plants
+    EvoBeeModel::m_sRngEngine.setStream(RngStreamPurpose::PLANT_INITIALISATION);
     initialisePlants();
 
+    // Build the spatial index of flowers used by the neighbourhood search methods,
+    // and initialise the running counts of plants and pollinated plants
+    rebuildFlowerIndex();
+    resetPlantCounts();
+
     // Initialise internal book-keeping for local density limits during plant reproduction
     initialiseLocalDensityCounts();
 
@@ -64,6 +88,7 @@ Environment::Environment(EvoBeeModel* pModel) :
     //  any no-go areas in the environemnt, which we might have to take account of when
     //  deciding the initial placement of the pollinators from the hive.
     //
+    EvoBeeModel::m_sRngEngine.setStream(RngStreamPurpose::POLLINATOR_INITIALISATION);
     const std::vector<HiveConfig> & hconfigs = ModelParams::getHiveConfigs();
     for (const HiveConfig& hconfig : hconfigs)
     {
@@ -106,16 +131,21 @@ Patch& Environment::getPatch(int x, int y)
  *
  * This method is somewhat convoluted for efficiency purposes. Having figured out how
  * many plants in total should be created, it then randomly assigns positions for each
- * plant. These positions are stored in the patchInfo[][] array, where each element in
- * the array is a vector containing the positions of all new plants that fall within
- * that patch. We then loop through the patchInfo array, and for each vector contained therein,
- * we create all of the plants for the associated patch.
+ * plant. These positions are then sorted by patch (with a counting sort) into a single
+ * buffer, in which the positions of all new plants that fall within each patch are
+ * stored together. We then loop through the patches, and for each one, we create all
+ * of the plants whose positions are stored in that patch's section of the buffer.
+ * (This keeps all of the working data on the heap, however large the distribution area.)
+ * Once the plants for all distributions have been created, they are installed as the
+ * first generation (see installNewPlants()).
  */
 void Environment::initialisePlants()
 {
     const std::vector<PlantTypeDistributionConfig>& pdconfigs =
         ModelParams::getPlantTypeDistributionConfigs();
 
+    GenerationArena& arena = getNextGenerationArena();
+
     for (const PlantTypeDistributionConfig& pdcfg : pdconfigs)
     {
         // calculate some basic values associated with the requested distribution
@@ -126,9 +156,13 @@ void Environment::initialisePlants()
         std::uniform_real_distribution<float> distW(0.0, w - EvoBee::SMALL_FLOAT_NUMBER);
         std::uniform_real_distribution<float> distH(0.0, h - EvoBee::SMALL_FLOAT_NUMBER);
 
-        // create a 2D array that will record, for each patch in the distribution area,
-        // the coordinates of each plant to be added to that patch
-        std::vector<fPos> patchInfo[w][h];
+        // generate the positions of all of the plants, then bucket them by patch with a
+        // counting sort, so that patchPositions holds the positions of the plants in each
+        // patch of the distribution area in turn (in the order in which they were generated),
+        // with those for the patch at local coords (x,y) starting at patchStart[x*h + y]
+        std::vector<fPos> positions;
+        positions.reserve(numPlants);
+        std::vector<int> patchStart(area + 1, 0);
 
         for (int i = 0; i < numPlants; ++i)
         {
@@ -136,8 +170,25 @@ void Environment::initialisePlants()
                        pdcfg.areaTopLeft.y + distH(EvoBeeModel::m_sRngEngine) };
             int iLocalX = (int)fpos.x - pdcfg.areaTopLeft.x;
             int iLocalY = (int)fpos.y - pdcfg.areaTopLeft.y;
-            patchInfo[iLocalX][iLocalY].push_back(fpos);
+            positions.push_back(fpos);
+            ++patchStart[(iLocalX * h) + iLocalY + 1];
+        }
+
+        for (int i = 0; i < area; ++i)
+        {
+            patchStart[i+1] += patchStart[i];
+        }
+
+        std::vector<fPos> patchPositions(numPlants);
+        std::vector<int> patchNext(patchStart.begin(), patchStart.end() - 1);
+        for (const fPos& fpos : positions)
+        {
+            int iLocalX = (int)fpos.x - pdcfg.areaTopLeft.x;
+            int iLocalY = (int)fpos.y - pdcfg.areaTopLeft.y;
+            patchPositions[patchNext[(iLocalX * h) + iLocalY]++] = fpos;
         }
+        positions.clear();
+        positions.shrink_to_fit();
 
         const PlantTypeConfig* pPTC = nullptr;
         std::vector<unsigned int> anyPlantDistribInfo;
@@ -170,17 +221,19 @@ void Environment::initialisePlants()
         }
         auto anyPlantDistribInfoItr = anyPlantDistribInfo.begin();
 
+        m_NewPlants.reserve(m_NewPlants.size() + numPlants);
 
-        // now go through the patchInfo array, and for each patch, go through all plants
-        // to be added to that patch
+        // now go through the patches in the distribution area, and for each patch, go
+        // through all plants to be added to that patch
         for (int x = 0; x < w; ++x)
         {
             for (int y = 0; y < h; ++y)
             {
                 Patch& patch = getPatch(x + pdcfg.areaTopLeft.x, y + pdcfg.areaTopLeft.y);
-                std::vector<fPos>& posvec = patchInfo[x][y];
-                for (fPos& pos : posvec)
+                int localIdx = (x * h) + y;
+                for (int i = patchStart[localIdx]; i < patchStart[localIdx+1]; ++i)
                 {
+                    const fPos& pos = patchPositions[i];
                     if (pdcfg.species == "any")
                     {
                         assert(anyPlantDistribInfoItr != anyPlantDistribInfo.end());
@@ -197,7 +250,7 @@ void Environment::initialisePlants()
                         */
                     }
 
-                    patch.addPlant(*pPTC, pos);
+                    m_NewPlants.emplace_back(*pPTC, pos, &patch, arena);
                 }
 
                 if (pdcfg.refuge || pdcfg.seedOutflowRestricted || (!pdcfg.seedOutflowAllowed))
@@ -207,6 +260,8 @@ void Environment::initialisePlants()
             }
         }
     }
+
+    installNewPlants();
 }
 
 
@@ -297,7 +352,7 @@ FloweringPlant* Environment::findNearestFloweringPlant( const fPos& fpos,
                     {
                         // for each patch in Moore neighbourhood...
                         Patch& patch = getPatch(x,y);
-                        PlantVector& plants = patch.getFloweringPlants();
+                        PlantRange plants = patch.getFloweringPlants();
                         for (FloweringPlant& plant : plants)
                         {
                             // for each plant in patch...
@@ -331,7 +386,7 @@ FloweringPlant* Environment::findNearestFloweringPlant( const fPos& fpos,
 
 // Search for flowers in the local patch and its 8 closest neighbours
 // (Moore neighbourhood), and return a pointer to the closest flower found
-// that is not in the supplied list of excluded flowers, or nullptr if none found.
+// that is not in the supplied set of excluded flowers, or nullptr if none found.
 // Optionally, a Pollinator may be supplied as the final argument
 // (pPollinator), which, if present, only considers flowers that the
 // Pollinator can detect (as determined by calling its isDetected(reflectanceInfo)
@@ -352,7 +407,7 @@ FloweringPlant* Environment::findNearestFloweringPlant( const fPos& fpos,
 // current position will not be considered).
 //
 Flower *Environment::findNearestUnvisitedFlower(const fPos &fpos,
-                                                const std::vector<Flower*>& excludeVec,
+                                                const VisitedFlowerMemory& excludeSet,
                                                 float fRadius /*= 1.0*/,
                                                 bool excludeCurrentPos /*= true*/,
                                                 Pollinator* pPollinator /*= nullptr*/)
@@ -369,6 +424,11 @@ Flower *Environment::findNearestUnvisitedFlower(const fPos &fpos,
     {
         iPos ipos = getPatchCoordFromFloatPos(fpos);
 
+        const std::vector<float>& fx = m_FlowerIndex.x;
+        const std::vector<float>& fy = m_FlowerIndex.y;
+        const std::vector<Flower*>& fptrs = m_FlowerIndex.flowers;
+        const std::vector<int>& patchStart = m_FlowerIndex.patchStart;
+
         for (int x = ipos.x - 1; x <= ipos.x + 1; ++x)
         {
             if (x >= 0 && x < m_iSizeX)
@@ -377,39 +437,32 @@ Flower *Environment::findNearestUnvisitedFlower(const fPos &fpos,
                 {
                     if (y >= 0 && y < m_iSizeY)
                     {
-                        // for each patch in Moore neighbourhood...
-                        Patch &patch = getPatch(x, y);
-                        PlantVector& plants = patch.getFloweringPlants();
-                        for (FloweringPlant& plant : plants)
+                        // for each patch in Moore neighbourhood, go through each
+                        // flower in that patch's section of the flower index...
+                        int patchIdx = x + (m_iSizeX * y);
+                        for (int i = patchStart[patchIdx]; i < patchStart[patchIdx+1]; ++i)
                         {
-                            // for each plant in patch...
-                            std::vector<Flower>& flowers = plant.getFlowers();
-                            for (Flower& flower : flowers)
+                            float dx = fpos.x - fx[i];
+                            float dy = fpos.y - fy[i];
+                            float distSq = (dx * dx) + (dy * dy);
+                            if (distSq < minDistSq)
                             {
-                                // for each flower on plant...
-                                unsigned int flowerID = flower.getId();
-                                if (std::find_if(excludeVec.begin(),
-                                                 excludeVec.end(),
-                                                 [flowerID](Flower* pOtherFlower){return (pOtherFlower->getId() == flowerID);})
-                                    == excludeVec.end())
+                                // this flower is closer than the closest eligible flower we've found so far...
+                                if ((!excludeCurrentPos) || (distSq > EvoBee::FLOAT_COMPARISON_EPSILON))
                                 {
-                                    // if flower not on exclude list...
-                                    float distSq = EvoBee::distanceSq(fpos, flower.getPosition());
-                                    if (distSq < minDistSq)
+                                    // it's either not at the central focus position or we don't care if it is...
+                                    Flower* pCandidate = fptrs[i];
+                                    if (!excludeSet.contains(pCandidate))
                                     {
-                                        // this flower is closer than the closest eligible flower we've found so far...
-                                        if ((!excludeCurrentPos) || (distSq > EvoBee::FLOAT_COMPARISON_EPSILON))
-                                        {
-                                            // it's either not at the central focus position or we don't care if it is...
-                                            if (pPollinator == nullptr ||
-                                                pPollinator->isDetected(flower.getReflectanceInfo())) {
-                                                // if we care about whether the pollinator can detect the flower, then
-                                                // yes, it can detect it...
-
-                                                // this is the closest eligible flower we've found so far, so record it!
-                                                minDistSq = distSq;
-                                                pFlower = &flower;
-                                            }
+                                        // the flower is not on the exclude list...
+                                        if (pPollinator == nullptr ||
+                                            pPollinator->isDetected(pCandidate->getReflectanceInfo())) {
+                                            // if we care about whether the pollinator can detect the flower, then
+                                            // yes, it can detect it...
+
+                                            // this is the closest eligible flower we've found so far, so record it!
+                                            minDistSq = distSq;
+                                            pFlower = pCandidate;
                                         }
                                     }
                                 }
@@ -433,7 +486,7 @@ Flower *Environment::findNearestUnvisitedFlower(const fPos &fpos,
 
 // Search for flowers in the local patch and its 8 closest neighbours
 // (Moore neighbourhood), and return a pointer to a randomly selected found flower
-// that is not in the supplied list of excluded flowers, or nullptr if none found.
+// that is not in the supplied set of excluded flowers, or nullptr if none found.
 //
 // The third parameter (default value = 1.0) specifies a maximum search radius.
 // If this is given a zero or negative value, then it is ignored, and all flowers
@@ -450,7 +503,7 @@ Flower *Environment::findNearestUnvisitedFlower(const fPos &fpos,
 // current position will not be considered).
 //
 Flower *Environment::findRandomUnvisitedFlower(const fPos &fpos,
-                                               const std::vector<Flower*> &excludeVec,
+                                               const VisitedFlowerMemory& excludeSet,
                                                float fRadius /*= 1.0*/,
                                                bool excludeCurrentPos /*= true*/)
 {
@@ -466,6 +519,11 @@ Flower *Environment::findRandomUnvisitedFlower(const fPos &fpos,
     {
         iPos ipos = getPatchCoordFromFloatPos(fpos);
 
+        const std::vector<float>& fx = m_FlowerIndex.x;
+        const std::vector<float>& fy = m_FlowerIndex.y;
+        const std::vector<Flower*>& fptrs = m_FlowerIndex.flowers;
+        const std::vector<int>& patchStart = m_FlowerIndex.patchStart;
+
         for (int x = ipos.x - 1; x <= ipos.x + 1; ++x)
         {
             if (x >= 0 && x < m_iSizeX)
@@ -474,30 +532,23 @@ Flower *Environment::findRandomUnvisitedFlower(const fPos &fpos,
                 {
                     if (y >= 0 && y < m_iSizeY)
                     {
-                        // for each patch in Moore neighbourhood...
-                        Patch& patch = getPatch(x, y);
-                        PlantVector& plants = patch.getFloweringPlants();
-                        for (FloweringPlant& plant : plants)
+                        // for each patch in Moore neighbourhood, go through each
+                        // flower in that patch's section of the flower index...
+                        int patchIdx = x + (m_iSizeX * y);
+                        for (int i = patchStart[patchIdx]; i < patchStart[patchIdx+1]; ++i)
                         {
-                            // for each plant in patch...
-                            std::vector<Flower>& flowers = plant.getFlowers();
-                            for (Flower& flower : flowers)
+                            float dx = fpos.x - fx[i];
+                            float dy = fpos.y - fy[i];
+                            float distSq = (dx * dx) + (dy * dy);
+                            if (((!excludeCurrentPos) || (distSq > EvoBee::FLOAT_COMPARISON_EPSILON)) &&
+                                ((!checkMaxRadius) || (distSq <= (fRadius * fRadius))))
                             {
-                                // for each flower on plant...
-                                unsigned int flowerID = flower.getId();
-                                if (std::find_if(excludeVec.begin(),
-                                                 excludeVec.end(),
-                                                 [flowerID](Flower* pOtherFlower){return (pOtherFlower->getId() == flowerID);})
-                                    == excludeVec.end())
+                                // the flower is in range, so if it is not on the
+                                // exclude list, it is an eligible flower and we record it!
+                                Flower* pCandidate = fptrs[i];
+                                if (!excludeSet.contains(pCandidate))
                                 {
-                                    // if flower not on exclude list...
-                                    float distSq = EvoBee::distanceSq(fpos, flower.getPosition());
-                                    if (((!excludeCurrentPos) || (distSq > EvoBee::FLOAT_COMPARISON_EPSILON)) &&
-                                        ((!checkMaxRadius) || (distSq <= (fRadius * fRadius))))
-                                    {
-                                        // this is an eligible flower, so record it!
-                                        candidates.push_back(&flower);
-                                    }
+                                    candidates.push_back(pCandidate);
                                 }
                             }
                         }
@@ -521,54 +572,76 @@ Flower *Environment::findRandomUnvisitedFlower(const fPos &fpos,
 // NB for the moment this metho assumes that plants just have one flower
 float Environment::getPollinatedFracAll() const
 {
-    unsigned int numPlants = 0;
-    unsigned int numPollinated = 0;
+    return (m_iNumPlants == 0) ? 0.0 : ((float)m_iNumPollinatedPlants) / ((float)m_iNumPlants);
+}
 
-    for (const Patch& p : m_Patches)
+
+// NB for the moment this metho assumes that plants just have one flower
+float Environment::getPollinatedFracSpecies1() const
+{
+    unsigned int numPlants = (m_SpeciesPlantCounts.size() > 1) ? m_SpeciesPlantCounts[1] : 0;
+    unsigned int numPollinated = (m_SpeciesPollinatedCounts.size() > 1) ? m_SpeciesPollinatedCounts[1] : 0;
+
+    return (numPlants == 0) ? 0.0 : ((float)numPollinated) / ((float)numPlants);
+}
+
+
+void Environment::updatePollinatedPlantCount(unsigned int speciesId, bool pollinated)
+{
+    std::lock_guard<std::mutex> lock(m_PlantCountMutex);
+
+    if (speciesId >= m_SpeciesPollinatedCounts.size())
     {
-        if (p.hasFloweringPlants())
-        {
-            const PlantVector& fplants = p.getFloweringPlants();
-            numPlants += fplants.size();
-            for (const FloweringPlant& fplant : fplants)
-            {
-                if (fplant.pollinated())
-                {
-                    ++numPollinated;
-                }
-            }
-        }
+        m_SpeciesPollinatedCounts.resize(speciesId + 1, 0);
     }
 
-    return (numPlants == 0) ? 0.0 : ((float)numPollinated) / ((float)numPlants);
+    if (pollinated)
+    {
+        ++m_SpeciesPollinatedCounts[speciesId];
+        ++m_iNumPollinatedPlants;
+    }
+    else
+    {
+        assert(m_SpeciesPollinatedCounts[speciesId] > 0);
+        assert(m_iNumPollinatedPlants > 0);
+        --m_SpeciesPollinatedCounts[speciesId];
+        --m_iNumPollinatedPlants;
+    }
 }
 
 
-// NB for the moment this metho assumes that plants just have one flower
-float Environment::getPollinatedFracSpecies1() const
+// Recalculate the per-species counts of plants and pollinated plants from scratch.
+// This is called whenever the population of plants is replaced (i.e. at the start of
+// each generation). Thereafter, during the generation, the pollinated counts are kept
+// up to date by FloweringPlant::setPollinated calling updatePollinatedPlantCount().
+void Environment::resetPlantCounts()
 {
-    unsigned int numPlants = 0;
-    unsigned int numPollinated = 0;
+    std::fill(m_SpeciesPlantCounts.begin(), m_SpeciesPlantCounts.end(), 0);
+    std::fill(m_SpeciesPollinatedCounts.begin(), m_SpeciesPollinatedCounts.end(), 0);
+    m_iNumPlants = 0;
+    m_iNumPollinatedPlants = 0;
 
     for (const Patch& p : m_Patches)
     {
-        if (p.hasFloweringPlants())
+        for (const FloweringPlant& fplant : p.getFloweringPlants())
         {
-            for (const FloweringPlant& fplant : p.getFloweringPlants())
+            unsigned int speciesId = fplant.getSpeciesId();
+            if (speciesId >= m_SpeciesPlantCounts.size())
             {
-                if (fplant.getSpeciesId() == 1)
-                {
-                    ++numPlants;
-                    if (fplant.pollinated())
-                    {
-                        ++numPollinated;
-                    }
-                }
+                m_SpeciesPlantCounts.resize(speciesId + 1, 0);
+                m_SpeciesPollinatedCounts.resize(speciesId + 1, 0);
+            }
+
+            ++m_SpeciesPlantCounts[speciesId];
+            ++m_iNumPlants;
+
+            if (fplant.pollinated())
+            {
+                ++m_SpeciesPollinatedCounts[speciesId];
+                ++m_iNumPollinatedPlants;
             }
         }
     }
-
-    return (numPlants == 0) ? 0.0 : ((float)numPollinated) / ((float)numPlants);
 }
 
 
@@ -590,19 +663,20 @@ float Environment::getPollinatedFracSpecies1() const
  *          area is not allowed to overlap with any other area
  *      (see implementation details below)
  *  approach:
- *      create a vector of all pollinated plants (pollinatedPlantPtrs) and shuffle it
- *          [NB each plant can be added multiple times to the vector, once for each
- *           conspecific pollen grain found on the stigma]
- *      create an empty newPlants vector to store new generation
- *      for each plant in pollinatedPlantPtrs (up to global max repro num for env)
+ *      create a vector of all pollinated plants (pollinatedPlantPtrs), each weighted
+ *          by the number of conspecific pollen grains found on its stigmas
+ *      create the new generation in m_NewPlants, allocating its flowers from the
+ *          generation arena that is not in use by the current generation
+ *      for each plant drawn at random from pollinatedPlantPtrs, in proportion to its
+ *          weight and without replacement of grains (up to global max repro num for env)
  *          consider a nearby position in which to reproduce
  *          determine prob that it will successfully reproduce in that position, taking into acccount
  *              seed outflow prob of current patch
  *              seed inflow prob (refuge incoming) of destination
  *              any local PTDConfig density constraints (consult m_LocalDensityConstraints)
- *          if successful, create new plant and put in newPlants vector
- *      empty plant vectors for all patches - delete all plants from previous generation
- *      for each plant in newPlants, move plant to appropriate Patch vector
+ *          if successful, create new plant and put in m_NewPlants
+ *      install the new plants, sorted by patch, in place of the previous generation,
+ *          and delete all plants from previous generation (see installNewPlants)
  *  implementation details:
  *      each Patch needs
  *          outflow prob (and allowed/restricted flags, corresponding to p>0, p<1)
@@ -622,21 +696,25 @@ void Environment::initialiseNewGeneration()
     //////////////////////////////////////////////////////////////
     // Step 1: Construct a new generation of plants
 
-    // -- Step 1a: create a vector of all pollinated plants and shuffle it
+    // -- Step 1a: create a vector of all pollinated plants, and a sampler to pick parents
+    //    from it in proportion to their number of conspecific pollen grains
+    EvoBeeModel::m_sRngEngine.setStream(RngStreamPurpose::REPRODUCTION, m_pModel->getGenNumber());
     std::vector<FloweringPlant*> pollinatedPlantPtrs;
+    std::vector<unsigned int> conspecificGrainCounts;
     for (Patch& p : m_Patches)
     {
         if (p.hasFloweringPlants())
         {
-            PlantVector& plants = p.getFloweringPlants();
+            PlantRange plants = p.getFloweringPlants();
             for (FloweringPlant& plant : plants)
             {
                 if (plant.pollinated())
                 {
                     // for each pollinated plant, we look at each pollen grain on
-                    // the stigma of each of its flowers, and add a candidate
-                    // pointer for reproduction for each conspecific grain
-                    const std::vector<Flower>& flowers = plant.getFlowers();
+                    // the stigma of each of its flowers, and the plant gets one
+                    // chance of being picked for reproduction for each conspecific grain
+                    unsigned int numConspecificGrains = 0;
+                    const FlowerVector& flowers = plant.getFlowers();
                     for (const Flower& flower : flowers)
                     {
                         const PollenVector& stigmaPollen = flower.getStigmaPollen();
@@ -644,28 +722,39 @@ void Environment::initialiseNewGeneration()
                         {
                             if (pollen.speciesId == flower.getSpeciesId())
                             {
-                                pollinatedPlantPtrs.push_back(&plant);
+                                ++numConspecificGrains;
                                 ///@todo TODO when we implement mutation, we will actually want
                                 /// to record the plant AND a ptr to the pollinating flower
                                 /// (pollen.pSource)
                             }
                         }
                     }
+
+                    if (numConspecificGrains > 0)
+                    {
+                        pollinatedPlantPtrs.push_back(&plant);
+                        conspecificGrainCounts.push_back(numConspecificGrains);
+                    }
                 }
             }
         }
     }
-    std::shuffle(pollinatedPlantPtrs.begin(), pollinatedPlantPtrs.end(), EvoBeeModel::m_sRngEngine);
+    WeightedSampler parentSampler(std::move(conspecificGrainCounts));
 
-    // -- Step 1b: create an empty vector to store new generation
-    std::vector<FloweringPlant> newPlants;
+    // -- Step 1b: the new generation is collected in m_NewPlants, with its flowers allocated
+    //    from the arena that is not being used by the current generation
+    GenerationArena& arena = getNextGenerationArena();
 
-    // -- Step 1c: for each plant in vector (up to global max repro num for env)
+    // -- Step 1c: for each parent drawn from the sampler (up to global max repro num for env)
     unsigned int globalMax = ModelParams::getReproGlobalDensityConstrained() ?
         ((unsigned int)((float)m_Patches.size() * ModelParams::getReproGlobalDensityMax())) : 0;
 
-    for (FloweringPlant* pPlant : pollinatedPlantPtrs)
+    // (picking the parents one at a time like this means that the cost of reproduction
+    // depends on the number of parents needed rather than the total number of grains)
+    while (!parentSampler.empty())
     {
+        FloweringPlant* pPlant = pollinatedPlantPtrs[parentSampler.draw()];
+
         // -- Step 1c.1: consider a possible position in which to reproduce
         const Patch& curPatch = pPlant->getPatch();
 
@@ -752,13 +841,13 @@ void Environment::initialiseNewGeneration()
             bAnyChance = false;
         }
 
-        // -- Step 1c.3: if successful, create new plant and put in newPlants vector
+        // -- Step 1c.3: if successful, create new plant and put in m_NewPlants
         if (bAnyChance && (EvoBeeModel::m_sUniformProbDistrib(EvoBeeModel::m_sRngEngine) < successProb))
         {
             Patch& newPatch = getPatch(iNewPos);
 
             // create a mutated version of the parent plant
-            newPlants.emplace_back(pPlant, fNewPos, &newPatch, true);
+            m_NewPlants.emplace_back(pPlant, fNewPos, &newPatch, true, arena);
 
             // and also update local density count
             incrementLocalDensityCount(iNewPos);
@@ -766,7 +855,7 @@ void Environment::initialiseNewGeneration()
 
         // -- Step 1c.4: if we've now reached the global limit on the number of new plants to
         //               produce, stop!
-        if ((globalMax > 0) && (newPlants.size() > globalMax))
+        if ((globalMax > 0) && (m_NewPlants.size() > globalMax))
         {
             break;
         }
@@ -779,20 +868,11 @@ void Environment::initialiseNewGeneration()
     if (ModelParams::randomIntro() &&
         (((m_pModel->getGenNumber()+1) % ModelParams::getPtdRandomIntroOngoingPeriod()) == 0))
     {
-        introduceRandomNewFlowerSpecies(newPlants);
+        introduceRandomNewFlowerSpecies(m_NewPlants);
     }
 
-    // -- Step 1e: empty plant vectors for all patches
-    for (Patch& p : m_Patches)
-    {
-        p.killAllPlants();
-    }
-
-    // -- Step 1f: for each plant in newPlants, move it to appropriate Patch vec
-    for (FloweringPlant& plant : newPlants)
-    {
-        plant.getPatch().addPlant(plant);
-    }
+    // -- Step 1e: replace the plants of the current generation with the new ones
+    installNewPlants();
 
     //////////////////////////////////////////////////////////////
     // Step 2: Reset all pollinators to their initial state
@@ -805,6 +885,8 @@ void Environment::initialiseNewGeneration()
     // Step 3: Perform any other miscellaneous housekeeping at the start of a new generation
 
     m_bFlowerPtrVectorInitialised = false; // ensure m_AllFlowers will get refreshed
+    rebuildFlowerIndex();                  // and that the flower search index is up to date
+    resetPlantCounts();                    // and the running plant counts are reset
 }
 
 void Environment::introduceRandomNewFlowerSpecies(std::vector<FloweringPlant>& newPlants)
@@ -884,8 +966,8 @@ void Environment::introduceRandomNewFlowerSpecies(std::vector<FloweringPlant>& n
 
     // now remove a number of plants in the current newPlants vector to make way for the new ones we are about to insert
     // NB we can simply erase the plants from the end of the newPlants vector - there is no need to shuffle the
-    // vector beforehand, because we already shuffled in the pollinatedPlantPts vector in initialiseNewGeneration()
-    // before using it to populate the newPlants vector
+    // vector beforehand, because the parents of the plants in it were drawn in random order in
+    // initialiseNewGeneration()
     int numPlantsToRemove = std::min(numNewPlants, (int)(newPlants.size()));
     newPlants.erase(newPlants.end()-numPlantsToRemove, newPlants.end());
 
@@ -917,13 +999,76 @@ void Environment::introduceRandomNewFlowerSpecies(std::vector<FloweringPlant>& n
         assert(!newPatch.refuge());
         assert(!newPatch.noGoArea());
 
-        newPlants.emplace_back(*pPTC, fNewPos, &newPatch);
+        newPlants.emplace_back(*pPTC, fNewPos, &newPatch, getNextGenerationArena());
 
         // and also update local density count
         incrementLocalDensityCount(iNewPos);
     }
 }
 
+// Returns the arena from which the plants being created for the next generation should
+// allocate their flowers (i.e. the one that is not in use by the current generation)
+GenerationArena& Environment::getNextGenerationArena()
+{
+    return m_GenerationBuffers[1 - m_iCurGenerationBuffer].arena;
+}
+
+// Make the plants in m_NewPlants the current generation. The plants are moved into the
+// spare generation buffer, sorted by patch with a counting sort (which keeps the plants
+// on each patch in the order in which they were created, so each patch ends up with
+// the same plants in the same order as if they had been added to it one at a time),
+// and each patch is given the range of plants that belong to it. The plants of the
+// old generation are then destroyed, and their buffer is kept to hold the generation
+// after next, with its arena sized to hold as much as the new generation's.
+void Environment::installNewPlants()
+{
+    GenerationBuffer& oldGen = m_GenerationBuffers[m_iCurGenerationBuffer];
+    GenerationBuffer& newGen = m_GenerationBuffers[1 - m_iCurGenerationBuffer];
+
+    std::vector<std::size_t> patchStart(m_iNumPatches + 1, 0);
+    for (const FloweringPlant& plant : m_NewPlants)
+    {
+        ++patchStart[plant.getPatch().getPosIdx() + 1];
+    }
+
+    for (int i = 0; i < m_iNumPatches; ++i)
+    {
+        patchStart[i+1] += patchStart[i];
+    }
+
+    std::vector<std::size_t> order(m_NewPlants.size());
+    std::vector<std::size_t> patchNext(patchStart.begin(), patchStart.end() - 1);
+    for (std::size_t i = 0; i < m_NewPlants.size(); ++i)
+    {
+        order[patchNext[m_NewPlants[i].getPatch().getPosIdx()]++] = i;
+    }
+
+    assert(newGen.plants.empty());
+    newGen.plants.reserve(m_NewPlants.size());
+    for (std::size_t i : order)
+    {
+        newGen.plants.push_back(std::move(m_NewPlants[i]));
+    }
+    m_NewPlants.clear();
+
+    FloweringPlant* pPlants = newGen.plants.data();
+    for (Patch& patch : m_Patches)
+    {
+        int idx = patch.getPosIdx();
+        patch.setFloweringPlants(PlantRange(pPlants + patchStart[idx], pPlants + patchStart[idx+1]));
+    }
+
+    oldGen.plants.clear();
+    oldGen.arena.reset();
+    oldGen.arena.reserve(newGen.arena.getBytesUsed());
+
+    m_iCurGenerationBuffer = 1 - m_iCurGenerationBuffer;
+}
+
+// As well as creating the list of constraints, this records which constraint (if any)
+// applies to each patch, so that the constraint for a seedling's destination patch can be
+// looked up directly during reproduction. If constraint areas overlap, a patch is governed
+// by the first of them in the order in which they appear in the config file.
 void Environment::initialiseLocalDensityCounts()
 {
     const std::vector<PlantTypeDistributionConfig>& pdconfigs =
@@ -936,6 +1081,23 @@ void Environment::initialiseLocalDensityCounts()
             m_LocalDensityConstraints.emplace_back(pdcfg);
         }
     }
+
+    m_PatchLocalDensityConstraintIdx.assign(m_iNumPatches, -1);
+    for (int i = 0; i < (int)m_LocalDensityConstraints.size(); ++i)
+    {
+        const PlantTypeDistributionConfig& pdcfg = m_LocalDensityConstraints[i].ptdcfg;
+        for (int y = std::max(0, pdcfg.areaTopLeft.y); y <= std::min(m_iSizeY - 1, pdcfg.areaBottomRight.y); ++y)
+        {
+            for (int x = std::max(0, pdcfg.areaTopLeft.x); x <= std::min(m_iSizeX - 1, pdcfg.areaBottomRight.x); ++x)
+            {
+                int& idx = m_PatchLocalDensityConstraintIdx[x + (m_iSizeX * y)];
+                if (idx < 0)
+                {
+                    idx = i;
+                }
+            }
+        }
+    }
 }
 
 void Environment::resetLocalDensityCounts()
@@ -948,12 +1110,11 @@ void Environment::resetLocalDensityCounts()
 
 bool Environment::localDensityLimitReached(const iPos& newPatchPos) const
 {
-    for (const LocalDensityConstraint& ldc : m_LocalDensityConstraints)
+    int idx = getLocalDensityConstraintIdx(newPatchPos);
+    if (idx >= 0)
     {
-        if (ldc.posInArea(newPatchPos))
-        {
-            return (ldc.curPlants >= ldc.maxPlants);
-        }
+        const LocalDensityConstraint& ldc = m_LocalDensityConstraints[idx];
+        return (ldc.curPlants >= ldc.maxPlants);
     }
 
     return false;
@@ -961,14 +1122,21 @@ bool Environment::localDensityLimitReached(const iPos& newPatchPos) const
 
 void Environment::incrementLocalDensityCount(const iPos& newPatchPos)
 {
-    for (LocalDensityConstraint& ldc : m_LocalDensityConstraints)
+    int idx = getLocalDensityConstraintIdx(newPatchPos);
+    if (idx >= 0)
     {
-        if (ldc.posInArea(newPatchPos))
-        {
-            ++(ldc.curPlants);
-            return;
-        }
+        ++(m_LocalDensityConstraints[idx].curPlants);
+    }
+}
+
+int Environment::getLocalDensityConstraintIdx(const iPos& patchPos) const
+{
+    if (m_LocalDensityConstraints.empty() || !inEnvironment(patchPos))
+    {
+        return -1;
     }
+
+    return m_PatchLocalDensityConstraintIdx[patchPos.x + (m_iSizeX * patchPos.y)];
 }
 
 
@@ -981,11 +1149,11 @@ FlowerPtrVector& Environment::getAllFlowerPtrVector()
         for (Patch& patch : m_Patches)
         {
             // for each patch...
-            PlantVector& plants = patch.getFloweringPlants();
+            PlantRange plants = patch.getFloweringPlants();
             for (FloweringPlant &plant : plants)
             {
                 // for each plant in patch...
-                std::vector<Flower>& flowers = plant.getFlowers();
+                FlowerVector& flowers = plant.getFlowers();
                 for (Flower& flower : flowers)
                 {
                     m_AllFlowers.push_back(&flower);
@@ -998,3 +1166,194 @@ FlowerPtrVector& Environment::getAllFlowerPtrVector()
 
     return m_AllFlowers;
 }
+
+
+// (Re)build the cell-sorted flower index used by findNearestUnvisitedFlower() and
+// findRandomUnvisitedFlower(). The flowers are recorded patch by patch in the same
+// order in which they are held in the patches' plant vectors, so searches that walk
+// the index visit flowers in exactly the same order as a walk through the patches
+// themselves would. This must be called whenever the plants in the environment change.
+void Environment::rebuildFlowerIndex()
+{
+    m_FlowerIndex.clear();
+
+    size_t numFlowers = 0;
+    for (Patch& patch : m_Patches)
+    {
+        for (FloweringPlant& plant : patch.getFloweringPlants())
+        {
+            numFlowers += plant.getFlowers().size();
+        }
+    }
+
+    m_FlowerIndex.x.reserve(numFlowers);
+    m_FlowerIndex.y.reserve(numFlowers);
+    m_FlowerIndex.flowers.reserve(numFlowers);
+    m_FlowerIndex.patchStart.reserve(m_Patches.size() + 1);
+
+    for (Patch& patch : m_Patches)
+    {
+        m_FlowerIndex.patchStart.push_back((int)m_FlowerIndex.flowers.size());
+
+        for (FloweringPlant& plant : patch.getFloweringPlants())
+        {
+            for (Flower& flower : plant.getFlowers())
+            {
+                const fPos& pos = flower.getPosition();
+                m_FlowerIndex.x.push_back(pos.x);
+                m_FlowerIndex.y.push_back(pos.y);
+                m_FlowerIndex.flowers.push_back(&flower);
+            }
+        }
+    }
+
+    m_FlowerIndex.patchStart.push_back((int)m_FlowerIndex.flowers.size());
+
+    buildPatchFlowerDistances();
+}
+
+
+// Fill in m_FlowerIndex.patchFlowerDistance from the patchStart entries, using a
+// two-pass chessboard distance transform. The first pass carries distances forward
+// from the neighbours above and to the left of each patch, and the second pass
+// carries them back from the neighbours below and to the right, which together give
+// the exact Chebyshev distance to the nearest patch holding a flower.
+void Environment::buildPatchFlowerDistances()
+{
+    const std::vector<int>& patchStart = m_FlowerIndex.patchStart;
+    std::vector<int>& dist = m_FlowerIndex.patchFlowerDistance;
+
+    const int noFlower = m_iSizeX + m_iSizeY; // greater than any distance within the environment
+    dist.assign(m_iNumPatches, noFlower);
+    for (int i = 0; i < m_iNumPatches; ++i)
+    {
+        if (patchStart[i+1] > patchStart[i])
+        {
+            dist[i] = 0;
+        }
+    }
+
+    auto relax = [&](int idx, int x, int y) {
+        if (x >= 0 && x < m_iSizeX && y >= 0 && y < m_iSizeY)
+        {
+            dist[idx] = std::min(dist[idx], dist[x + (m_iSizeX * y)] + 1);
+        }
+    };
+
+    for (int y = 0; y < m_iSizeY; ++y)
+    {
+        for (int x = 0; x < m_iSizeX; ++x)
+        {
+            int idx = x + (m_iSizeX * y);
+            relax(idx, x - 1, y);
+            relax(idx, x - 1, y - 1);
+            relax(idx, x,     y - 1);
+            relax(idx, x + 1, y - 1);
+        }
+    }
+
+    for (int y = m_iSizeY - 1; y >= 0; --y)
+    {
+        for (int x = m_iSizeX - 1; x >= 0; --x)
+        {
+            int idx = x + (m_iSizeX * y);
+            relax(idx, x + 1, y);
+            relax(idx, x + 1, y + 1);
+            relax(idx, x,     y + 1);
+            relax(idx, x - 1, y + 1);
+        }
+    }
+}
+
+
+int Environment::getPatchFlowerDistance(const fPos& fpos) const
+{
+    assert(inEnvironment(fpos));
+    iPos ipos = getPatchCoordFromFloatPos(fpos);
+    return m_FlowerIndex.patchFlowerDistance[ipos.x + (m_iSizeX * ipos.y)];
+}
+
+
+// Plants are saved patch by patch, so that they are restored in their original
+// order. The stigma pollen of all flowers is saved after all of the plants, and
+// the pollinators after that, so that every flower referred to by a pollen
+// grain or a pollinator has already been restored by the time it is needed.
+void Environment::saveState(CheckpointWriter& writer) const
+{
+    writer.write<std::uint64_t>(m_Patches.size());
+    for (const Patch& p : m_Patches)
+    {
+        ConstPlantRange plants = p.getFloweringPlants();
+        writer.write<std::uint64_t>(plants.size());
+        for (const FloweringPlant& plant : plants)
+        {
+            plant.saveState(writer);
+        }
+    }
+
+    for (const Patch& p : m_Patches)
+    {
+        for (const FloweringPlant& plant : p.getFloweringPlants())
+        {
+            for (const Flower& flower : plant.getFlowers())
+            {
+                flower.saveStigmaPollen(writer);
+            }
+        }
+    }
+
+    writer.write<std::uint64_t>(m_AllPollinators.size());
+    for (const Pollinator* pPol : m_AllPollinators)
+    {
+        pPol->saveState(writer);
+    }
+}
+
+
+void Environment::loadState(CheckpointReader& reader)
+{
+    reader.expectCount(m_Patches.size(), "patches");
+    GenerationArena& arena = getNextGenerationArena();
+    for (Patch& p : m_Patches)
+    {
+        std::uint64_t numPlants = reader.read<std::uint64_t>();
+        for (std::uint64_t i = 0; i < numPlants; ++i)
+        {
+            m_NewPlants.emplace_back(reader, &p, arena);
+        }
+    }
+    installNewPlants();
+
+    // now that all plants are in their final place, record where each flower is
+    for (Patch& p : m_Patches)
+    {
+        for (FloweringPlant& plant : p.getFloweringPlants())
+        {
+            for (Flower& flower : plant.getFlowers())
+            {
+                reader.registerFlower(&flower);
+            }
+        }
+    }
+
+    for (Patch& p : m_Patches)
+    {
+        for (FloweringPlant& plant : p.getFloweringPlants())
+        {
+            for (Flower& flower : plant.getFlowers())
+            {
+                flower.loadStigmaPollen(reader);
+            }
+        }
+    }
+
+    reader.expectCount(m_AllPollinators.size(), "pollinators");
+    for (Pollinator* pPol : m_AllPollinators)
+    {
+        pPol->loadState(reader);
+    }
+
+    m_bFlowerPtrVectorInitialised = false;
+    rebuildFlowerIndex();
+    resetPlantCounts();
+}
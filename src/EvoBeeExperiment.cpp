@@ -5,6 +5,9 @@
  */
 
 #include <thread>
+#include <chrono>
+#include <iomanip>
+#include <filesystem>
 #include "ModelParams.h"
 #include "EvoBeeModel.h"
 #include "EventManager.h"
@@ -20,8 +23,7 @@ EvoBeeExperiment::EvoBeeExperiment() :
     m_Model(),
     m_EventManager(),
     m_Logger(&m_Model),
-    m_Visualiser(&m_Model),
-    m_threadLog()
+    m_Visualiser(&m_Model)
 {
     assert(ModelParams::initialised());
 
@@ -45,14 +47,6 @@ EvoBeeExperiment::EvoBeeExperiment() :
 
 EvoBeeExperiment::~EvoBeeExperiment()
 {
-    // Wait for any threads to finish their work
-    if (ModelParams::useLogThreads())
-    {
-        if (m_threadLog.joinable())
-        {
-            m_threadLog.join();
-        }
-    }
 }
 
 
@@ -75,6 +69,9 @@ void EvoBeeExperiment::run()
     case 2:
         runMatchConfidenceTest();
         break;
+    case 3:
+        runParallelStepBenchmark();
+        break;
     default:
         std::cerr << "Unknown test number " << testnum << " requested. Aborting." << std::endl;
         exit(1);
@@ -84,7 +81,22 @@ void EvoBeeExperiment::run()
 
 void EvoBeeExperiment::runStandardExperiment()
 {
-    for (int gen = 0; gen < ModelParams::getSimTerminationNumGens(); ++gen)
+    // if we are resuming a previous run, restore the state of the model at the
+    // end of the generation in which the checkpoint was made, and carry on from
+    // the following generation. The branches of a branched experiment start
+    // from the checkpoint of the shared prefix, but each continues with the
+    // RNG seeded from its own seed rather than the one stored in the checkpoint.
+    int firstGen = 0;
+    if (ModelParams::resumeFromCheckpoint())
+    {
+        bool bRestoreRng = (ModelParams::getBranchNumber() == 0);
+        m_Model.restoreCheckpoint(ModelParams::getResumeCheckpointFile(), bRestoreRng);
+        firstGen = m_Model.getGenNumber() + 1;
+    }
+
+    const int checkpointPeriod = ModelParams::getCheckpointPeriod();
+
+    for (int gen = firstGen; gen < ModelParams::getSimTerminationNumGens(); ++gen)
     {
         ////////////////////////
         // REPRODUCTION PHASE //
@@ -143,6 +155,13 @@ void EvoBeeExperiment::runStandardExperiment()
             // this step is now finished, so ...
             // ... advance step count
             ++step;
+            // ... and end the generation early if every pollinator has completed its bout,
+            // as further steps would have no effect
+            if (m_Model.getNumActivePollinators() == 0)
+            {
+                endOfGen = true;
+                continue;
+            }
             // ... and check whether the current generation is now complete
             switch (ModelParams::getGenTerminationType())
             {
@@ -156,7 +175,10 @@ void EvoBeeExperiment::runStandardExperiment()
                 }
                 case GenTerminationType::NUM_POLLINATOR_STEPS:
                 {
-                    ///@todo - implement code for num-pollinator-steps termination type
+                    if (m_Model.getGenStepCounts().numSteps >= (unsigned long)ModelParams::getGenTerminationIntParam())
+                    {
+                        endOfGen = true;
+                    }
                     break;
                 }
                 case GenTerminationType::POLLINATED_FRACTION_ALL:
@@ -209,12 +231,27 @@ void EvoBeeExperiment::runStandardExperiment()
             if (ModelParams::logPollinatorsInterPhaseSummary()) {
                 callLoggerMethod(&Logger::logPollinatorsInterPhaseSummary);
             }
+            if (ModelParams::logPollinatorStepsInterPhaseSummary()) {
+                callLoggerMethod(&Logger::logPollinatorStepsInterPhaseSummary);
+            }
+        }
+
+        // make sure everything logged during this generation reaches the log file
+        if (ModelParams::logging())
+        {
+            m_Logger.flush();
         }
 
         if (!bContinue)
         {
             break;
         }
+
+        // save a checkpoint of the model every checkpointPeriod generations
+        if ((checkpointPeriod > 0) && ((gen + 1) % checkpointPeriod == 0))
+        {
+            m_Model.saveCheckpoint(getCheckpointPath(gen));
+        }
     }
 
     /////////////////////////////////
@@ -225,12 +262,24 @@ void EvoBeeExperiment::runStandardExperiment()
     // if one has been specified
     if (ModelParams::logging())
     {
+        m_Logger.finishWriting();
         m_Logger.transferFilesToFinalDir();
     }
 
 }
 
 
+// Checkpoints are written to the log directory, and named after the run and
+// the generation whose end state they record
+std::string EvoBeeExperiment::getCheckpointPath(unsigned int gen)
+{
+    std::filesystem::path dir {ModelParams::getLogDir()};
+    std::filesystem::create_directories(dir);
+    std::string filename = ModelParams::getLogRunName() + "-checkpoint-gen" + std::to_string(gen) + ".bin";
+    return (dir / filename).string();
+}
+
+
 void EvoBeeExperiment::runMarkerPointSimilarityTest()
 {
     /*
@@ -293,18 +342,69 @@ void EvoBeeExperiment::runMatchConfidenceTest()
 }
 
 
-void EvoBeeExperiment::callLoggerMethod(void (Logger::*loggerMethod)())
+// Compare the throughput of the serial and multi-threaded pollinator stepping code.
+// For each configuration, a fresh model is constructed from the current config file and
+// stepped for the number of steps specified by generation-termination-param (if the
+// generation-termination-type is num-sim-steps; otherwise 1000 steps are used). The
+// serial code is run first, followed by the ParallelStepper with 1, 2, 4, ... threads
+// up to the number of hardware threads available.
+void EvoBeeExperiment::runParallelStepBenchmark()
 {
-    if (ModelParams::useLogThreads())
+    if (ModelParams::getRngType() != RngType::PHILOX)
     {
-        if (m_threadLog.joinable())
-        {
-            m_threadLog.join();
-        }
-        m_threadLog = std::thread(loggerMethod, m_Logger);
+        std::cerr << "The parallel step benchmark requires rng-type to be set to 'philox'. Aborting." << std::endl;
+        exit(1);
+    }
+
+    int numSteps = (ModelParams::getGenTerminationType() == GenTerminationType::NUM_SIM_STEPS) ?
+        ModelParams::getGenTerminationIntParam() : 1000;
+
+    std::vector<unsigned int> threadCounts {0};
+    unsigned int maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    for (unsigned int t = 1; t <= maxThreads; t *= 2)
+    {
+        threadCounts.push_back(t);
+    }
+    if (threadCounts.back() != maxThreads)
+    {
+        threadCounts.push_back(maxThreads);
     }
-    else
+
+    std::cout << "threads,steps,pollinator-steps,seconds,pollinator-steps-per-sec,speedup" << std::endl;
+
+    double serialRate = 0.0;
+    for (unsigned int threads : threadCounts)
     {
-        (m_Logger.*loggerMethod)();
+        EvoBeeModel model;
+        model.setStepThreads(threads);
+        std::size_t numPollinators = model.getEnv().getAllPollinators().size();
+
+        auto start = std::chrono::steady_clock::now();
+        for (int step = 0; step < numSteps; ++step)
+        {
+            model.step();
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        double polSteps = (double)numPollinators * numSteps;
+        double rate = polSteps / std::max(elapsed.count(), 1e-9);
+        if (threads == 0)
+        {
+            serialRate = rate;
+        }
+
+        std::cout << (threads == 0 ? std::string("serial") : std::to_string(threads)) << ","
+                  << numSteps << "," << (unsigned long)polSteps << ","
+                  << std::setprecision(4) << elapsed.count() << ","
+                  << std::setprecision(6) << rate << ","
+                  << std::setprecision(3) << (rate / serialRate) << std::endl;
     }
 }
+
+
+void EvoBeeExperiment::callLoggerMethod(void (Logger::*loggerMethod)())
+{
+    // NB if use-log-threads is set, the Logger hands the actual writing over to its own
+    // writer thread, so the call is the same in either case
+    (m_Logger.*loggerMethod)();
+}
@@ -12,13 +12,16 @@
 #include <cstdlib>
 #include "Environment.h"
 #include "Pollinator.h"
+#include "FloweringPlant.h"
+#include "Flower.h"
+#include "Checkpoint.h"
 #include "ModelParams.h"
 #include "EvoBeeModel.h"
 #include "tools.h"
 
 // Define EvoBeeModel's static members
 // -- create our static random number generator engine
-std::mt19937 EvoBeeModel::m_sRngEngine;
+thread_local RngEngine EvoBeeModel::m_sRngEngine;
 //gsl_rng* EvoBeeModel::m_spGslRngEngine = nullptr;
 bool EvoBeeModel::m_sbRngInitialised = false;
 // -- and define some commonly used distributions
@@ -30,10 +33,38 @@ std::cauchy_distribution<float> EvoBeeModel::m_sCauchyProbDistrib(0.0, 1.0);
 EvoBeeModel::EvoBeeModel() :
     m_iGen(0),
     m_iStep(0),
-    m_Env(this)
+    m_Env(this),
+    m_bActivePollinatorsStale(true)
 {
     assert(ModelParams::initialised());
     assert(m_sbRngInitialised);
+
+    if (ModelParams::getPollinatorStepThreads() > 0)
+    {
+        setStepThreads(ModelParams::getPollinatorStepThreads());
+    }
+}
+
+
+void EvoBeeModel::setStepThreads(unsigned int numThreads)
+{
+    m_pParallelStepper.reset();
+
+    if (numThreads > 0)
+    {
+        m_pParallelStepper = std::make_unique<ParallelStepper>(&m_Env, numThreads);
+        if (!m_pParallelStepper->available())
+        {
+            std::cerr << "Warning: pollinators with unbounded step reach (e.g. random-global foraging) "
+                << "cannot be stepped in parallel. Using serial stepping instead." << std::endl;
+            m_pParallelStepper.reset();
+        }
+        else if (ModelParams::verbose())
+        {
+            std::cout << "Stepping pollinators with " << m_pParallelStepper->getNumThreads()
+                << " threads, tile size " << m_pParallelStepper->getTileSize() << std::endl;
+        }
+    }
 }
 
 /**
@@ -48,6 +79,8 @@ void EvoBeeModel::seedRng()
 
     const std::string& seedStr = ModelParams::getRngSeedStr();
 
+    m_sRngEngine.setType(ModelParams::getRngType());
+
     if (seedStr.empty()) {
         // if no seed string has been supplied, we generate a seed here
         // We keep it consistent with the format of user-supplied seeds by creating
@@ -95,18 +128,73 @@ void EvoBeeModel::step()
         std::cout << "Model gen " << m_iGen << ", step " << m_iStep << std::endl;
     }
 
-    // first allow all pollinators to update
-    auto pollinators = m_Env.getAllPollinators();
-    std::shuffle(pollinators.begin(), pollinators.end(), m_sRngEngine);
-    for (Pollinator* pol : pollinators)
+    // first allow all pollinators that are still active to update, in a random order
+    refreshActivePollinators();
+    m_sRngEngine.setStream(RngStreamPurpose::POLLINATOR_SCHEDULING, m_iGen, m_iStep);
+    std::shuffle(m_ActivePollinators.begin(), m_ActivePollinators.end(), m_sRngEngine);
+    if (m_pParallelStepper)
+    {
+        m_pParallelStepper->step(m_ActivePollinators);
+    }
+    else
+    {
+        for (Pollinator* pol : m_ActivePollinators)
+        {
+            pol->step();
+        }
+    }
+
+    // collect the counts of what the pollinators did in this step
+    for (Pollinator* pol : m_ActivePollinators)
     {
-        pol->step();
+        pol->transferStepCounts(m_GenStepCounts);
     }
 
+    // pollinators that have now completed their bout take no further part in this generation
+    m_ActivePollinators.erase(
+        std::remove_if(m_ActivePollinators.begin(), m_ActivePollinators.end(),
+                       [](const Pollinator* pol){return (pol->getState() == PollinatorState::BOUT_COMPLETE);}),
+        m_ActivePollinators.end());
+
     ++m_iStep;
 }
 
 
+std::size_t EvoBeeModel::getNumActivePollinators()
+{
+    refreshActivePollinators();
+    return m_ActivePollinators.size();
+}
+
+
+/**
+ * Rebuild the list of active pollinators from the environment if it is out of date
+ * (i.e. at the start of a generation, or after restoring a checkpoint). The list
+ * starts off in the environment's order, so the schedule of every generation is
+ * determined by the scheduling RNG streams alone.
+ */
+void EvoBeeModel::refreshActivePollinators()
+{
+    if (!m_bActivePollinatorsStale)
+    {
+        return;
+    }
+
+    const PollinatorPtrVector& allPollinators = m_Env.getAllPollinators();
+    m_ActivePollinators.clear();
+    m_ActivePollinators.reserve(allPollinators.size());
+    for (Pollinator* pol : allPollinators)
+    {
+        if (pol->getState() != PollinatorState::BOUT_COMPLETE)
+        {
+            m_ActivePollinators.push_back(pol);
+        }
+    }
+
+    m_bActivePollinatorsStale = false;
+}
+
+
 /**
  * Initialise a new generation.
  * We need to construct a new generation of plants based upon those successfully
@@ -118,4 +206,63 @@ void EvoBeeModel::initialiseNewGeneration()
     ++m_iGen;
     m_Env.initialiseNewGeneration();
     m_iStep = 0;
+    m_bActivePollinatorsStale = true;
+    m_GenStepCounts.reset();
+}
+
+
+void EvoBeeModel::saveCheckpoint(const std::string& path) const
+{
+    CheckpointWriter writer;
+
+    writer.write(m_iGen);
+    writer.write(m_iStep);
+    m_sRngEngine.saveState(writer);
+
+    FloweringPlant::saveStaticState(writer);
+    writer.write(Flower::getNextFreeId());
+    writer.write(Pollinator::getMaxIdIssued() + 1);
+
+    m_Env.saveState(writer);
+
+    writer.writeFile(path);
+
+    if (ModelParams::verbose())
+    {
+        std::cout << "Saved checkpoint of generation " << m_iGen << " to " << path << std::endl;
+    }
+}
+
+
+void EvoBeeModel::restoreCheckpoint(const std::string& path, bool bRestoreRng /*= true*/)
+{
+    CheckpointReader reader(path);
+
+    m_iGen = reader.read<unsigned int>();
+    m_iStep = reader.read<unsigned int>();
+    if (bRestoreRng)
+    {
+        m_sRngEngine.loadState(reader);
+    }
+    else
+    {
+        RngEngine savedRng;
+        savedRng.setType(m_sRngEngine.getType());
+        savedRng.loadState(reader);
+    }
+
+    FloweringPlant::loadStaticState(reader);
+    Flower::setNextFreeId(reader.read<unsigned int>());
+    Pollinator::setNextFreeId(reader.read<unsigned int>());
+
+    m_Env.loadState(reader);
+    m_bActivePollinatorsStale = true;
+    m_GenStepCounts.reset();
+
+    reader.finish();
+
+    if (ModelParams::verbose())
+    {
+        std::cout << "Restored checkpoint of generation " << m_iGen << " from " << path << std::endl;
+    }
 }
@@ -6,12 +6,14 @@
 
 #include <iostream>
 #include <algorithm>
-#include <sstream>
 #include <iomanip>
 #include <exception>
 #include <cassert>
 #include "FloweringPlant.h"
 #include "Flower.h"
+#include "LogSnapshot.h"
+#include "Checkpoint.h"
+#include "ModelParams.h"
 
 unsigned int Flower::m_sNextFreeId = 1;
 
@@ -27,6 +29,7 @@ Flower::Flower( FloweringPlant* pPlant,
     m_Reflectance(mp, ptc.flowerVisDataPtr),
     m_bPollinated(false),
     m_iAntherPollen(ptc.antherInitPollen),
+    m_StigmaPollen(pPlant->m_Flowers.get_allocator()),
     m_iAvailableNectar(ptc.initNectar),
     m_fTemperature(ptc.initTemp),
     m_pPlant(pPlant),
@@ -35,7 +38,9 @@ Flower::Flower( FloweringPlant* pPlant,
     m_bPollenCloggingAll(ptc.pollenCloggingAll),
     m_bPollenCloggingPartial(ptc.pollenCloggingPartial),
     m_CloggingSpeciesVec(pPlant->getCloggingSpeciesVec())
-{}
+{
+    m_Reflectance.setVisDataIdx(ModelParams::getVisDataIdx(m_Reflectance));
+}
 
 
 // create a new flower based upon a flower from the parent plant
@@ -49,6 +54,7 @@ Flower::Flower( FloweringPlant* pPlant,
     m_Reflectance(reflectance),
     m_bPollinated(false),
     m_iAntherPollen(pPlant->m_pPlantTypeConfig->antherInitPollen),
+    m_StigmaPollen(pPlant->m_Flowers.get_allocator()),
     m_iAvailableNectar(pPlant->m_pPlantTypeConfig->initNectar),
     m_fTemperature(pPlant->m_pPlantTypeConfig->initTemp),
     m_pPlant(pPlant),
@@ -60,6 +66,32 @@ Flower::Flower( FloweringPlant* pPlant,
 {}
 
 
+// restore a flower from a checkpoint, in the format written by saveState()
+Flower::Flower( FloweringPlant* pPlant,
+                CheckpointReader& reader ) :
+    m_StigmaPollen(pPlant->m_Flowers.get_allocator()),
+    m_pPlant(pPlant),
+    m_iAntherPollenTransferPerVisit(pPlant->m_pPlantTypeConfig->antherPollenTransferPerVisit),
+    m_iStigmaMaxPollenCapacity(pPlant->m_pPlantTypeConfig->stigmaMaxPollenCapacity),
+    m_bPollenCloggingAll(pPlant->m_pPlantTypeConfig->pollenCloggingAll),
+    m_bPollenCloggingPartial(pPlant->m_pPlantTypeConfig->pollenCloggingPartial),
+    m_CloggingSpeciesVec(pPlant->getCloggingSpeciesVec())
+{
+    m_id = reader.read<unsigned int>();
+    m_SpeciesId = reader.read<unsigned int>();
+    m_Position.x = reader.read<float>();
+    m_Position.y = reader.read<float>();
+    m_Reflectance.setMarkerPoint(reader.read<MarkerPoint>());
+    m_Reflectance.setVisDataPtr(reader.readVisDataHandle());
+    m_Reflectance.setVisDataIdx(ModelParams::getVisDataIdx(m_Reflectance));
+    m_bPollinated = reader.read<bool>();
+    m_iAntherPollen = reader.read<int>();
+    m_iAvailableNectar = reader.read<int>();
+    m_fTemperature = reader.read<float>();
+    m_LandingInfo.numPollinatorLandings = reader.read<int>();
+}
+
+
 // copy constructor
 Flower::Flower(const Flower& other) :
     m_id(m_sNextFreeId++),          // for copy constructor we assign a new id
@@ -181,14 +213,66 @@ void Flower::copyCommon(const Flower& other) noexcept
 }
 
 
+void Flower::saveState(CheckpointWriter& writer) const
+{
+    writer.write(m_id);
+    writer.write(m_SpeciesId);
+    writer.write(m_Position.x);
+    writer.write(m_Position.y);
+    writer.write(m_Reflectance.getMarkerPoint());
+    writer.writeVisDataHandle(m_Reflectance.getVisDataPtr());
+    writer.write(m_bPollinated);
+    writer.write(m_iAntherPollen);
+    writer.write(m_iAvailableNectar);
+    writer.write(m_fTemperature);
+    writer.write(m_LandingInfo.numPollinatorLandings);
+}
+
+
+void Flower::saveStigmaPollen(CheckpointWriter& writer) const
+{
+    writer.write<std::uint64_t>(m_StigmaPollen.size());
+    for (const Pollen& pollen : m_StigmaPollen)
+    {
+        writer.writeFlowerHandle(pollen.pSource);
+        writer.write(pollen.speciesId);
+        writer.write(pollen.numLandings);
+    }
+}
+
+
+void Flower::loadStigmaPollen(CheckpointReader& reader)
+{
+    m_StigmaPollen.clear();
+    std::uint64_t num = reader.read<std::uint64_t>();
+    m_StigmaPollen.reserve(num);
+    for (std::uint64_t i = 0; i < num; ++i)
+    {
+        const Flower* pSource = reader.readFlowerHandle();
+        unsigned int speciesId = reader.read<unsigned int>();
+        m_StigmaPollen.emplace_back(pSource, speciesId);
+        m_StigmaPollen.back().numLandings = reader.read<int>();
+    }
+}
+
+
 std::string Flower::getStateString() const
 {
-    std::stringstream ssState;
-    ssState << std::fixed << std::setprecision(3)
-        << m_id << "," << m_SpeciesId << "," << m_Position.x << "," << m_Position.y << ","
-        << getCharacteristicWavelength() << "," << (m_bPollinated ? "P":"N") << ","
-        << m_iAntherPollen << "," << m_StigmaPollen.size() << "," << m_iAvailableNectar;
-    return ssState.str();
+    std::string strState;
+    FlowerStatesSnapshot::writeRecord(strState, captureState());
+    return strState;
+}
+
+
+// Record the flower's current state for logging purposes. The format in which
+// the state is written out is defined by FlowerStatesSnapshot::writeRecord().
+FlowerStateRecord Flower::captureState() const
+{
+    return FlowerStateRecord {
+        m_id, m_SpeciesId, m_Position.x, m_Position.y,
+        getCharacteristicWavelength(), m_bPollinated,
+        m_iAntherPollen, m_StigmaPollen.size(), m_iAvailableNectar
+    };
 }
 
 
@@ -198,7 +282,7 @@ const std::string& Flower::getSpecies() const
 }
 
 
-int Flower::transferAntherPollenToPollinator(PollenVector& pollinatorStore)
+int Flower::transferAntherPollenToPollinator(PollenStore& pollinatorStore)
 {
     // calculate how many grains to transfer
     int num = std::min(m_iAntherPollenTransferPerVisit, m_iAntherPollen);
@@ -207,14 +291,10 @@ int Flower::transferAntherPollenToPollinator(PollenVector& pollinatorStore)
     m_iAntherPollen -= num;
 
     // ... and add it to the pollinator's store
-    // (NB this is where we actually create Pollen objects)
     // Note that we do not check the pollinatorStore's maximum capacity here,
     // this is the responsibility of the pollinator after it has called this
     // method.
-    for (int i = 0; i < num; ++i)
-    {
-        pollinatorStore.emplace_back(this, m_SpeciesId);
-    }
+    pollinatorStore.add(this, m_SpeciesId, num);
 
     // return the number of grains transferred
     return num;
@@ -228,7 +308,7 @@ int Flower::transferAntherPollenToPollinator(PollenVector& pollinatorStore)
 // the requested and actual number of pollen grains transferred is removed
 // from the pollinator's store and treated as lost.
 //
-int Flower::transferPollenFromPollinator(PollenVector& pollinatorStore, int suggestedNum)
+int Flower::transferPollenFromPollinator(PollenStore& pollinatorStore, int suggestedNum)
 {
     // first figure out how many grains we should attempt to transfer,
     // taking into account the suggested number from the pollinator, the
@@ -236,65 +316,43 @@ int Flower::transferPollenFromPollinator(PollenVector& pollinatorStore, int sugg
     // being carried by the pollinator
     int attemptedNum = std::min({suggestedNum,
                                  m_iStigmaMaxPollenCapacity - (int)m_StigmaPollen.size(),
-                                 (int)pollinatorStore.size()});
+                                 pollinatorStore.size()});
 
     int actualNum = 0;
 
-    // now calculate how many grains we can actually move from the pollinatorStore,
-    // taking account of the pollen species if necessary, and ensure that all grains
-    // to be moved are placed at the end of the pollinatorStore ready for being
-    // moved in bulk
-    if (FloweringPlant::cloggingAll())
+    // if the stigma can hold more grains than fit inline, then the first time that they
+    // overflow the inline storage, make room for as many grains as it can hold (unless
+    // that is a very large number), so that it rarely needs to grow again
+    if ((attemptedNum > 0) && m_StigmaPollen.isInline() &&
+        (m_StigmaPollen.size() + attemptedNum > m_StigmaPollen.capacity()))
     {
-        // No restriction on pollen species, so we can grab any pollen from
-        // the pollinator. Note that the pollinator's store should already be shuffled,
-        // so we can just pick the required number of grains from the end of the
-        // store, and this will be a random selection
-        actualNum = attemptedNum;
+        m_StigmaPollen.reserve(std::min(m_iStigmaMaxPollenCapacity, m_sMaxInitialStigmaSlots));
     }
-    else
+
+    // now move a random selection of grains from the pollinatorStore to the stigma,
+    // taking account of the pollen species if necessary
+    if (attemptedNum > 0)
     {
-        // We can only transfer pollen of the same species as this flower, so we need
-        // to look through the pollinator's store and select which grains we will take.
-        // For efficiency, we do this by first searching through the pollinator's store
-        // and moving any matching pollen to the end of the store (we exit this process
-        // when we've found enough pollen, or when we've reached the end of the store).
-        if (!pollinatorStore.empty())
+        if (FloweringPlant::cloggingAll())
         {
-            auto nextItr = pollinatorStore.begin();
-            auto swapItr = pollinatorStore.end();
-
-            while ((nextItr != swapItr) && (actualNum < attemptedNum))
-            {
-                if (FloweringPlant::pollenTransferToStigmaAllowed(nextItr->pSource, this))
-                {
-                    --swapItr;
-                    if (nextItr != swapItr)
-                    {
-                        std::iter_swap(nextItr, swapItr);
-                    }
-                    ++actualNum;
-                }
-                else
-                {
-                    ++nextItr;
-                }
-            }
+            // No restriction on pollen species, so we can grab any pollen from
+            // the pollinator
+            actualNum = pollinatorStore.moveRandomGrains(attemptedNum,
+                                                         [](const Flower*){return true;},
+                                                         m_StigmaPollen);
+        }
+        else
+        {
+            // We can only transfer pollen of the species allowed on this flower's stigma
+            actualNum = pollinatorStore.moveRandomGrains(attemptedNum,
+                                                         [this](const Flower* pSource)
+                                                         {return FloweringPlant::pollenTransferToStigmaAllowed(pSource, this);},
+                                                         m_StigmaPollen);
         }
     }
 
-    // Whether m_bPollenClogging is true or false, we have now figured out how many grains
-    // are to be moved, and the grains we want to move are now at the end of the pollinatorStore.
-    // Now we actually move those grains to the stigma store in one operation, and delete
-    // them from the pollinatorStore.
     if (actualNum > 0)
     {
-        std::move(pollinatorStore.end()-actualNum,
-                  pollinatorStore.end(),
-                  std::back_inserter(m_StigmaPollen));
-
-        pollinatorStore.erase(pollinatorStore.end()-actualNum, pollinatorStore.end());
-
         // if not already pollinated, check whether that has now changed!
         if (!m_bPollinated)
         {
@@ -326,9 +384,7 @@ int Flower::transferPollenFromPollinator(PollenVector& pollinatorStore, int sugg
     // loses the difference anyway
     if (actualNum < suggestedNum)
     {
-        // first ensure we don't try to lose more than is actually in the pollinator's store
-        int numToLose = std::min({ suggestedNum-actualNum, (int)pollinatorStore.size() });
-        pollinatorStore.erase(pollinatorStore.end()-numToLose, pollinatorStore.end());
+        pollinatorStore.removeRandomGrains(suggestedNum - actualNum);
     }
 
     return actualNum;
@@ -15,8 +15,10 @@
 #include "EvoBeeModel.h"
 #include "FloweringPlant.h"
 #include "Patch.h"
+#include "Environment.h"
 #include "ModelParams.h"
 #include "Hymenoptera.h"
+#include "Checkpoint.h"
 #include "tools.h"
 
 
@@ -27,6 +29,8 @@ std::map<unsigned int, std::string> FloweringPlant::m_sSpeciesMap;
 std::map<unsigned int, std::string> FloweringPlant::m_sInitialSpeciesMap;
 std::map<unsigned int, std::vector<unsigned int>> FloweringPlant::m_sSpeciesHexBinMap;
 std::map<unsigned int, std::vector<unsigned int>> FloweringPlant::m_sCloggingMap;
+std::vector<bool> FloweringPlant::m_sCloggingMatrix;
+unsigned int FloweringPlant::m_sCloggingMatrixDim = 0;
 bool FloweringPlant::m_sbCloggingAll = false;
 bool FloweringPlant::m_sbCloggingNone = false;
 
@@ -34,9 +38,11 @@ bool FloweringPlant::m_sbCloggingNone = false;
 // Create a brand new plant at the start of the simulation from the specified config
 FloweringPlant::FloweringPlant(const PlantTypeConfig& typeConfig,
                                const fPos& pos,
-                               Patch* pPatch) :
+                               Patch* pPatch,
+                               GenerationArena& arena) :
     m_id(m_sNextFreeId++),
     m_Position(pos),
+    m_Flowers(ArenaAllocator<Flower>(&arena)),
     m_bHasLeaf(typeConfig.hasLeaf),
     m_bPollinated(false),
     m_pPatch(pPatch)
@@ -54,6 +60,7 @@ FloweringPlant::FloweringPlant(const PlantTypeConfig& typeConfig,
         m_LeafReflectance.setMarkerPoint(typeConfig.leafMP);
     }
 
+    m_Flowers.reserve(typeConfig.numFlowers);
     for (int i=0; i < typeConfig.numFlowers; ++i)
     {
         switch (ModelParams::getColourSystem())
@@ -103,8 +110,10 @@ FloweringPlant::FloweringPlant(const PlantTypeConfig& typeConfig,
 FloweringPlant::FloweringPlant( const FloweringPlant* pParent,
                                 const fPos& pos,
                                 Patch* pPatch,
-                                bool  mutate ) :
+                                bool  mutate,
+                                GenerationArena& arena ) :
     m_id(m_sNextFreeId++),
+    m_Flowers(ArenaAllocator<Flower>(&arena)),
     m_bPollinated(false)
 {
     assert(pParent != nullptr);
@@ -116,6 +125,7 @@ FloweringPlant::FloweringPlant( const FloweringPlant* pParent,
     m_Position = pos;
     m_bHasLeaf = pParent->m_bHasLeaf;
     m_LeafReflectance = pParent->m_LeafReflectance;
+    m_Flowers.reserve(pParent->m_Flowers.size());
     for (const Flower& parentFlower : pParent->m_Flowers)
     {
         ///@todo take note of the mutate param, and maybe change some values,
@@ -126,6 +136,31 @@ FloweringPlant::FloweringPlant( const FloweringPlant* pParent,
 }
 
 
+// Restore a plant from a checkpoint, in the format written by saveState()
+FloweringPlant::FloweringPlant(CheckpointReader& reader, Patch* pPatch, GenerationArena& arena) :
+    m_Flowers(ArenaAllocator<Flower>(&arena)),
+    m_pPatch(pPatch)
+{
+    assert(pPatch != nullptr);
+
+    m_id = reader.read<unsigned int>();
+    m_SpeciesId = reader.read<unsigned int>();
+    m_pPlantTypeConfig = reader.readPlantTypeConfigHandle();
+    m_Position.x = reader.read<float>();
+    m_Position.y = reader.read<float>();
+    m_bHasLeaf = reader.read<bool>();
+    m_LeafReflectance.setMarkerPoint(reader.read<MarkerPoint>());
+    m_bPollinated = reader.read<bool>();
+
+    std::uint64_t numFlowers = reader.read<std::uint64_t>();
+    m_Flowers.reserve(numFlowers);
+    for (std::uint64_t i = 0; i < numFlowers; ++i)
+    {
+        m_Flowers.emplace_back(this, reader);
+    }
+}
+
+
 // copy constructor
 FloweringPlant::FloweringPlant(const FloweringPlant& other) :
     m_id(m_sNextFreeId++),          // for copy constructor we assign a new id
@@ -209,6 +244,60 @@ void FloweringPlant::copyCommon(const FloweringPlant& other) noexcept
 }
 
 
+void FloweringPlant::saveState(CheckpointWriter& writer) const
+{
+    writer.write(m_id);
+    writer.write(m_SpeciesId);
+    writer.writePlantTypeConfigHandle(m_pPlantTypeConfig);
+    writer.write(m_Position.x);
+    writer.write(m_Position.y);
+    writer.write(m_bHasLeaf);
+    writer.write(m_LeafReflectance.getMarkerPoint());
+    writer.write(m_bPollinated);
+
+    writer.write<std::uint64_t>(m_Flowers.size());
+    for (const Flower& flower : m_Flowers)
+    {
+        flower.saveState(writer);
+    }
+}
+
+
+// The species map is saved so that the species ids of any species registered
+// during the run are restored exactly. The other static maps (the initial
+// species map, hex bin map and clogging map) are constructed from the config
+// at the start of a run and never change, so they do not need to be saved.
+void FloweringPlant::saveStaticState(CheckpointWriter& writer)
+{
+    writer.write(m_sNextFreeId);
+    writer.write(m_sNextFreeSpeciesId);
+    writer.write<std::uint64_t>(m_sSpeciesMap.size());
+    for (auto& species : m_sSpeciesMap)
+    {
+        writer.write(species.first);
+        writer.writeString(species.second);
+    }
+}
+
+
+void FloweringPlant::loadStaticState(CheckpointReader& reader)
+{
+    m_sNextFreeId = reader.read<unsigned int>();
+    m_sNextFreeSpeciesId = reader.read<unsigned int>();
+    m_sSpeciesMap.clear();
+    std::uint64_t numSpecies = reader.read<std::uint64_t>();
+    for (std::uint64_t i = 0; i < numSpecies; ++i)
+    {
+        unsigned int speciesId = reader.read<unsigned int>();
+        m_sSpeciesMap[speciesId] = reader.readString();
+    }
+
+    // make room in the clogging matrix for any species that were registered
+    // during the run before the checkpoint was written
+    growCloggingMatrix(m_sNextFreeSpeciesId);
+}
+
+
 // Static method to register a species in the species map, given a species name
 // If the name is not already in the map, then a new speciesId is assigned to it
 // and it is added to the map.
@@ -235,6 +324,9 @@ unsigned int FloweringPlant::registerSpecies(const std::string& species)
         speciesId = m_sNextFreeSpeciesId++;
         m_sSpeciesMap[speciesId] = species;
 
+        // give the new species a (blank) row and column in the clogging matrix
+        growCloggingMatrix(m_sNextFreeSpeciesId);
+
         if (ModelParams::verbose())
         {
             std::cout << "Adding new plant species to map: id=" << speciesId << ", name=" <<
@@ -359,6 +451,12 @@ float FloweringPlant::getDistanceSq(const fPos& point) const
 
 void FloweringPlant::setPollinated(bool pollinated)
 {
+    // keep the Environment's running count of pollinated plants up to date
+    if ((pollinated != m_bPollinated) && (m_pPatch != nullptr))
+    {
+        m_pPatch->getEnvironment()->updatePollinatedPlantCount(m_SpeciesId, pollinated);
+    }
+
     m_bPollinated = pollinated;
 }
 
@@ -572,6 +670,42 @@ void FloweringPlant::constructCloggingMap(std::vector<PlantTypeConfig>& ptcs)
     }
     m_sbCloggingAll = (numFull == numSpecies);
     m_sbCloggingNone = (numEmpty == numSpecies);
+
+    // Finally, build the dense clogging matrix from the clogging map
+    growCloggingMatrix(m_sNextFreeSpeciesId);
+    for (auto& entry : m_sCloggingMap)
+    {
+        for (unsigned int cloggedSpeciesId : entry.second)
+        {
+            m_sCloggingMatrix[entry.first * m_sCloggingMatrixDim + cloggedSpeciesId] = true;
+        }
+    }
+}
+
+
+// The matrix is grown to at least double its previous size, so that registering
+// a long series of new species (e.g. under random introductions) only copies
+// the existing entries a logarithmic number of times
+void FloweringPlant::growCloggingMatrix(unsigned int numSpeciesIds)
+{
+    if (numSpeciesIds <= m_sCloggingMatrixDim)
+    {
+        return;
+    }
+
+    unsigned int newDim = std::max(numSpeciesIds, 2 * m_sCloggingMatrixDim);
+    std::vector<bool> newMatrix(newDim * newDim, false);
+
+    for (unsigned int row = 0; row < m_sCloggingMatrixDim; ++row)
+    {
+        for (unsigned int col = 0; col < m_sCloggingMatrixDim; ++col)
+        {
+            newMatrix[row * newDim + col] = m_sCloggingMatrix[row * m_sCloggingMatrixDim + col];
+        }
+    }
+
+    m_sCloggingMatrix.swap(newMatrix);
+    m_sCloggingMatrixDim = newDim;
 }
 
 
@@ -614,26 +748,7 @@ bool FloweringPlant::pollenTransferToStigmaAllowed(const Flower* pPollenSource,
     }
     else
     {
-        auto it = m_sCloggingMap.find(pollenSpeciesId);
-
-        if (it == m_sCloggingMap.end())
-        {
-            std::stringstream msg;
-            msg << "Error: request for clogging species map of unknown species " << pollenSpeciesId;
-            throw std::runtime_error(msg.str());
-        }
-        else
-        {
-            const std::vector<unsigned int>& cloggedSp = it->second;
-            auto it = std::find(cloggedSp.begin(), cloggedSp.end(), flowerSpeciesId);
-            if (it != cloggedSp.end())
-            {
-                return true;
-            }
-            else
-            {
-                return false;
-            }
-        }
+        assert((pollenSpeciesId < m_sCloggingMatrixDim) && (flowerSpeciesId < m_sCloggingMatrixDim));
+        return m_sCloggingMatrix[pollenSpeciesId * m_sCloggingMatrixDim + flowerSpeciesId];
     }
 }
\ No newline at end of file
@@ -0,0 +1,91 @@
+/**
+ * @file
+ *
+ * Implementation of the GenerationArena class
+ */
+
+#include <cassert>
+#include <algorithm>
+#include "GenerationArena.h"
+
+
+GenerationArena::GenerationArena() :
+    m_iBlockOffset(0),
+    m_iBytesUsed(0)
+{
+}
+
+
+void* GenerationArena::allocate(std::size_t numBytes, std::size_t alignment)
+{
+    assert(alignment <= alignof(std::max_align_t));
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    // round the offset in the current block up to the required alignment (each block
+    // itself is allocated with the alignment of std::max_align_t)
+    std::size_t offset = (m_iBlockOffset + alignment - 1) & ~(alignment - 1);
+
+    if (m_Blocks.empty() || (offset + numBytes > m_BlockSizes.back()))
+    {
+        addBlock(numBytes);
+        offset = 0;
+    }
+
+    m_iBytesUsed += (offset - m_iBlockOffset) + numBytes;
+    m_iBlockOffset = offset + numBytes;
+
+    return m_Blocks.back().get() + offset;
+}
+
+
+void GenerationArena::reserve(std::size_t numBytes)
+{
+    assert(m_iBytesUsed == 0);
+
+    if (m_Blocks.empty() || (m_BlockSizes.front() < numBytes))
+    {
+        m_Blocks.clear();
+        m_BlockSizes.clear();
+        addBlock(numBytes);
+    }
+}
+
+
+// If more than one block was needed since the arena was last reset, the blocks are
+// replaced by a single one that is large enough for all of them
+void GenerationArena::reset()
+{
+    if (m_Blocks.size() > 1)
+    {
+        std::size_t totalSize = 0;
+        for (std::size_t size : m_BlockSizes)
+        {
+            totalSize += size;
+        }
+
+        m_Blocks.clear();
+        m_BlockSizes.clear();
+        addBlock(totalSize);
+    }
+
+    m_iBlockOffset = 0;
+    m_iBytesUsed = 0;
+}
+
+
+// Each new block is at least as large as all of the existing blocks put together, so
+// the number of blocks grows only logarithmically with the amount allocated
+void GenerationArena::addBlock(std::size_t numBytes)
+{
+    std::size_t existingSize = 0;
+    for (std::size_t blockSize : m_BlockSizes)
+    {
+        existingSize += blockSize;
+    }
+    std::size_t size = std::max({numBytes, existingSize, m_sMinBlockSize});
+
+    m_Blocks.emplace_back(new unsigned char[size]);
+    m_BlockSizes.push_back(size);
+    m_iBlockOffset = 0;
+}
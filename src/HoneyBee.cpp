@@ -35,9 +35,9 @@ void HoneyBee::reset()
     Hymenoptera::reset();
 }
 
-std::string HoneyBee::getStateString() const
+void HoneyBee::captureState(PollinatorStatesSnapshot& snapshot) const
 {
-    return Hymenoptera::getStateString();
+    Hymenoptera::captureState(snapshot);
 }
 
 
@@ -10,9 +10,12 @@
 #include <sstream>
 #include <map>
 #include <algorithm>
+#include <numeric>
 #include <cassert>
 #include "Hymenoptera.h"
 #include "PollinatorStructs.h"
+#include "LogSnapshot.h"
+#include "Checkpoint.h"
 #include "EvoBeeModel.h"
 #include "ModelParams.h"
 #include "tools.h"
@@ -22,6 +25,8 @@
 
 // Instantiate static data members
 std::string Hymenoptera::m_sTypeNameStr{"HYM"};
+std::vector<VisualPreferenceInfo> Hymenoptera::m_sVisPrefPrototypes;
+std::vector<unsigned int> Hymenoptera::m_sVisPrefPrototypeRanking;
 std::vector<VisualStimulusInfo> Hymenoptera::m_sVisData;
 MarkerPoint Hymenoptera::m_sVisDataMPMin = 1;
 MarkerPoint Hymenoptera::m_sVisDataMPStep = 1;
@@ -32,11 +37,25 @@ float Hymenoptera::m_sVisProbLandIncrementOnReward = 0.01;
 float Hymenoptera::m_sVisProbLandDecrementOnNoReward = 0.01;
 float Hymenoptera::m_sVisProbLandDecrementOnUnseen = 0.005;
 bool Hymenoptera::m_sbVisTargetExactMatchOnly = false;
+std::vector<float> Hymenoptera::m_sVisMatchConfidenceTable;
+std::vector<int> Hymenoptera::m_sVisDataIdxFromId;
+int Hymenoptera::m_sVisDataMinId = 0;
 bool Hymenoptera::m_sbStaticsInitialised = false;
 
 
+namespace
+{
+    // The largest number of entries we are prepared to store in the vis-match
+    // confidence table (or its id lookup table) before falling back to calculating
+    // each confidence level when it is needed
+    const std::size_t maxVisMatchTableEntries = 1 << 24;
+}
+
+
 Hymenoptera::Hymenoptera(const PollinatorConfig& pc, AbstractHive* pHive) :
-    Pollinator(pc, pHive)
+    Pollinator(pc, pHive),
+    m_VisPrefPristineCursor(0),
+    m_iNumAttenuations(0)
 {
     // first initialise the Hymenoptera class' static data relating to its visual system,
     // if this has not already been done
@@ -51,13 +70,22 @@ Hymenoptera::Hymenoptera(const PollinatorConfig& pc, AbstractHive* pHive) :
         m_sVisProbLandDecrementOnNoReward = pc.visProbLandDecrementOnNoReward;
         m_sVisProbLandDecrementOnUnseen = pc.visProbLandDecrementOnUnseen;
         m_sbVisTargetExactMatchOnly = pc.visTargetExactMatchOnly;
+        buildVisMatchConfidenceTable();
         m_sbStaticsInitialised = true;
     }
 
-    // initialise this instance's visual preference data
+    // initialise this instance's visual preference data. The preferences themselves start off
+    // as copies of the prototypes shared by all pollinators, so all we need to record here is
+    // this pollinator's individual variation in its base probability of landing on non-targets
     std::normal_distribution<float> dist(0.0, pc.visProbLandNonTargetIndivStdDev);
 
     if (m_ConstancyType == PollinatorConstancyType::VISUAL) {
+        if (m_sVisPrefPrototypes.empty()) {
+            buildVisPrefPrototypes();
+        }
+
+        m_VisPrefBaseProbLandNonTarget.reserve(m_sVisPrefPrototypes.size());
+
         switch (ModelParams::getColourSystem())
         {
             case ColourSystem::REGULAR_MARKER_POINTS: {
@@ -66,30 +94,19 @@ Hymenoptera::Hymenoptera(const PollinatorConfig& pc, AbstractHive* pHive) :
                     float baseProbLandNonTargetInnate = getBaseProbLandNonTargetInnate(mp);
                     float baseProbLandNonTargetIndivDelta = dist(EvoBeeModel::m_sRngEngine);
                     float baseProbLandNonTarget = baseProbLandNonTargetInnate + baseProbLandNonTargetIndivDelta;
-                    m_VisualPreferences.emplace_back(mp, m_sVisBaseProbLandTarget, baseProbLandNonTarget);
+                    VisualPreferenceInfo vpi(mp, m_sVisBaseProbLandTarget, baseProbLandNonTarget);
+                    m_VisPrefBaseProbLandNonTarget.push_back(vpi.baseProbLandNonTarget);
                 }
                 break;
             }
             case ColourSystem::ARBITRARY_DOMINANT_WAVELENGTHS: {
-                // Note that this code was implemented as an amendment to the constructor to deal with
-                // the case of ColourSystem = ARBITRARY_DOMINANT_WAVELENGTHS. But actually we could just
-                // as well remove the REGULAR_MARKER_POINTS case above and initialise m_VisualPreferences
-                // as shown below in ALL cases. The end result should be the same.
-                //
-                // This way of doing it is actually better because it makes explicit a property that
-                // we rely on elsewhere in the code (e.g. in the Hymenoptera::getVisXXXFromMP methods) -
-                // that the m_VisualPreferences and m_sVisData vectors mirror each other in terms of
-                // number and order of entries with respect to markerpoints/wavelengths (so the same index
-                // refers to the same wavelength in both vectors).
-                //
-                // For the time being we have left the old implementation of the REGULAR_MARKER_POINTS
-                // case above as is, on the basis of "if it ain't broke, don't fix it".
                 for (auto& vsi : m_sVisData) {
                     Wavelength lambda = vsi.getWavelength();
                     float baseProbLandNonTargetInnate = getBaseProbLandNonTargetInnate(lambda);
                     float baseProbLandNonTargetIndivDelta = dist(EvoBeeModel::m_sRngEngine);
                     float baseProbLandNonTarget = baseProbLandNonTargetInnate + baseProbLandNonTargetIndivDelta;
-                    m_VisualPreferences.emplace_back(&vsi, m_sVisBaseProbLandTarget, baseProbLandNonTarget);
+                    VisualPreferenceInfo vpi(&vsi, m_sVisBaseProbLandTarget, baseProbLandNonTarget);
+                    m_VisPrefBaseProbLandNonTarget.push_back(vpi.baseProbLandNonTarget);
 
                     if (vsi.id == m_iPresetPrefVisDataID) {
                         m_PresetPrefVisDataPtr = &vsi;
@@ -101,6 +118,23 @@ Hymenoptera::Hymenoptera(const PollinatorConfig& pc, AbstractHive* pHive) :
                 throw std::runtime_error("Encountered unexpected ColourSystem specification in Hymenoptera constructor. Aborting!");
             }
         }
+
+        assert(m_VisPrefBaseProbLandNonTarget.size() == m_sVisPrefPrototypes.size());
+
+        // if there turns out to be no individual variation, just use the prototypes' values
+        bool bSameAsPrototypes = true;
+        for (std::size_t idx = 0; idx < m_sVisPrefPrototypes.size(); ++idx)
+        {
+            if (m_VisPrefBaseProbLandNonTarget[idx] != m_sVisPrefPrototypes[idx].baseProbLandNonTarget)
+            {
+                bSameAsPrototypes = false;
+                break;
+            }
+        }
+        if (bSameAsPrototypes) {
+            m_VisPrefBaseProbLandNonTarget.clear();
+            m_VisPrefBaseProbLandNonTarget.shrink_to_fit();
+        }
     }
 
     if (m_LearningStrategy == PollinatorLearningStrategy::STAY_RND) {
@@ -113,13 +147,23 @@ Hymenoptera::Hymenoptera(const PollinatorConfig& pc, AbstractHive* pHive) :
 
 Hymenoptera::Hymenoptera(const Hymenoptera& other) :
     Pollinator(other),
-    m_VisualPreferences(other.m_VisualPreferences)
+    m_VisPrefBaseProbLandNonTarget(other.m_VisPrefBaseProbLandNonTarget),
+    m_VisPrefBaseRanking(other.m_VisPrefBaseRanking),
+    m_VisPrefOverlay(other.m_VisPrefOverlay),
+    m_VisPrefRanking(other.m_VisPrefRanking),
+    m_VisPrefPristineCursor(other.m_VisPrefPristineCursor),
+    m_iNumAttenuations(other.m_iNumAttenuations)
 {
 }
 
 Hymenoptera::Hymenoptera(Hymenoptera&& other) noexcept :
     Pollinator(std::move(other)),
-    m_VisualPreferences(std::move(other.m_VisualPreferences))
+    m_VisPrefBaseProbLandNonTarget(std::move(other.m_VisPrefBaseProbLandNonTarget)),
+    m_VisPrefBaseRanking(std::move(other.m_VisPrefBaseRanking)),
+    m_VisPrefOverlay(std::move(other.m_VisPrefOverlay)),
+    m_VisPrefRanking(std::move(other.m_VisPrefRanking)),
+    m_VisPrefPristineCursor(other.m_VisPrefPristineCursor),
+    m_iNumAttenuations(other.m_iNumAttenuations)
 {
 }
 
@@ -127,10 +171,8 @@ void Hymenoptera::reset()
 {
     Pollinator::reset();
 
-    for (VisualPreferenceInfo& vpi : m_VisualPreferences)
-    {
-        vpi.reset();
-    }
+    // only the preferences modified since the last reset need to be discarded
+    clearVisPrefOverlay();
 
     if (m_LearningStrategy == PollinatorLearningStrategy::STAY_RND) {
         pickRandomTarget();
@@ -402,23 +444,65 @@ float Hymenoptera::getPresetPref(Wavelength lambda)
 }
 
 
-// Output the hymenoptera's current state as a string, suitable for logging purposes.
+// Record the hymenoptera's current state for logging purposes, adding its target
+// wavelength and visual preferences to the state recorded by Pollinator::captureState().
 // Note, if you are looking at this code to understand the contents of a log file,
 // remember that the Hymenoptera class is a virtual class. Classes that
-// inherit from Hymenoptera may append additional information to this string,
-// e.g. see HoneyBee::getStateString().
-std::string Hymenoptera::getStateString() const
+// inherit from Hymenoptera may append additional information to this record,
+// e.g. see HoneyBee::captureState().
+void Hymenoptera::captureState(PollinatorStatesSnapshot& snapshot) const
 {
-    std::string polState = Pollinator::getStateString();
-    std::stringstream ssState;
-    ssState << std::fixed << std::setprecision(3);
-    ssState << ",//," << getTargetWavelength() << ",::,";
-    for (auto& vpi : m_VisualPreferences)
+    Pollinator::captureState(snapshot);
+
+    PollinatorStateRecord& rec = snapshot.records.back();
+    rec.hasVisualState = true;
+    rec.targetWavelength = getTargetWavelength();
+    rec.prefsBegin = snapshot.prefs.size();
+    for (std::size_t idx = 0; idx < getNumVisPrefs(); ++idx)
     {
-        ssState << vpi.getWavelength() << "," << vpi.probLandTarget << "," << vpi.probLandNonTarget << ",";
+        VisualPreferenceInfo vpi = getVisPrefConst(idx);
+        snapshot.prefs.push_back({vpi.getWavelength(), vpi.probLandTarget, vpi.probLandNonTarget});
+    }
+    rec.prefsEnd = snapshot.prefs.size();
+}
+
+
+// The base landing probabilities and vis-data pointers of the visual preferences
+// are fixed when the pollinator is constructed, so only the current landing
+// probabilities need to be saved (including any pending attenuation)
+void Hymenoptera::saveState(CheckpointWriter& writer) const
+{
+    Pollinator::saveState(writer);
+
+    writer.write<std::uint64_t>(getNumVisPrefs());
+    for (std::size_t idx = 0; idx < getNumVisPrefs(); ++idx)
+    {
+        VisualPreferenceInfo vpi = getVisPrefConst(idx);
+        writer.write(vpi.probLandTarget);
+        writer.write(vpi.probLandNonTarget);
+    }
+}
+
+
+void Hymenoptera::loadState(CheckpointReader& reader)
+{
+    Pollinator::loadState(reader);
+
+    clearVisPrefOverlay();
+
+    // only the preferences that differ from their base values need their own copy
+    reader.expectCount(getNumVisPrefs(), "visual preferences per pollinator");
+    for (std::size_t idx = 0; idx < getNumVisPrefs(); ++idx)
+    {
+        VisualPreferenceInfo vpi = makeBaseVisPref(idx);
+        vpi.probLandTarget = reader.read<float>();
+        vpi.probLandNonTarget = reader.read<float>();
+        if ((vpi.probLandTarget != vpi.baseProbLandTarget) || (vpi.probLandNonTarget != vpi.baseProbLandNonTarget))
+        {
+            m_VisPrefOverlay.emplace(idx, vpi);
+        }
     }
-    ssState << "::";
-    return polState + ssState.str();
+    rebuildVisPrefRanking();
 }
 
 
@@ -476,7 +560,114 @@ const VisualStimulusInfo& Hymenoptera::getVisStimulusInfo(MarkerPoint mp) const
 }
 
 
-// A helper method to calculate the index of a specific entry in the m_sVisData or m_VisualPreferences vectors
+float Hymenoptera::confidenceMatchesTarget(const ReflectanceInfo& stimulus) const
+{
+    if (!m_sVisMatchConfidenceTable.empty())
+    {
+        int stimulusIdx = getVisMatchTableIdx(stimulus);
+        int targetIdx = getVisMatchTableIdx(m_TargetReflectance);
+        if ((stimulusIdx >= 0) && (targetIdx >= 0))
+        {
+            return m_sVisMatchConfidenceTable[stimulusIdx * m_sVisData.size() + targetIdx];
+        }
+    }
+
+    // if the table is not available, or either stimulus is not in it (in which case
+    // the base class method will report the problem), calculate the confidence directly
+    return Pollinator::confidenceMatchesTarget(stimulus);
+}
+
+
+// The vis-data is fixed once it has been read from the config file, so we can
+// calculate the confidence of match between every pair of entries in advance.
+// Under ARBITRARY_DOMINANT_WAVELENGTHS, stimuli may point to the copy of the vis-data
+// held in ModelParams rather than to m_sVisData, so we look them up by id.
+void Hymenoptera::buildVisMatchConfidenceTable()
+{
+    m_sVisMatchConfidenceTable.clear();
+    m_sVisDataIdxFromId.clear();
+
+    std::size_t num = m_sVisData.size();
+    if ((num == 0) || (num > maxVisMatchTableEntries / num))
+    {
+        return;
+    }
+
+    if (ModelParams::getColourSystem() == ColourSystem::ARBITRARY_DOMINANT_WAVELENGTHS)
+    {
+        auto itMinMax = std::minmax_element(m_sVisData.begin(),
+                                            m_sVisData.end(),
+                                            [](const VisualStimulusInfo& a, const VisualStimulusInfo& b) {return (a.id < b.id);});
+        int minId = itMinMax.first->id;
+        int maxId = itMinMax.second->id;
+        if ((minId < 0) || ((std::size_t)(maxId - minId) >= maxVisMatchTableEntries))
+        {
+            return;
+        }
+
+        m_sVisDataMinId = minId;
+        m_sVisDataIdxFromId.assign(maxId - minId + 1, -1);
+        for (std::size_t i = 0; i < num; ++i)
+        {
+            int& idx = m_sVisDataIdxFromId[m_sVisData[i].id - minId];
+            if (idx >= 0)
+            {
+                // ids are not unique, so we cannot use them to look up stimuli
+                m_sVisDataIdxFromId.clear();
+                return;
+            }
+            idx = (int)i;
+        }
+    }
+    else if (m_sVisDataMPStep == 0)
+    {
+        return;
+    }
+
+    m_sVisMatchConfidenceTable.resize(num * num);
+    for (std::size_t stimulusIdx = 0; stimulusIdx < num; ++stimulusIdx)
+    {
+        for (std::size_t targetIdx = 0; targetIdx < num; ++targetIdx)
+        {
+            float hexDistance = getVisHexDistance(m_sVisData[stimulusIdx], m_sVisData[targetIdx], false);
+            m_sVisMatchConfidenceTable[stimulusIdx * num + targetIdx] = getVisMatchConfidence(hexDistance);
+        }
+    }
+}
+
+
+int Hymenoptera::getVisMatchTableIdx(const ReflectanceInfo& rinfo)
+{
+    if (ModelParams::getColourSystem() == ColourSystem::ARBITRARY_DOMINANT_WAVELENGTHS)
+    {
+        const VisualStimulusInfo* pInfo = rinfo.getVisDataPtr();
+        if (pInfo == nullptr)
+        {
+            return -1;
+        }
+
+        int offset = pInfo->id - m_sVisDataMinId;
+        if ((offset < 0) || ((std::size_t)offset >= m_sVisDataIdxFromId.size()))
+        {
+            return -1;
+        }
+        return m_sVisDataIdxFromId[offset];
+    }
+    else
+    {
+        MarkerPoint mp = rinfo.getMarkerPoint();
+        if ((mp < m_sVisDataMPMin) || (mp > m_sVisDataMPMax) || ((mp - m_sVisDataMPMin) % m_sVisDataMPStep != 0))
+        {
+            return -1;
+        }
+
+        std::size_t idx = (std::size_t)((mp - m_sVisDataMPMin) / m_sVisDataMPStep);
+        return (idx < m_sVisData.size()) ? (int)idx : -1;
+    }
+}
+
+
+// A helper method to calculate the index of a specific entry in the m_sVisData or m_sVisPrefPrototypes vectors
 // that corresponds to the given Marker Point
 std::size_t Hymenoptera::getVisualDataVectorIdx(Wavelength lambda)
 {
@@ -578,55 +769,44 @@ const VisualStimulusInfo& Hymenoptera::getSingleVisStimInfoFromWavelength(Wavele
     }
 }
 
-// Find the first entry in the m_VisualPreferences vector that matches the given wavelength.
-// N.B. if there are multiple entries in the vector that share the same wavelength (remember that
+// Find the index of the first visual preference that matches the given wavelength.
+// N.B. if there are multiple preferences that share the same wavelength (remember that
 // wavelengths are stored as ints, rounded to the nearest whole number) then only the first entry
 // will ever get returned by this method.
-VisualPreferenceInfo& Hymenoptera::getVisPrefInfoFromWavelength(Wavelength lambda)
-{
-    // We already have a const version of this method, which is called
-    // Hymenoptera::getVisPrefInfoFromWavelengthConst(Wavelength lambda). Here we wish to do exactly
-    // the same as that method but just return a non-const reference rather than a const one.
-    // The following list uses casts to allow us to do that without duplicating the code. It looks
-    // a bit scarey but is safe in this context. For more info on this approach, see
-    // https://stackoverflow.com/questions/123758/how-do-i-remove-code-duplication-between-similar-const-and-non-const-member-func/123995
-
-    return const_cast<VisualPreferenceInfo&>(static_cast<const Hymenoptera&>(*this).getVisPrefInfoFromWavelengthConst(lambda));
-}
-
-// Find the first entry in the m_VisualPreferences vector that matches the given wavelength.
-// N.B. if there are multiple entries in the vector that share the same wavelength (remember that
-// wavelengths are stored as ints, rounded to the nearest whole number) then only the first entry
-// will ever get returned by this method.
-const VisualPreferenceInfo& Hymenoptera::getVisPrefInfoFromWavelengthConst(Wavelength lambda) const
+std::size_t Hymenoptera::getVisPrefIdxFromWavelength(Wavelength lambda) const
 {
     switch (ModelParams::getColourSystem())
     {
         case ColourSystem::REGULAR_MARKER_POINTS:
         {
             std::size_t idx = getVisualDataVectorIdx(lambda);
-            return m_VisualPreferences.at(idx);
+            if (idx >= getNumVisPrefs()) {
+                std::stringstream msg;
+                msg << "Visual preference index " << idx << " for wavelength=" << lambda << " is out of range in Hymenoptera::getVisPrefIdxFromWavelength! Aborting.\n";
+                throw std::runtime_error(msg.str());
+            }
+            return idx;
         }
         case ColourSystem::ARBITRARY_DOMINANT_WAVELENGTHS:
         {
-            auto it = std::find_if( m_VisualPreferences.begin(),
-                                    m_VisualPreferences.end(),
+            auto it = std::find_if( m_sVisPrefPrototypes.begin(),
+                                    m_sVisPrefPrototypes.begin() + getNumVisPrefs(),
                                     [lambda](const VisualPreferenceInfo& vpi){return (vpi.getWavelength() == lambda);});
-            if (it == m_VisualPreferences.end()) {
+            if (it == m_sVisPrefPrototypes.begin() + getNumVisPrefs()) {
                 std::stringstream msg;
-                msg << "Unable to find entry in m_VisualPreferences for wavelength=" << lambda << " in Hymenoptera::getVisPrefInfoFromWavelengthConst! Aborting.\n";
+                msg << "Unable to find visual preference for wavelength=" << lambda << " in Hymenoptera::getVisPrefIdxFromWavelength! Aborting.\n";
                 throw std::runtime_error(msg.str());
             }
-            return (*it);
+            return (std::size_t)(it - m_sVisPrefPrototypes.begin());
         }
         default:
         {
-            throw std::runtime_error("Encountered unexpected ColourSystem specification in Hymenoptera::getVisPrefInfoFromWavelengthConst. Aborting!\n");
+            throw std::runtime_error("Encountered unexpected ColourSystem specification in Hymenoptera::getVisPrefIdxFromWavelength. Aborting!\n");
         }
     }
 }
 
-const VisualPreferenceInfo& Hymenoptera::getVisPrefInfoFromStimulusInfo(const VisualStimulusInfo* pVisStimInfo) const
+std::size_t Hymenoptera::getVisPrefIdxFromStimulusInfo(const VisualStimulusInfo* pVisStimInfo) const
 {
     assert(pVisStimInfo != nullptr);
 
@@ -634,31 +814,71 @@ const VisualPreferenceInfo& Hymenoptera::getVisPrefInfoFromStimulusInfo(const Vi
     {
         case ColourSystem::REGULAR_MARKER_POINTS:
         {
-            std::size_t idx = getVisualDataVectorIdx(pVisStimInfo->getWavelength());
-            return m_VisualPreferences.at(idx);
+            return getVisPrefIdxFromWavelength(pVisStimInfo->getWavelength());
         }
         case ColourSystem::ARBITRARY_DOMINANT_WAVELENGTHS:
         {
-            auto it = std::find_if( m_VisualPreferences.begin(),
-                                    m_VisualPreferences.end(),
+            auto it = std::find_if( m_sVisPrefPrototypes.begin(),
+                                    m_sVisPrefPrototypes.begin() + getNumVisPrefs(),
                                     [pVisStimInfo](const VisualPreferenceInfo& vpi){return (vpi.getVisualStimulusInfoPtr()->id == pVisStimInfo->id);});
-            if (it == m_VisualPreferences.end()) {
+            if (it == m_sVisPrefPrototypes.begin() + getNumVisPrefs()) {
                 std::stringstream msg;
-                msg << "Unable to find entry in m_VisualPreferences for pVisStimInfo=" << pVisStimInfo->aux_id << " in Hymenoptera::getVisPrefInfoFromStimulusInfo! Aborting.\n";
+                msg << "Unable to find visual preference for pVisStimInfo=" << pVisStimInfo->aux_id << " in Hymenoptera::getVisPrefIdxFromStimulusInfo! Aborting.\n";
                 throw std::runtime_error(msg.str());
             }
-            return (*it);
+            return (std::size_t)(it - m_sVisPrefPrototypes.begin());
         }
         default:
         {
-            throw std::runtime_error("Encountered unexpected ColourSystem specification in Hymenoptera::getVisPrefInfoFromStimulusInfo. Aborting!\n");
+            throw std::runtime_error("Encountered unexpected ColourSystem specification in Hymenoptera::getVisPrefIdxFromStimulusInfo. Aborting!\n");
         }
     }
 }
 
+// The cached index refers to the first vis-data entry with the stimulus's wavelength, and
+// the visual preferences mirror m_sVisData entry for entry, so this finds the same entry as
+// getVisPrefIdxFromWavelength() without searching or validating the wavelength.
+std::size_t Hymenoptera::getVisPrefIdxFromReflectance(const ReflectanceInfo& rinfo) const
+{
+    int idx = rinfo.getVisDataIdx();
+    if ((idx >= 0) && ((std::size_t)idx < getNumVisPrefs()))
+    {
+        return (std::size_t)idx;
+    }
+    else
+    {
+        return getVisPrefIdxFromWavelength(rinfo.getCharacteristicWavelength());
+    }
+}
+
+VisualPreferenceInfo Hymenoptera::getVisPrefInfoFromWavelengthConst(Wavelength lambda) const
+{
+    return getVisPrefConst(getVisPrefIdxFromWavelength(lambda));
+}
+
+VisualPreferenceInfo& Hymenoptera::getVisPrefInfoFromWavelength(Wavelength lambda)
+{
+    return getVisPref(getVisPrefIdxFromWavelength(lambda));
+}
+
+VisualPreferenceInfo Hymenoptera::getVisPrefInfoFromStimulusInfo(const VisualStimulusInfo* pVisStimInfo) const
+{
+    return getVisPrefConst(getVisPrefIdxFromStimulusInfo(pVisStimInfo));
+}
+
 VisualPreferenceInfo& Hymenoptera::getVisPrefInfoFromStimulusInfo(const VisualStimulusInfo* pVisStimInfo)
 {
-    return const_cast<VisualPreferenceInfo&>(static_cast<const Hymenoptera&>(*this).getVisPrefInfoFromStimulusInfo(pVisStimInfo));
+    return getVisPref(getVisPrefIdxFromStimulusInfo(pVisStimInfo));
+}
+
+VisualPreferenceInfo Hymenoptera::getVisPrefInfoFromReflectanceConst(const ReflectanceInfo& rinfo) const
+{
+    return getVisPrefConst(getVisPrefIdxFromReflectance(rinfo));
+}
+
+VisualPreferenceInfo& Hymenoptera::getVisPrefInfoFromReflectance(const ReflectanceInfo& rinfo)
+{
+    return getVisPref(getVisPrefIdxFromReflectance(rinfo));
 }
 
 
@@ -683,7 +903,13 @@ bool Hymenoptera::isDetected(const ReflectanceInfo& rinfo) const
     {
         case ColourSystem::REGULAR_MARKER_POINTS:
         {
-            detectionProb  = getMPDetectionProb(rinfo.getCharacteristicWavelength());
+            int idx = rinfo.getVisDataIdx();
+            if ((idx >= 0) && ((std::size_t)idx < m_sVisData.size())) {
+                detectionProb = m_sVisData[idx].detectionProb;
+            }
+            else {
+                detectionProb  = getMPDetectionProb(rinfo.getCharacteristicWavelength());
+            }
             break;
         }
         case ColourSystem::ARBITRARY_DOMINANT_WAVELENGTHS:
@@ -753,8 +979,7 @@ bool Hymenoptera::isVisitCandidateVisual(Flower* pFlower, bool* pJudgedToMatchTa
     // (3) DECIDE step
     // Here we make use of the pollinator's learned probabilities of landing on a target or non-target flower
     // to make the final decision of whether to land
-    Wavelength flowerLambda = pFlower->getCharacteristicWavelength();
-    const VisualPreferenceInfo& visPrefInfo = getVisPrefInfoFromWavelengthConst(flowerLambda);
+    VisualPreferenceInfo visPrefInfo = getVisPrefInfoFromReflectanceConst(pFlower->getReflectanceInfo());
 
     if (bNoTargetSet)
     {
@@ -808,7 +1033,9 @@ void Hymenoptera::updateVisualPrefsFickleCircumspect(const Flower* pFlower, int
 {
     const ReflectanceInfo& flowerReflectance = pFlower->getReflectanceInfo();
     Wavelength flowerLambda = flowerReflectance.getCharacteristicWavelength();
-    VisualPreferenceInfo& visPrefInfo = getVisPrefInfoFromWavelength(flowerLambda);
+    std::size_t visPrefIdx = getVisPrefIdxFromReflectance(flowerReflectance);
+    VisualPreferenceInfo& visPrefInfo = getVisPref(visPrefIdx);
+    float oldProbLandNonTarget = visPrefInfo.getProbLandNonTarget();
     bool isTarget = (flowerLambda == getTargetWavelength());
     bool noTarget = (getTargetWavelength() == NO_MARKER_POINT);
     bool firstTarget = false;
@@ -839,6 +1066,7 @@ void Hymenoptera::updateVisualPrefsFickleCircumspect(const Flower* pFlower, int
             visPrefInfo.decrementProbLandNonTarget(m_sVisProbLandDecrementOnNoReward);
         }
     }
+    updateVisPrefRanking(visPrefIdx, oldProbLandNonTarget);
 
     // consider switching to a new target flower based upon the newly updated preferences
     if ((!firstTarget) && (!noTarget)) {
@@ -890,49 +1118,355 @@ void Hymenoptera::updateTarget()
     // of those instead of a plain wavelength... TODO
     assert(ModelParams::getColourSystem() == ColourSystem::REGULAR_MARKER_POINTS);
 
-    float maxProbLandNonTarget = 0.0;
-    VisualPreferenceInfo& vpiCurrentTarget = getVisPrefInfoFromWavelength(getTargetWavelength());
-    VisualPreferenceInfo* pVpiMaxNonTarget = nullptr;
+    std::size_t currentTargetIdx = getVisPrefIdxFromWavelength(getTargetWavelength());
+    VisualPreferenceInfo& vpiCurrentTarget = getVisPref(currentTargetIdx);
 
     // find the non-target marker point that currently has the highest landing probability
-    for (auto& vpi : m_VisualPreferences)
-    {
-        if ((vpi.getWavelength() != getTargetWavelength()) && (vpi.getProbLandNonTarget() > maxProbLandNonTarget))
-        {
-            pVpiMaxNonTarget = &vpi;
-            maxProbLandNonTarget = vpi.getProbLandNonTarget();
-        }
-    }
+    float maxProbLandNonTarget = 0.0;
+    int maxNonTargetIdx = findBestNonTargetVisPref(maxProbLandNonTarget);
 
     // if the landing probability of the highest non-target marker point is higher than that of the
     // current target marker point, make it the new target
-    if ((pVpiMaxNonTarget != nullptr) && (maxProbLandNonTarget > vpiCurrentTarget.getProbLandTarget()))
+    if ((maxNonTargetIdx >= 0) && (maxProbLandNonTarget > 0.0) &&
+        (maxProbLandNonTarget > vpiCurrentTarget.getProbLandTarget()))
     {
-        setTargetWavelength(pVpiMaxNonTarget->getWavelength());
+        VisualPreferenceInfo& vpiMaxNonTarget = getVisPref(maxNonTargetIdx);
+
+        setTargetWavelength(vpiMaxNonTarget.getWavelength());
                                             // make the (old) non-target flower the new target
 
-        pVpiMaxNonTarget->setAsTarget();    // set the (old) non-target flower's target prob land to the default target prob land
+        vpiMaxNonTarget.setAsTarget();      // set the (old) non-target flower's target prob land to the default target prob land
 
+        float oldProbLandNonTarget = vpiCurrentTarget.getProbLandNonTarget();
         vpiCurrentTarget.setAsNonTarget();  // set the (old) target flower's non-target prob land to the (old) target flower's target prob land
                                             // (i.e. it used to have a high preference, keep it, but now use it as the non-target preference)
+        updateVisPrefRanking(currentTargetIdx, oldProbLandNonTarget);
     }
 }
 
 
-// Attenuate preferences for non-target flowers that have not been recently visited
+// Attenuate preferences for non-target flowers that have not been recently visited.
+//
+// Rather than decrementing every unseen preference now, which would mean checking every
+// preference against every recently visited flower, we just bring the preferences for the
+// recently visited flowers up to date and mark them as having skipped this round. Every
+// other preference has the round applied lazily by syncVisPref() when it is next used, which
+// gives exactly the same result as applying it now.
 void Hymenoptera::attenuatePreferences()
 {
-    for (auto& vpi : m_VisualPreferences)
+    bool regularMPs = (ModelParams::getColourSystem() == ColourSystem::REGULAR_MARKER_POINTS);
+    std::size_t numVisPrefs = getNumVisPrefs();
+
+    for (Flower* pRecentFlower : m_RecentlyVisitedFlowers)
     {
-        Wavelength lambda = vpi.getWavelength();
-        if (std::find_if(m_RecentlyVisitedFlowers.begin(),
-                         m_RecentlyVisitedFlowers.end(),
-                         [lambda](Flower* pRecentFlower){return (pRecentFlower->getCharacteristicWavelength() == lambda);})
-            == m_RecentlyVisitedFlowers.end())
+        const ReflectanceInfo& rinfo = pRecentFlower->getReflectanceInfo();
+        Wavelength lambda = rinfo.getCharacteristicWavelength();
+
+        // The flower's cached vis-data index is that of the first preference with its wavelength,
+        // and under regular marker points no other preference shares the wavelength
+        int cachedIdx = rinfo.getVisDataIdx();
+        std::size_t beginIdx = (cachedIdx >= 0) ? (std::size_t)cachedIdx : 0;
+        std::size_t endIdx = ((cachedIdx >= 0) && regularMPs) ? beginIdx + 1 : numVisPrefs;
+        endIdx = std::min(endIdx, numVisPrefs);
+
+        for (std::size_t idx = beginIdx; idx < endIdx; ++idx)
         {
-            // This marker point has not been recently seen
-            vpi.decrementProbLandNonTarget(m_sVisProbLandDecrementOnUnseen);// decrement its non-target prob land
-                                                                            // (i.e. forget the preference for it a little)
+            if (m_sVisPrefPrototypes[idx].getWavelength() == lambda)
+            {
+                // This marker point has been recently seen, so it is not attenuated in this round
+                getVisPref(idx).attenuationStamp = m_iNumAttenuations + 1;
+            }
         }
     }
+
+    ++m_iNumAttenuations;
 }
+
+
+// Build the baseline visual preferences that are shared by all pollinators. These mirror
+// m_sVisData entry for entry, and do not include any individual variation.
+void Hymenoptera::buildVisPrefPrototypes()
+{
+    m_sVisPrefPrototypes.clear();
+
+    switch (ModelParams::getColourSystem())
+    {
+        case ColourSystem::REGULAR_MARKER_POINTS: {
+            for (MarkerPoint mp = m_sVisDataMPMin; mp <= m_sVisDataMPMax; mp += m_sVisDataMPStep)
+            {
+                m_sVisPrefPrototypes.emplace_back(mp, m_sVisBaseProbLandTarget, getBaseProbLandNonTargetInnate(mp));
+            }
+            break;
+        }
+        case ColourSystem::ARBITRARY_DOMINANT_WAVELENGTHS: {
+            for (auto& vsi : m_sVisData) {
+                m_sVisPrefPrototypes.emplace_back(&vsi, m_sVisBaseProbLandTarget, getBaseProbLandNonTargetInnate(vsi.getWavelength()));
+            }
+            break;
+        }
+        default: {
+            throw std::runtime_error("Encountered unexpected ColourSystem specification in Hymenoptera::buildVisPrefPrototypes. Aborting!");
+        }
+    }
+
+    m_sVisPrefPrototypeRanking.resize(m_sVisPrefPrototypes.size());
+    std::iota(m_sVisPrefPrototypeRanking.begin(), m_sVisPrefPrototypeRanking.end(), 0);
+    std::stable_sort(m_sVisPrefPrototypeRanking.begin(), m_sVisPrefPrototypeRanking.end(),
+        [](unsigned int a, unsigned int b){
+            return (m_sVisPrefPrototypes[a].baseProbLandNonTarget > m_sVisPrefPrototypes[b].baseProbLandNonTarget);
+        });
+}
+
+
+std::size_t Hymenoptera::getNumVisPrefs() const
+{
+    return (m_ConstancyType == PollinatorConstancyType::VISUAL) ? m_sVisPrefPrototypes.size() : 0;
+}
+
+
+// Return a preference as it would be if it had not been modified since the last reset
+VisualPreferenceInfo Hymenoptera::makeBaseVisPref(std::size_t idx) const
+{
+    const VisualPreferenceInfo& proto = m_sVisPrefPrototypes[idx];
+    if (m_VisPrefBaseProbLandNonTarget.empty())
+    {
+        return proto;
+    }
+    else if (proto.getVisualStimulusInfoPtr() != nullptr)
+    {
+        return VisualPreferenceInfo(proto.getVisualStimulusInfoPtr(), proto.baseProbLandTarget, m_VisPrefBaseProbLandNonTarget[idx]);
+    }
+    else
+    {
+        return VisualPreferenceInfo(proto.getWavelength(), proto.baseProbLandTarget, m_VisPrefBaseProbLandNonTarget[idx]);
+    }
+}
+
+
+float Hymenoptera::getBaseProbLandNonTarget(std::size_t idx) const
+{
+    return m_VisPrefBaseProbLandNonTarget.empty() ?
+        m_sVisPrefPrototypes[idx].baseProbLandNonTarget : m_VisPrefBaseProbLandNonTarget[idx];
+}
+
+
+// Return the indices of the preferences in descending order of this pollinator's
+// baseProbLandNonTarget (ascending index order for ties)
+const std::vector<unsigned int>& Hymenoptera::getVisPrefBaseRanking()
+{
+    if (m_VisPrefBaseProbLandNonTarget.empty())
+    {
+        return m_sVisPrefPrototypeRanking;
+    }
+
+    if (m_VisPrefBaseRanking.size() != m_VisPrefBaseProbLandNonTarget.size())
+    {
+        m_VisPrefBaseRanking.resize(m_VisPrefBaseProbLandNonTarget.size());
+        std::iota(m_VisPrefBaseRanking.begin(), m_VisPrefBaseRanking.end(), 0);
+        std::stable_sort(m_VisPrefBaseRanking.begin(), m_VisPrefBaseRanking.end(),
+            [this](unsigned int a, unsigned int b){
+                return (m_VisPrefBaseProbLandNonTarget[a] > m_VisPrefBaseProbLandNonTarget[b]);
+            });
+    }
+    return m_VisPrefBaseRanking;
+}
+
+
+// Return a copy of the current state of a preference, including any pending attenuation,
+// without giving this pollinator its own copy of the entry if it does not already have one
+VisualPreferenceInfo Hymenoptera::getVisPrefConst(std::size_t idx) const
+{
+    auto it = m_VisPrefOverlay.find(idx);
+    if (it != m_VisPrefOverlay.end())
+    {
+        syncVisPref(it->second, idx);
+        return it->second;
+    }
+
+    VisualPreferenceInfo vpi = makeBaseVisPref(idx);
+    vpi.attenuateProbLandNonTarget(m_iNumAttenuations, m_sVisProbLandDecrementOnUnseen);
+    return vpi;
+}
+
+
+// Return a modifiable reference to the current state of a preference, giving this
+// pollinator its own copy of the entry if it does not already have one. The reference
+// remains valid until the next reset.
+VisualPreferenceInfo& Hymenoptera::getVisPref(std::size_t idx)
+{
+    auto it = m_VisPrefOverlay.find(idx);
+    if (it == m_VisPrefOverlay.end())
+    {
+        it = m_VisPrefOverlay.emplace(idx, makeBaseVisPref(idx)).first;
+        m_VisPrefRanking.insert(getVisPrefRankKey(it->second, it->second.getProbLandNonTarget(), idx));
+    }
+    syncVisPref(it->second, idx);
+    return it->second;
+}
+
+
+void Hymenoptera::clearVisPrefOverlay()
+{
+    m_VisPrefOverlay.clear();
+    m_VisPrefRanking.clear();
+    m_VisPrefPristineCursor = 0;
+    m_iNumAttenuations = 0;
+}
+
+
+// Apply any attenuation rounds that are pending for the specified preference
+void Hymenoptera::syncVisPref(VisualPreferenceInfo& vpi, std::size_t idx) const
+{
+    int numRounds = m_iNumAttenuations - vpi.attenuationStamp;
+    if (numRounds > 0)
+    {
+        float oldProbLandNonTarget = vpi.getProbLandNonTarget();
+        vpi.attenuateProbLandNonTarget(numRounds, m_sVisProbLandDecrementOnUnseen);
+        vpi.attenuationStamp = m_iNumAttenuations;
+        updateVisPrefRanking(idx, oldProbLandNonTarget);
+    }
+}
+
+
+// Attenuation can only ever reduce probLandNonTarget or pull it up to baseProbLandNonTarget,
+// so the larger of the two is an upper bound on the value of a preference however many
+// attenuation rounds are pending for it. Ties are broken in favour of the earliest entry in
+// m_sVisPrefPrototypes.
+Hymenoptera::VisPrefRankKey Hymenoptera::getVisPrefRankKey(const VisualPreferenceInfo& vpi,
+                                                           float probLandNonTarget,
+                                                           std::size_t idx)
+{
+    return {std::max(probLandNonTarget, vpi.baseProbLandNonTarget), -(int)idx};
+}
+
+
+void Hymenoptera::rebuildVisPrefRanking()
+{
+    m_VisPrefRanking.clear();
+    for (auto& entry : m_VisPrefOverlay)
+    {
+        const VisualPreferenceInfo& vpi = entry.second;
+        m_VisPrefRanking.insert(getVisPrefRankKey(vpi, vpi.getProbLandNonTarget(), entry.first));
+    }
+}
+
+
+// Must be called whenever the probLandNonTarget of a preference in m_VisPrefOverlay is changed
+void Hymenoptera::updateVisPrefRanking(std::size_t idx, float oldProbLandNonTarget) const
+{
+    const VisualPreferenceInfo& vpi = m_VisPrefOverlay.at(idx);
+    if (vpi.getProbLandNonTarget() != oldProbLandNonTarget)
+    {
+        m_VisPrefRanking.erase(getVisPrefRankKey(vpi, oldProbLandNonTarget, idx));
+        m_VisPrefRanking.insert(getVisPrefRankKey(vpi, vpi.getProbLandNonTarget(), idx));
+    }
+}
+
+
+// Find the non-target preference with the highest probLandNonTarget (the earliest such entry
+// if there is a tie), returning its index and setting probLandNonTarget to its value, or
+// returning -1 if there is none.
+//
+// The candidates are examined in descending order of an upper bound on their value, merging
+// the pollinator's own entries (ordered by m_VisPrefRanking) with the unmodified entries
+// (ordered by their base value, which is also their upper bound), and we stop as soon as no
+// remaining upper bound can beat the best value found so far. Entries are brought up to date
+// as we go, and unmodified entries are left unmodified.
+int Hymenoptera::findBestNonTargetVisPref(float& probLandNonTarget)
+{
+    Wavelength targetLambda = getTargetWavelength();
+    const std::vector<unsigned int>& baseRanking = getVisPrefBaseRanking();
+    int bestIdx = -1;
+    VisPrefRankKey bestKey;
+    std::vector<std::pair<std::size_t, float>> updated; // (idx, old probLandNonTarget) of entries synced below
+
+    // skip past the leading entries of the base ranking that are no longer unmodified
+    while ((m_VisPrefPristineCursor < baseRanking.size()) &&
+           (m_VisPrefOverlay.count(baseRanking[m_VisPrefPristineCursor]) > 0))
+    {
+        ++m_VisPrefPristineCursor;
+    }
+
+    auto overlayIt = m_VisPrefRanking.begin();
+    std::size_t basePos = m_VisPrefPristineCursor;
+
+    while (true)
+    {
+        while ((basePos < baseRanking.size()) && (m_VisPrefOverlay.count(baseRanking[basePos]) > 0))
+        {
+            ++basePos;
+        }
+
+        bool haveOverlay = (overlayIt != m_VisPrefRanking.end());
+        bool haveBase = (basePos < baseRanking.size());
+        if (!haveOverlay && !haveBase)
+        {
+            break;
+        }
+
+        VisPrefRankKey baseBoundKey;
+        if (haveBase)
+        {
+            baseBoundKey = {getBaseProbLandNonTarget(baseRanking[basePos]), -(int)baseRanking[basePos]};
+        }
+
+        bool useOverlay = haveOverlay && ((!haveBase) || (*overlayIt > baseBoundKey));
+        VisPrefRankKey boundKey = useOverlay ? *overlayIt : baseBoundKey;
+
+        if ((bestIdx >= 0) && (boundKey < bestKey))
+        {
+            break;
+        }
+
+        std::size_t idx = (std::size_t)(-boundKey.second);
+        if (useOverlay) {
+            ++overlayIt;
+        }
+        else {
+            ++basePos;
+        }
+
+        if (m_sVisPrefPrototypes[idx].getWavelength() == targetLambda)
+        {
+            continue;
+        }
+
+        float value = 0.0;
+        if (useOverlay)
+        {
+            // bring the entry up to date, deferring the update of its ranking until we have
+            // finished iterating over the ranking
+            VisualPreferenceInfo& vpi = m_VisPrefOverlay.at(idx);
+            int numRounds = m_iNumAttenuations - vpi.attenuationStamp;
+            if (numRounds > 0)
+            {
+                updated.emplace_back(idx, vpi.getProbLandNonTarget());
+                vpi.attenuateProbLandNonTarget(numRounds, m_sVisProbLandDecrementOnUnseen);
+                vpi.attenuationStamp = m_iNumAttenuations;
+            }
+            value = vpi.getProbLandNonTarget();
+        }
+        else
+        {
+            value = getVisPrefConst(idx).getProbLandNonTarget();
+        }
+
+        VisPrefRankKey key{value, -(int)idx};
+        if ((bestIdx < 0) || (key > bestKey))
+        {
+            bestIdx = (int)idx;
+            bestKey = key;
+        }
+    }
+
+    for (auto& entry : updated)
+    {
+        updateVisPrefRanking(entry.first, entry.second);
+    }
+
+    if (bestIdx >= 0)
+    {
+        probLandNonTarget = bestKey.first;
+    }
+    return bestIdx;
+}
\ No newline at end of file
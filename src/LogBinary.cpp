@@ -0,0 +1,327 @@
+/**
+ * @file
+ *
+ * Implementation of the binary log file format support classes
+ */
+
+#include <sstream>
+#include "LogBinary.h"
+
+namespace
+{
+    using T = BinaryColumnType;
+
+    // The layout of each record type. The order of tables and columns here must
+    // match the order in which they are written by the corresponding LogSnapshot
+    // subclass's writeBinary() method (this is checked by BinaryChunkWriter).
+    // If this is changed in any way, BinaryLogSchema::m_sVersion must be incremented.
+
+    const std::vector<BinaryTableSchema> pollinatorStatesTables {
+        {"types", {{"name", T::STR}}},
+        {"pollinators", {
+            {"type", T::U16}, {"id", T::U32}, {"x", T::F32}, {"y", T::F32}, {"heading", T::F32},
+            {"numFlowersVisitedInBout", T::I32}, {"latestActionStepnum", T::I32},
+            {"latestActionStatus", T::U8}, {"latestActionFlowerLambda", T::U16},
+            {"latestActionReward", T::I32}, {"latestActionJudgedToMatchTarget", T::U8},
+            {"hasVisualState", T::U8}, {"targetWavelength", T::U16}, {"numPrefs", T::U32}}},
+        {"prefs", {{"lambda", T::U16}, {"probLandTarget", T::F32}, {"probLandNonTarget", T::F32}}}
+    };
+
+    const std::vector<BinaryTableSchema> pollinatorSummaryTables {
+        {"pollinators", {{"id", T::U32}, {"numSpecies", T::U32}}},
+        {"perf", {{"speciesId", T::U32}, {"numLandings", T::I32}, {"numPollinations", T::I32},
+                  {"numPollenGrainsInStore", T::I32}}}
+    };
+
+    const std::vector<BinaryTableSchema> flowerStatesTables {
+        {"flowers", {
+            {"id", T::U32}, {"speciesId", T::U32}, {"x", T::F32}, {"y", T::F32}, {"lambda", T::U16},
+            {"pollinated", T::U8}, {"antherPollen", T::I32}, {"numStigmaPollen", T::U64},
+            {"availableNectar", T::I32}}}
+    };
+
+    const std::vector<BinaryTableSchema> flowersFullTables {
+        {"plants", {{"id", T::U32}, {"speciesId", T::U32}, {"x", T::F32}, {"y", T::F32},
+                    {"localityId", T::U32}, {"numFlowers", T::U32}}},
+        {"flowers", {{"id", T::U32}, {"pollinated", T::U8}, {"lambda", T::U16}, {"numSources", T::U32}}},
+        {"sources", {{"lambda", T::U16}, {"count", T::I32}, {"sourceFlowerId", T::U32}}}
+    };
+
+    // summary count tables have a key column, an optional name column, and a fixed
+    // number of count columns
+    std::vector<BinaryTableSchema> summaryCountsTables(bool hasNames, std::vector<std::string> valueNames)
+    {
+        BinaryTableSchema table {"rows", {{"key", T::I64}}};
+        if (hasNames)
+        {
+            table.columns.push_back({"name", T::STR});
+        }
+        for (auto& name : valueNames)
+        {
+            table.columns.push_back({name, T::I64});
+        }
+        return {table};
+    }
+
+    const std::vector<BinaryRecordSchema> recordSchemas {
+        {'Q', pollinatorStatesTables},
+        {'P', pollinatorStatesTables},
+        {'p', pollinatorSummaryTables},
+        {'G', flowerStatesTables},
+        {'F', flowersFullTables},
+        {'f', summaryCountsTables(true, {"numPlants", "numPollinated"})},
+        {'g', summaryCountsTables(true, {"numPlants", "numPollinated"})},
+        {'m', summaryCountsTables(false, {"numFlowers", "numPollinated", "numCommunal", "numCommunalPollinated"})},
+        {'n', summaryCountsTables(false, {"numFlowers", "numPollinated", "numCommunal", "numCommunalPollinated",
+                                          "numRefuge", "numRefugePollinated", "numLandings"})},
+        {'s', summaryCountsTables(false, {"numSteps", "numFlowerVisits", "numLandingsDeclined", "numNoFlowerSeen"})}
+    };
+
+    const std::uint32_t byteOrderMarker = 0x01020304;
+
+    template<typename V>
+    void appendRaw(std::string& buf, V val)
+    {
+        char bytes[sizeof(V)];
+        std::memcpy(bytes, &val, sizeof(V));
+        buf.append(bytes, sizeof(V));
+    }
+
+    void appendString(std::string& buf, const std::string& str)
+    {
+        appendRaw<std::uint32_t>(buf, str.size());
+        buf.append(str);
+    }
+}
+
+
+const char* BinaryLogSchema::m_sMagic = "EVOBEELOG";
+const std::uint32_t BinaryLogSchema::m_sVersion = 2;
+
+
+const BinaryRecordSchema& BinaryLogSchema::getRecordSchema(char tag)
+{
+    for (const BinaryRecordSchema& schema : recordSchemas)
+    {
+        if (schema.tag == tag)
+        {
+            return schema;
+        }
+    }
+
+    std::stringstream msg;
+    msg << "Unknown record type '" << tag << "' in binary log";
+    throw std::runtime_error(msg.str());
+}
+
+
+const std::vector<BinaryRecordSchema>& BinaryLogSchema::getAllRecordSchemas()
+{
+    return recordSchemas;
+}
+
+
+// The header comprises the magic string, a byte order marker, the format version,
+// and then a description of every record type: its tag, and the name of each of
+// its tables along with the name and type of each of their columns.
+void BinaryLogSchema::writeHeader(std::string& buf)
+{
+    std::string header;
+    header.append(m_sMagic);
+    appendRaw<std::uint32_t>(header, byteOrderMarker);
+    appendRaw<std::uint32_t>(header, m_sVersion);
+    appendRaw<std::uint32_t>(header, recordSchemas.size());
+    for (const BinaryRecordSchema& schema : recordSchemas)
+    {
+        header += schema.tag;
+        appendRaw<std::uint32_t>(header, schema.tables.size());
+        for (const BinaryTableSchema& table : schema.tables)
+        {
+            appendString(header, table.name);
+            appendRaw<std::uint32_t>(header, table.columns.size());
+            for (const BinaryColumnSchema& column : table.columns)
+            {
+                appendString(header, column.name);
+                header += (char)column.type;
+            }
+        }
+    }
+
+    // prefix the header with its total size so that readers can skip it
+    appendRaw<std::uint64_t>(buf, header.size());
+    buf.append(header);
+}
+
+
+// We check the header by regenerating the one we would write ourselves and
+// comparing the two byte by byte; any difference in the schema means that the
+// file was written by an incompatible version of the program.
+std::size_t BinaryLogSchema::readHeader(const char* data, std::size_t size)
+{
+    std::string expected;
+    writeHeader(expected);
+
+    std::size_t magicLen = std::strlen(m_sMagic);
+    if ((size < sizeof(std::uint64_t) + magicLen) ||
+        (std::memcmp(data + sizeof(std::uint64_t), m_sMagic, magicLen) != 0))
+    {
+        throw std::runtime_error("File is not an EvoBee binary log file");
+    }
+
+    std::uint32_t marker;
+    std::memcpy(&marker, data + sizeof(std::uint64_t) + magicLen, sizeof(marker));
+    if (marker != byteOrderMarker)
+    {
+        throw std::runtime_error("Binary log file was written on a machine with a different byte order");
+    }
+
+    if ((size < expected.size()) || (std::memcmp(data, expected.data(), expected.size()) != 0))
+    {
+        throw std::runtime_error("Binary log file was written with an incompatible version of the log format");
+    }
+
+    return expected.size();
+}
+
+
+BinaryChunkWriter::BinaryChunkWriter(std::string& buf, char tag, unsigned int gen, unsigned int step) :
+    m_Buf(buf),
+    m_iChunkStart(buf.size()),
+    m_Schema(BinaryLogSchema::getRecordSchema(tag)),
+    m_iTable(0),
+    m_iColumn(0),
+    m_iNumRows(0)
+{
+    appendValue<std::uint64_t>(0); // placeholder for chunk size, filled in by finish()
+    appendValue<char>(tag);
+    appendValue<std::uint32_t>(gen);
+    appendValue<std::uint32_t>(step);
+}
+
+
+void BinaryChunkWriter::beginTable(std::size_t numRows)
+{
+    if ((m_iTable > 0) && (m_iColumn != m_Schema.tables[m_iTable-1].columns.size()))
+    {
+        throw std::runtime_error("BinaryChunkWriter: table started before previous table was complete");
+    }
+    if (m_iTable >= m_Schema.tables.size())
+    {
+        throw std::runtime_error("BinaryChunkWriter: too many tables written for record type");
+    }
+
+    ++m_iTable;
+    m_iColumn = 0;
+    m_iNumRows = numRows;
+    appendValue<std::uint64_t>(numRows);
+}
+
+
+void BinaryChunkWriter::checkColumn(BinaryColumnType type)
+{
+    if ((m_iTable == 0) || (m_iColumn >= m_Schema.tables[m_iTable-1].columns.size()) ||
+        (m_Schema.tables[m_iTable-1].columns[m_iColumn].type != type))
+    {
+        throw std::runtime_error("BinaryChunkWriter: column written does not match the binary log schema");
+    }
+    ++m_iColumn;
+}
+
+
+void BinaryChunkWriter::finish()
+{
+    if ((m_iTable != m_Schema.tables.size()) || (m_iColumn != m_Schema.tables.back().columns.size()))
+    {
+        throw std::runtime_error("BinaryChunkWriter: chunk finished before all tables were written");
+    }
+
+    std::uint64_t chunkSize = m_Buf.size() - m_iChunkStart - sizeof(std::uint64_t);
+    std::memcpy(&m_Buf[m_iChunkStart], &chunkSize, sizeof(chunkSize));
+}
+
+
+BinaryChunkReader::BinaryChunkReader(const char* data, std::size_t size) :
+    m_pData(data),
+    m_iChunkSize(size),
+    m_iPos(0),
+    m_pSchema(nullptr),
+    m_iTable(0),
+    m_iColumn(0),
+    m_iNumRows(0)
+{
+    std::uint64_t chunkSize = readValue<std::uint64_t>();
+    if (chunkSize > size - sizeof(std::uint64_t))
+    {
+        throw std::runtime_error("Binary log file is truncated");
+    }
+    m_iChunkSize = chunkSize + sizeof(std::uint64_t);
+
+    m_Tag = readValue<char>();
+    m_iGen = readValue<std::uint32_t>();
+    m_iStep = readValue<std::uint32_t>();
+    m_pSchema = &BinaryLogSchema::getRecordSchema(m_Tag);
+}
+
+
+std::size_t BinaryChunkReader::beginTable()
+{
+    if ((m_iTable > 0) && (m_iColumn != m_pSchema->tables[m_iTable-1].columns.size()))
+    {
+        throw std::runtime_error("BinaryChunkReader: table started before previous table was complete");
+    }
+    if (m_iTable >= m_pSchema->tables.size())
+    {
+        throw std::runtime_error("BinaryChunkReader: too many tables read for record type");
+    }
+
+    ++m_iTable;
+    m_iColumn = 0;
+    m_iNumRows = readValue<std::uint64_t>();
+    return m_iNumRows;
+}
+
+
+void BinaryChunkReader::checkColumn(BinaryColumnType type)
+{
+    if ((m_iTable == 0) || (m_iColumn >= m_pSchema->tables[m_iTable-1].columns.size()) ||
+        (m_pSchema->tables[m_iTable-1].columns[m_iColumn].type != type))
+    {
+        throw std::runtime_error("BinaryChunkReader: column read does not match the binary log schema");
+    }
+    ++m_iColumn;
+}
+
+
+void BinaryChunkReader::finish() const
+{
+    if ((m_iTable != m_pSchema->tables.size()) || (m_iColumn != m_pSchema->tables.back().columns.size()) ||
+        (m_iPos != m_iChunkSize))
+    {
+        throw std::runtime_error("BinaryChunkReader: chunk contents do not match the binary log schema");
+    }
+}
+
+
+std::uint64_t BinaryChunkReader::readVarint()
+{
+    std::uint64_t val = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        std::uint8_t byte = readValue<std::uint8_t>();
+        val |= (std::uint64_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return val;
+        }
+    }
+    throw std::runtime_error("Invalid varint in binary log chunk");
+}
+
+
+void BinaryChunkReader::need(std::size_t numBytes) const
+{
+    if (m_iPos + numBytes > m_iChunkSize)
+    {
+        throw std::runtime_error("Binary log chunk is truncated or corrupt");
+    }
+}
@@ -0,0 +1,631 @@
+/**
+ * @file
+ *
+ * Implementation of the LogSnapshot class and its subclasses
+ */
+
+#include <charconv>
+#include <stdexcept>
+#include <map>
+#include <sstream>
+#include "LogBinary.h"
+#include "LogSnapshot.h"
+
+namespace
+{
+    // Helper functions to append numbers to a string buffer using std::to_chars.
+    // These produce the same text as writing the value to a std::ostream with the
+    // corresponding formatting flags, without the overhead of the stream machinery.
+
+    template<typename T>
+    void appendInt(std::string& buf, T val)
+    {
+        char tmp[24];
+        auto res = std::to_chars(tmp, tmp + sizeof(tmp), val);
+        buf.append(tmp, res.ptr);
+    }
+
+    // equivalent to: os << std::fixed << std::setprecision(3) << val
+    void appendFixed3(std::string& buf, float val)
+    {
+        char tmp[64];
+        auto res = std::to_chars(tmp, tmp + sizeof(tmp), val, std::chars_format::fixed, 3);
+        if (res.ec != std::errc())
+        {
+            throw std::runtime_error("Unable to format floating point value in log record");
+        }
+        buf.append(tmp, res.ptr);
+    }
+
+    // equivalent to: os << val (with the default stream formatting flags)
+    void appendDefault(std::string& buf, float val)
+    {
+        char tmp[32];
+        auto res = std::to_chars(tmp, tmp + sizeof(tmp), val, std::chars_format::general, 6);
+        if (res.ec != std::errc())
+        {
+            throw std::runtime_error("Unable to format floating point value in log record");
+        }
+        buf.append(tmp, res.ptr);
+    }
+
+    void appendGenStep(std::string& buf, char tag, unsigned int gen, unsigned int step)
+    {
+        buf += tag;
+        buf += ',';
+        appendInt(buf, gen);
+        buf += ',';
+        appendInt(buf, step);
+        buf += ',';
+    }
+}
+
+
+void PollinatorStatesSnapshot::write(std::string& buf) const
+{
+    for (const PollinatorStateRecord& rec : records)
+    {
+        appendGenStep(buf, m_Tag, m_iGen, m_iStep);
+        writeRecord(buf, rec);
+        buf += '\n';
+    }
+}
+
+
+// Output format is the same as that documented for Pollinator::getStateString() and
+// Hymenoptera::captureState()
+void PollinatorStatesSnapshot::writeRecord(std::string& buf, const PollinatorStateRecord& rec) const
+{
+    buf += *(rec.pTypeName);
+    buf += ',';
+    appendInt(buf, rec.id);
+    buf += ',';
+    appendFixed3(buf, rec.x);
+    buf += ',';
+    appendFixed3(buf, rec.y);
+    buf += ',';
+    appendFixed3(buf, rec.heading);
+    buf += ',';
+    appendInt(buf, rec.numFlowersVisitedInBout);
+    buf += ',';
+    appendInt(buf, rec.latestActionStepnum);
+    buf += ',';
+
+    switch (rec.latestActionStatus) {
+    case PollinatorCurrentStatus::ON_FLOWER: {
+        appendInt(buf, rec.latestActionFlowerLambda);
+        buf += ',';
+        appendInt(buf, rec.latestActionReward);
+        buf += (rec.latestActionJudgedToMatchTarget ? ",T" : ",F");
+        break;
+    }
+    case PollinatorCurrentStatus::DECLINED_FLOWER: {
+        appendInt(buf, rec.latestActionFlowerLambda);
+        buf += (rec.latestActionJudgedToMatchTarget ? ",-1,T" : ",-1,F");
+        break;
+    }
+    case PollinatorCurrentStatus::NO_FLOWER_SEEN: {
+        buf += "0,-2,F";
+        break;
+    }
+    default: {
+        throw std::runtime_error("Unknown PollinatorCurrentStatus value in PollinatorStatesSnapshot::writeRecord(). Aborting!");
+    }
+    }
+
+    if (rec.hasVisualState)
+    {
+        buf += ",//,";
+        appendInt(buf, rec.targetWavelength);
+        buf += ",::,";
+        for (std::size_t i = rec.prefsBegin; i < rec.prefsEnd; ++i)
+        {
+            const VisualPreferenceRecord& pref = prefs[i];
+            appendInt(buf, pref.lambda);
+            buf += ',';
+            appendFixed3(buf, pref.probLandTarget);
+            buf += ',';
+            appendFixed3(buf, pref.probLandNonTarget);
+            buf += ',';
+        }
+        buf += "::";
+    }
+}
+
+
+void PollinatorSummarySnapshot::write(std::string& buf) const
+{
+    for (std::size_t i = 0; i < pollinatorIds.size(); ++i)
+    {
+        buf += "p,";
+        appendInt(buf, m_iGen);
+        buf += ',';
+        appendInt(buf, pollinatorIds[i]);
+
+        std::size_t end = (i + 1 < perfBegin.size()) ? perfBegin[i+1] : perf.size();
+        for (std::size_t j = perfBegin[i]; j < end; ++j)
+        {
+            const PollinatorPerformanceRecord& rec = perf[j];
+            buf += ',';
+            appendInt(buf, rec.speciesId);
+            buf += ',';
+            appendInt(buf, rec.numLandings);
+            buf += ',';
+            appendInt(buf, rec.numPollinations);
+            buf += ',';
+            appendInt(buf, rec.numPollenGrainsInStore);
+        }
+
+        buf += '\n';
+    }
+}
+
+
+void FlowerStatesSnapshot::write(std::string& buf) const
+{
+    for (const FlowerStateRecord& rec : records)
+    {
+        appendGenStep(buf, 'G', m_iGen, m_iStep);
+        writeRecord(buf, rec);
+        buf += '\n';
+    }
+}
+
+
+// Output format is the same as that documented for Flower::getStateString()
+void FlowerStatesSnapshot::writeRecord(std::string& buf, const FlowerStateRecord& rec)
+{
+    appendInt(buf, rec.id);
+    buf += ',';
+    appendInt(buf, rec.speciesId);
+    buf += ',';
+    appendFixed3(buf, rec.x);
+    buf += ',';
+    appendFixed3(buf, rec.y);
+    buf += ',';
+    appendInt(buf, rec.lambda);
+    buf += (rec.pollinated ? ",P," : ",N,");
+    appendInt(buf, rec.antherPollen);
+    buf += ',';
+    appendInt(buf, rec.numStigmaPollen);
+    buf += ',';
+    appendInt(buf, rec.availableNectar);
+}
+
+
+void FlowersFullSnapshot::write(std::string& buf) const
+{
+    for (const PlantRecord& plant : plants)
+    {
+        buf += "F,";
+        appendInt(buf, m_iGen);
+        buf += ',';
+        appendInt(buf, plant.id);
+        buf += ',';
+        appendInt(buf, plant.speciesId);
+        buf += ',';
+        appendDefault(buf, plant.x);
+        buf += ',';
+        appendDefault(buf, plant.y);
+        buf += ',';
+        appendInt(buf, plant.localityId);
+
+        for (std::size_t i = plant.flowersBegin; i < plant.flowersEnd; ++i)
+        {
+            const FlowerPollenRecord& flower = flowers[i];
+            buf += ",:,";
+            appendInt(buf, flower.id);
+            buf += (flower.pollinated ? ",P," : ",N,");
+            appendInt(buf, flower.lambda);
+            buf += ",~,";
+
+            for (std::size_t j = flower.sourcesBegin; j < flower.sourcesEnd; ++j)
+            {
+                // NB the final item in the output triplet is the unique idea of the pollen source
+                // flower, but this only makes sense when there is just a single pollen grain of
+                // a given species. If there is more than one pollen grain of the species present,
+                // they may have come from various different source flowers.
+                const PollenSourceRecord& source = sources[j];
+                appendInt(buf, source.lambda);
+                buf += ',';
+                appendInt(buf, source.count);
+                buf += ',';
+                appendInt(buf, source.sourceFlowerId);
+                buf += ',';
+            }
+
+            buf += '~';
+        }
+
+        buf += '\n';
+    }
+}
+
+
+void SummaryCountsSnapshot::write(std::string& buf) const
+{
+    for (std::size_t row = 0; row < keys.size(); ++row)
+    {
+        appendGenStep(buf, m_Tag, m_iGen, m_iStep);
+        appendInt(buf, keys[row]);
+        if (!names.empty())
+        {
+            buf += ',';
+            buf += names[row];
+        }
+        for (std::size_t i = row * m_iNumValuesPerRow; i < (row + 1) * m_iNumValuesPerRow; ++i)
+        {
+            buf += ',';
+            appendInt(buf, values[i]);
+        }
+        buf += '\n';
+    }
+}
+
+
+// Create a snapshot of the appropriate class for the record type of the chunk
+std::unique_ptr<LogSnapshot> LogSnapshot::readBinary(BinaryChunkReader& reader)
+{
+    std::unique_ptr<LogSnapshot> pSnapshot;
+
+    switch (reader.getTag()) {
+    case 'Q':
+    case 'P': {
+        pSnapshot = PollinatorStatesSnapshot::readBinary(reader);
+        break;
+    }
+    case 'p': {
+        pSnapshot = PollinatorSummarySnapshot::readBinary(reader);
+        break;
+    }
+    case 'G': {
+        pSnapshot = FlowerStatesSnapshot::readBinary(reader);
+        break;
+    }
+    case 'F': {
+        pSnapshot = FlowersFullSnapshot::readBinary(reader);
+        break;
+    }
+    case 'f':
+    case 'g':
+    case 'm':
+    case 'n':
+    case 's': {
+        pSnapshot = SummaryCountsSnapshot::readBinary(reader);
+        break;
+    }
+    default: {
+        std::stringstream msg;
+        msg << "Unknown record type '" << reader.getTag() << "' in binary log";
+        throw std::runtime_error(msg.str());
+    }
+    }
+
+    reader.finish();
+    return pSnapshot;
+}
+
+
+// The pollinator type names are stored once per chunk in a separate table, and
+// each pollinator refers to its type name by index.
+void PollinatorStatesSnapshot::writeBinary(std::string& buf) const
+{
+    std::map<const std::string*, std::uint16_t> typeIndices;
+    std::vector<const std::string*> typeNames;
+    std::vector<std::uint16_t> recTypes;
+    recTypes.reserve(records.size());
+    for (const PollinatorStateRecord& rec : records)
+    {
+        auto it = typeIndices.find(rec.pTypeName);
+        if (it == typeIndices.end())
+        {
+            it = typeIndices.emplace(rec.pTypeName, typeNames.size()).first;
+            typeNames.push_back(rec.pTypeName);
+        }
+        recTypes.push_back(it->second);
+    }
+
+    BinaryChunkWriter w(buf, m_Tag, m_iGen, m_iStep);
+
+    w.beginTable(typeNames.size());
+    w.stringColumn([&](std::size_t i) -> const std::string& {return *typeNames[i];});
+
+    w.beginTable(records.size());
+    w.column<std::uint16_t>([&](std::size_t i) {return recTypes[i];});
+    w.column<std::uint32_t>([&](std::size_t i) {return records[i].id;});
+    w.column<float>([&](std::size_t i) {return records[i].x;});
+    w.column<float>([&](std::size_t i) {return records[i].y;});
+    w.column<float>([&](std::size_t i) {return records[i].heading;});
+    w.column<std::int32_t>([&](std::size_t i) {return records[i].numFlowersVisitedInBout;});
+    w.column<std::int32_t>([&](std::size_t i) {return records[i].latestActionStepnum;});
+    w.column<std::uint8_t>([&](std::size_t i) {return (std::uint8_t)records[i].latestActionStatus;});
+    w.column<std::uint16_t>([&](std::size_t i) {return records[i].latestActionFlowerLambda;});
+    w.column<std::int32_t>([&](std::size_t i) {return records[i].latestActionReward;});
+    w.column<std::uint8_t>([&](std::size_t i) {return (std::uint8_t)records[i].latestActionJudgedToMatchTarget;});
+    w.column<std::uint8_t>([&](std::size_t i) {return (std::uint8_t)records[i].hasVisualState;});
+    w.column<std::uint16_t>([&](std::size_t i) {return records[i].targetWavelength;});
+    w.column<std::uint32_t>([&](std::size_t i) {
+        return records[i].hasVisualState ? records[i].prefsEnd - records[i].prefsBegin : 0;
+    });
+
+    // NB the prefs of each pollinator are written in record order, which is the
+    // order in which they were captured, so the ranges are contiguous
+    w.beginTable(prefs.size());
+    w.column<std::uint16_t>([&](std::size_t i) {return prefs[i].lambda;});
+    w.column<float>([&](std::size_t i) {return prefs[i].probLandTarget;});
+    w.column<float>([&](std::size_t i) {return prefs[i].probLandNonTarget;});
+
+    w.finish();
+}
+
+
+std::unique_ptr<LogSnapshot> PollinatorStatesSnapshot::readBinary(BinaryChunkReader& reader)
+{
+    auto pSnapshot = std::make_unique<PollinatorStatesSnapshot>(reader.getTag(), reader.getGen(), reader.getStep());
+    auto& recs = pSnapshot->records;
+    auto& names = pSnapshot->m_TypeNames;
+
+    names.resize(reader.beginTable());
+    reader.stringColumn([&](std::size_t i, std::string val) {names[i] = std::move(val);});
+
+    recs.resize(reader.beginTable());
+    reader.column<std::uint16_t>([&](std::size_t i, std::uint16_t val) {
+        if (val >= names.size())
+        {
+            throw std::runtime_error("Invalid pollinator type index in binary log");
+        }
+        recs[i].pTypeName = &names[val];
+    });
+    reader.column<std::uint32_t>([&](std::size_t i, std::uint32_t val) {recs[i].id = val;});
+    reader.column<float>([&](std::size_t i, float val) {recs[i].x = val;});
+    reader.column<float>([&](std::size_t i, float val) {recs[i].y = val;});
+    reader.column<float>([&](std::size_t i, float val) {recs[i].heading = val;});
+    reader.column<std::int32_t>([&](std::size_t i, std::int32_t val) {recs[i].numFlowersVisitedInBout = val;});
+    reader.column<std::int32_t>([&](std::size_t i, std::int32_t val) {recs[i].latestActionStepnum = val;});
+    reader.column<std::uint8_t>([&](std::size_t i, std::uint8_t val) {recs[i].latestActionStatus = (PollinatorCurrentStatus)val;});
+    reader.column<std::uint16_t>([&](std::size_t i, std::uint16_t val) {recs[i].latestActionFlowerLambda = val;});
+    reader.column<std::int32_t>([&](std::size_t i, std::int32_t val) {recs[i].latestActionReward = val;});
+    reader.column<std::uint8_t>([&](std::size_t i, std::uint8_t val) {recs[i].latestActionJudgedToMatchTarget = val;});
+    reader.column<std::uint8_t>([&](std::size_t i, std::uint8_t val) {recs[i].hasVisualState = val;});
+    reader.column<std::uint16_t>([&](std::size_t i, std::uint16_t val) {recs[i].targetWavelength = val;});
+    std::size_t numPrefs = 0;
+    reader.column<std::uint32_t>([&](std::size_t i, std::uint32_t val) {
+        recs[i].prefsBegin = numPrefs;
+        numPrefs += val;
+        recs[i].prefsEnd = numPrefs;
+    });
+
+    auto& prefs = pSnapshot->prefs;
+    prefs.resize(reader.beginTable());
+    if (prefs.size() != numPrefs)
+    {
+        throw std::runtime_error("Inconsistent number of visual preferences in binary log");
+    }
+    reader.column<std::uint16_t>([&](std::size_t i, std::uint16_t val) {prefs[i].lambda = val;});
+    reader.column<float>([&](std::size_t i, float val) {prefs[i].probLandTarget = val;});
+    reader.column<float>([&](std::size_t i, float val) {prefs[i].probLandNonTarget = val;});
+
+    return pSnapshot;
+}
+
+
+void PollinatorSummarySnapshot::writeBinary(std::string& buf) const
+{
+    BinaryChunkWriter w(buf, 'p', m_iGen, 0);
+
+    w.beginTable(pollinatorIds.size());
+    w.column<std::uint32_t>([&](std::size_t i) {return pollinatorIds[i];});
+    w.column<std::uint32_t>([&](std::size_t i) {
+        std::size_t end = (i + 1 < perfBegin.size()) ? perfBegin[i+1] : perf.size();
+        return end - perfBegin[i];
+    });
+
+    w.beginTable(perf.size());
+    w.column<std::uint32_t>([&](std::size_t i) {return perf[i].speciesId;});
+    w.column<std::int32_t>([&](std::size_t i) {return perf[i].numLandings;});
+    w.column<std::int32_t>([&](std::size_t i) {return perf[i].numPollinations;});
+    w.column<std::int32_t>([&](std::size_t i) {return perf[i].numPollenGrainsInStore;});
+
+    w.finish();
+}
+
+
+std::unique_ptr<LogSnapshot> PollinatorSummarySnapshot::readBinary(BinaryChunkReader& reader)
+{
+    auto pSnapshot = std::make_unique<PollinatorSummarySnapshot>(reader.getGen());
+
+    std::size_t numPollinators = reader.beginTable();
+    pSnapshot->pollinatorIds.resize(numPollinators);
+    pSnapshot->perfBegin.resize(numPollinators);
+    reader.column<std::uint32_t>([&](std::size_t i, std::uint32_t val) {pSnapshot->pollinatorIds[i] = val;});
+    std::size_t numPerf = 0;
+    reader.column<std::uint32_t>([&](std::size_t i, std::uint32_t val) {
+        pSnapshot->perfBegin[i] = numPerf;
+        numPerf += val;
+    });
+
+    auto& perf = pSnapshot->perf;
+    perf.resize(reader.beginTable());
+    if (perf.size() != numPerf)
+    {
+        throw std::runtime_error("Inconsistent number of pollinator performance records in binary log");
+    }
+    reader.column<std::uint32_t>([&](std::size_t i, std::uint32_t val) {perf[i].speciesId = val;});
+    reader.column<std::int32_t>([&](std::size_t i, std::int32_t val) {perf[i].numLandings = val;});
+    reader.column<std::int32_t>([&](std::size_t i, std::int32_t val) {perf[i].numPollinations = val;});
+    reader.column<std::int32_t>([&](std::size_t i, std::int32_t val) {perf[i].numPollenGrainsInStore = val;});
+
+    return pSnapshot;
+}
+
+
+void FlowerStatesSnapshot::writeBinary(std::string& buf) const
+{
+    BinaryChunkWriter w(buf, 'G', m_iGen, m_iStep);
+
+    w.beginTable(records.size());
+    w.column<std::uint32_t>([&](std::size_t i) {return records[i].id;});
+    w.column<std::uint32_t>([&](std::size_t i) {return records[i].speciesId;});
+    w.column<float>([&](std::size_t i) {return records[i].x;});
+    w.column<float>([&](std::size_t i) {return records[i].y;});
+    w.column<std::uint16_t>([&](std::size_t i) {return records[i].lambda;});
+    w.column<std::uint8_t>([&](std::size_t i) {return (std::uint8_t)records[i].pollinated;});
+    w.column<std::int32_t>([&](std::size_t i) {return records[i].antherPollen;});
+    w.column<std::uint64_t>([&](std::size_t i) {return records[i].numStigmaPollen;});
+    w.column<std::int32_t>([&](std::size_t i) {return records[i].availableNectar;});
+
+    w.finish();
+}
+
+
+std::unique_ptr<LogSnapshot> FlowerStatesSnapshot::readBinary(BinaryChunkReader& reader)
+{
+    auto pSnapshot = std::make_unique<FlowerStatesSnapshot>(reader.getGen(), reader.getStep());
+    auto& recs = pSnapshot->records;
+
+    recs.resize(reader.beginTable());
+    reader.column<std::uint32_t>([&](std::size_t i, std::uint32_t val) {recs[i].id = val;});
+    reader.column<std::uint32_t>([&](std::size_t i, std::uint32_t val) {recs[i].speciesId = val;});
+    reader.column<float>([&](std::size_t i, float val) {recs[i].x = val;});
+    reader.column<float>([&](std::size_t i, float val) {recs[i].y = val;});
+    reader.column<std::uint16_t>([&](std::size_t i, std::uint16_t val) {recs[i].lambda = val;});
+    reader.column<std::uint8_t>([&](std::size_t i, std::uint8_t val) {recs[i].pollinated = val;});
+    reader.column<std::int32_t>([&](std::size_t i, std::int32_t val) {recs[i].antherPollen = val;});
+    reader.column<std::uint64_t>([&](std::size_t i, std::uint64_t val) {recs[i].numStigmaPollen = val;});
+    reader.column<std::int32_t>([&](std::size_t i, std::int32_t val) {recs[i].availableNectar = val;});
+
+    return pSnapshot;
+}
+
+
+void FlowersFullSnapshot::writeBinary(std::string& buf) const
+{
+    BinaryChunkWriter w(buf, 'F', m_iGen, 0);
+
+    w.beginTable(plants.size());
+    w.column<std::uint32_t>([&](std::size_t i) {return plants[i].id;});
+    w.column<std::uint32_t>([&](std::size_t i) {return plants[i].speciesId;});
+    w.column<float>([&](std::size_t i) {return plants[i].x;});
+    w.column<float>([&](std::size_t i) {return plants[i].y;});
+    w.column<std::uint32_t>([&](std::size_t i) {return plants[i].localityId;});
+    w.column<std::uint32_t>([&](std::size_t i) {return plants[i].flowersEnd - plants[i].flowersBegin;});
+
+    w.beginTable(flowers.size());
+    w.column<std::uint32_t>([&](std::size_t i) {return flowers[i].id;});
+    w.column<std::uint8_t>([&](std::size_t i) {return (std::uint8_t)flowers[i].pollinated;});
+    w.column<std::uint16_t>([&](std::size_t i) {return flowers[i].lambda;});
+    w.column<std::uint32_t>([&](std::size_t i) {return flowers[i].sourcesEnd - flowers[i].sourcesBegin;});
+
+    w.beginTable(sources.size());
+    w.column<std::uint16_t>([&](std::size_t i) {return sources[i].lambda;});
+    w.column<std::int32_t>([&](std::size_t i) {return sources[i].count;});
+    w.column<std::uint32_t>([&](std::size_t i) {return sources[i].sourceFlowerId;});
+
+    w.finish();
+}
+
+
+std::unique_ptr<LogSnapshot> FlowersFullSnapshot::readBinary(BinaryChunkReader& reader)
+{
+    auto pSnapshot = std::make_unique<FlowersFullSnapshot>(reader.getGen());
+    auto& plants = pSnapshot->plants;
+    auto& flowers = pSnapshot->flowers;
+    auto& sources = pSnapshot->sources;
+
+    plants.resize(reader.beginTable());
+    reader.column<std::uint32_t>([&](std::size_t i, std::uint32_t val) {plants[i].id = val;});
+    reader.column<std::uint32_t>([&](std::size_t i, std::uint32_t val) {plants[i].speciesId = val;});
+    reader.column<float>([&](std::size_t i, float val) {plants[i].x = val;});
+    reader.column<float>([&](std::size_t i, float val) {plants[i].y = val;});
+    reader.column<std::uint32_t>([&](std::size_t i, std::uint32_t val) {plants[i].localityId = val;});
+    std::size_t numFlowers = 0;
+    reader.column<std::uint32_t>([&](std::size_t i, std::uint32_t val) {
+        plants[i].flowersBegin = numFlowers;
+        numFlowers += val;
+        plants[i].flowersEnd = numFlowers;
+    });
+
+    flowers.resize(reader.beginTable());
+    if (flowers.size() != numFlowers)
+    {
+        throw std::runtime_error("Inconsistent number of flowers in binary log");
+    }
+    reader.column<std::uint32_t>([&](std::size_t i, std::uint32_t val) {flowers[i].id = val;});
+    reader.column<std::uint8_t>([&](std::size_t i, std::uint8_t val) {flowers[i].pollinated = val;});
+    reader.column<std::uint16_t>([&](std::size_t i, std::uint16_t val) {flowers[i].lambda = val;});
+    std::size_t numSources = 0;
+    reader.column<std::uint32_t>([&](std::size_t i, std::uint32_t val) {
+        flowers[i].sourcesBegin = numSources;
+        numSources += val;
+        flowers[i].sourcesEnd = numSources;
+    });
+
+    sources.resize(reader.beginTable());
+    if (sources.size() != numSources)
+    {
+        throw std::runtime_error("Inconsistent number of pollen sources in binary log");
+    }
+    reader.column<std::uint16_t>([&](std::size_t i, std::uint16_t val) {sources[i].lambda = val;});
+    reader.column<std::int32_t>([&](std::size_t i, std::int32_t val) {sources[i].count = val;});
+    reader.column<std::uint32_t>([&](std::size_t i, std::uint32_t val) {sources[i].sourceFlowerId = val;});
+
+    return pSnapshot;
+}
+
+
+void SummaryCountsSnapshot::writeBinary(std::string& buf) const
+{
+    const BinaryTableSchema& table = BinaryLogSchema::getRecordSchema(m_Tag).tables.at(0);
+    bool hasNames = (table.columns.size() > 1) && (table.columns[1].type == BinaryColumnType::STR);
+    if (hasNames != !names.empty() && !keys.empty())
+    {
+        throw std::runtime_error("SummaryCountsSnapshot names do not match the binary log schema");
+    }
+
+    BinaryChunkWriter w(buf, m_Tag, m_iGen, m_iStep);
+
+    w.beginTable(keys.size());
+    w.column<std::int64_t>([&](std::size_t i) {return keys[i];});
+    if (hasNames)
+    {
+        w.stringColumn([&](std::size_t i) -> const std::string& {return names[i];});
+    }
+    for (std::size_t v = 0; v < m_iNumValuesPerRow; ++v)
+    {
+        w.column<std::int64_t>([&](std::size_t i) {return values[(i * m_iNumValuesPerRow) + v];});
+    }
+
+    w.finish();
+}
+
+
+// The number of value columns, and whether there is a name column, is determined
+// by the record type's schema
+std::unique_ptr<LogSnapshot> SummaryCountsSnapshot::readBinary(BinaryChunkReader& reader)
+{
+    const BinaryTableSchema& table = BinaryLogSchema::getRecordSchema(reader.getTag()).tables.at(0);
+    bool hasNames = (table.columns.size() > 1) && (table.columns[1].type == BinaryColumnType::STR);
+    std::size_t numValuesPerRow = table.columns.size() - (hasNames ? 2 : 1);
+
+    auto pSnapshot = std::make_unique<SummaryCountsSnapshot>(reader.getTag(), reader.getGen(),
+                                                             reader.getStep(), numValuesPerRow);
+    auto& keys = pSnapshot->keys;
+    auto& names = pSnapshot->names;
+    auto& values = pSnapshot->values;
+
+    std::size_t numRows = reader.beginTable();
+    keys.resize(numRows);
+    values.resize(numRows * numValuesPerRow);
+    reader.column<std::int64_t>([&](std::size_t i, std::int64_t val) {keys[i] = val;});
+    if (hasNames)
+    {
+        names.resize(numRows);
+        reader.stringColumn([&](std::size_t i, std::string val) {names[i] = std::move(val);});
+    }
+    for (std::size_t v = 0; v < numValuesPerRow; ++v)
+    {
+        reader.column<std::int64_t>([&](std::size_t i, std::int64_t val) {values[(i * numValuesPerRow) + v] = val;});
+    }
+
+    return pSnapshot;
+}
@@ -15,11 +15,13 @@
 #include <filesystem>
 #include <chrono>
 #include <utility>
+#include <memory>
 #include "evobeeConfig.h"
 #include "EvoBeeModel.h"
 #include "Environment.h"
 #include "Pollinator.h"
 #include "ModelParams.h"
+#include "LogBinary.h"
 #include "Logger.h"
 
 namespace fs = std::filesystem;
@@ -28,9 +30,20 @@ using json = nlohmann::json;
 
 Logger::Logger(EvoBeeModel* pModel) :
     m_strConfigFileSuffix {"-config.json"},
-    m_strMainLogFileSuffix {"-log.txt"},
+    m_strMainLogFileSuffix {ModelParams::getLogFormat() == LogFormat::BINARY ? "-log.bin" : "-log.txt"},
     m_strRunInfoFileSuffix {"-info.txt"},
-    m_pModel(pModel)
+    m_pModel(pModel),
+    m_LogBuffer(m_sLogBufferSize),
+    m_LogStream(),
+    m_Queue(m_sQueueCapacity),
+    m_bWriterStop(false),
+    m_bWriterFailed(false),
+    m_pWriterException(nullptr),
+    m_bFinished(false),
+    m_iNumSnapshots(0),
+    m_iNumProducerWaits(0),
+    m_fProducerWaitSecs(0.0),
+    m_iMaxQueueDepth(0)
 {
     assert(ModelParams::initialised());
 
@@ -87,12 +100,196 @@ Logger::Logger(EvoBeeModel* pModel) :
             std::cerr << "Unable to set up Logger:" << e.what() << std::endl;
             exit(1);
         }
+
+        if (ModelParams::useLogThreads())
+        {
+            m_WriterThread = std::thread(&Logger::writerLoop, this);
+        }
     }
 }
 
 
 Logger::~Logger()
 {
+    try
+    {
+        finishWriting();
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Error writing log file: " << e.what() << std::endl;
+    }
+}
+
+
+// Pass a snapshot to the writer thread, or write it straight away if we are not
+// using a writer thread. If the queue is full, the simulation thread backs off
+// until the writer has made some space; the number and duration of these waits
+// are recorded and reported by finishWriting().
+void Logger::submit(std::unique_ptr<LogSnapshot> pSnapshot)
+{
+    if (pSnapshot)
+    {
+        ++m_iNumSnapshots;
+    }
+
+    if (!m_WriterThread.joinable())
+    {
+        writeSnapshot(pSnapshot.get());
+        return;
+    }
+
+    if (!m_Queue.tryPush(pSnapshot))
+    {
+        ++m_iNumProducerWaits;
+        auto start = std::chrono::steady_clock::now();
+        do
+        {
+            if (m_bWriterFailed.load(std::memory_order_acquire))
+            {
+                break;
+            }
+            std::this_thread::yield();
+        } while (!m_Queue.tryPush(pSnapshot));
+        m_fProducerWaitSecs +=
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    if (m_bWriterFailed.load(std::memory_order_acquire))
+    {
+        finishWriting();
+    }
+
+    m_iMaxQueueDepth = std::max(m_iMaxQueueDepth, m_Queue.size());
+}
+
+
+// Format a snapshot and write it to the main log file. A null snapshot is used
+// as a request to flush the log file (see flush()).
+void Logger::writeSnapshot(const LogSnapshot* pSnapshot)
+{
+    openLogFile();
+
+    if (pSnapshot == nullptr)
+    {
+        flushLogFile();
+        return;
+    }
+
+    m_strLineBuffer.clear();
+    if (ModelParams::getLogFormat() == LogFormat::BINARY)
+    {
+        pSnapshot->writeBinary(m_strLineBuffer);
+    }
+    else
+    {
+        pSnapshot->write(m_strLineBuffer);
+    }
+    m_LogStream.write(m_strLineBuffer.data(), m_strLineBuffer.size());
+    if (!m_LogStream)
+    {
+        std::stringstream msg;
+        msg << "Error writing to log file " << m_MainLogFilePath;
+        throw std::runtime_error(msg.str());
+    }
+}
+
+
+void Logger::flush()
+{
+    if (!ModelParams::logging())
+    {
+        return;
+    }
+
+    submit(nullptr);
+}
+
+
+// Main loop of the writer thread: write snapshots in the order in which they were
+// submitted until asked to stop, then write anything left in the queue and exit.
+void Logger::writerLoop()
+{
+    try
+    {
+        std::unique_ptr<LogSnapshot> pSnapshot;
+        while (true)
+        {
+            if (m_Queue.tryPop(pSnapshot))
+            {
+                writeSnapshot(pSnapshot.get());
+                pSnapshot.reset();
+            }
+            else if (m_bWriterStop.load(std::memory_order_acquire))
+            {
+                // the producer has stopped, so once the queue is seen empty it stays empty
+                if (m_Queue.size() == 0)
+                {
+                    return;
+                }
+            }
+            else
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    }
+    catch (...)
+    {
+        m_pWriterException = std::current_exception();
+        m_bWriterFailed.store(true, std::memory_order_release);
+    }
+}
+
+
+void Logger::finishWriting()
+{
+    if (m_bFinished || !ModelParams::logging())
+    {
+        return;
+    }
+    m_bFinished = true;
+
+    bool bThreaded = m_WriterThread.joinable();
+    if (bThreaded)
+    {
+        m_bWriterStop.store(true, std::memory_order_release);
+        m_WriterThread.join();
+
+        if (m_pWriterException)
+        {
+            std::rethrow_exception(m_pWriterException);
+        }
+    }
+
+    if (m_LogStream.is_open())
+    {
+        flushLogFile();
+        m_LogStream.close();
+    }
+
+    if (!bThreaded)
+    {
+        return;
+    }
+
+    std::ofstream ofs {m_RunInfoFilePath, std::ofstream::app};
+    if (ofs)
+    {
+        ofs << "Log snapshots written = " << m_iNumSnapshots << std::endl
+            << "Log queue capacity = " << m_Queue.capacity() << std::endl
+            << "Log queue max depth = " << m_iMaxQueueDepth << std::endl
+            << "Log queue producer waits = " << m_iNumProducerWaits << std::endl
+            << "Log queue producer wait time (s) = " << m_fProducerWaitSecs << std::endl;
+    }
+
+    if (ModelParams::verbose())
+    {
+        std::cout << "Log writer: " << m_iNumSnapshots << " snapshots, max queue depth "
+                  << m_iMaxQueueDepth << "/" << m_Queue.capacity() << ", "
+                  << m_iNumProducerWaits << " producer waits totalling "
+                  << m_fProducerWaitSecs << "s" << std::endl;
+    }
 }
 
 
@@ -131,16 +328,18 @@ void Logger::logExptSetup()
 //
 void Logger::logPollinatorsIntraPhaseFull()
 {
-    std::ofstream ofs = openLogFile();
-
     auto gen = m_pModel->getGenNumber();
     auto step = m_pModel->getStepNumber();
     auto& pollinators = m_pEnv->getAllPollinators();
 
+    auto pSnapshot = std::make_unique<PollinatorStatesSnapshot>('Q', gen, step);
+    pSnapshot->records.reserve(pollinators.size());
     for (auto p : pollinators)
     {
-        ofs << "Q," << gen << "," << step << "," << p->getStateString() << std::endl;
+        p->captureState(*pSnapshot);
     }
+
+    submit(std::move(pSnapshot));
 }
 
 
@@ -150,16 +349,18 @@ void Logger::logPollinatorsIntraPhaseFull()
 //
 void Logger::logPollinatorsInterPhaseFull()
 {
-    std::ofstream ofs = openLogFile();
-
     auto gen = m_pModel->getGenNumber();
     auto step = m_pModel->getStepNumber();
     auto& pollinators = m_pEnv->getAllPollinators();
 
+    auto pSnapshot = std::make_unique<PollinatorStatesSnapshot>('P', gen, step);
+    pSnapshot->records.reserve(pollinators.size());
     for (auto p : pollinators)
     {
-        ofs << "P," << gen << "," << step << "," << p->getStateString() << std::endl;
+        p->captureState(*pSnapshot);
     }
+
+    submit(std::move(pSnapshot));
 }
 
 
@@ -169,24 +370,25 @@ void Logger::logPollinatorsInterPhaseFull()
 //
 void Logger::logPollinatorsInterPhaseSummary()
 {
-    std::ofstream ofs = openLogFile();
     auto gen = m_pModel->getGenNumber();
     auto& pollinators = m_pEnv->getAllPollinators();
 
+    auto pSnapshot = std::make_unique<PollinatorSummarySnapshot>(gen);
     for (auto pPol : pollinators)
     {
-        ofs << "p," << gen << "," << pPol->getId();
+        pSnapshot->pollinatorIds.push_back(pPol->getId());
+        pSnapshot->perfBegin.push_back(pSnapshot->perf.size());
 
         auto& perfMap = pPol->getPerformanceInfoMap();
         for (auto& perfInfo : perfMap)
         {
-            ofs << "," << perfInfo.first << "," << perfInfo.second.numLandings
-                << "," << perfInfo.second.numPollinations << ","
-                << pPol->getNumPollenGrainsInStore(perfInfo.first);
+            pSnapshot->perf.push_back({perfInfo.first, perfInfo.second.numLandings,
+                                       perfInfo.second.numPollinations,
+                                       pPol->getNumPollenGrainsInStore(perfInfo.first)});
         }
-
-        ofs << std::endl;
     }
+
+    submit(std::move(pSnapshot));
 }
 
 
@@ -196,10 +398,10 @@ void Logger::logPollinatorsInterPhaseSummary()
 //
 void Logger::logFlowersInterPhaseFull()
 {
-    std::ofstream ofs = openLogFile();
     auto gen = m_pModel->getGenNumber();
     std::vector<Patch>& patches = m_pEnv->getPatches();
 
+    auto pSnapshot = std::make_unique<FlowersFullSnapshot>(gen);
     std::map<MarkerPoint, std::pair<int, unsigned int>> pollenSourceMpMap;
 
     for (Patch& patch : patches)
@@ -208,24 +410,24 @@ void Logger::logFlowersInterPhaseFull()
         {
             //const iPos& pos = patch.getPosition();
 
-            PlantVector& plants = patch.getFloweringPlants();
+            PlantRange plants = patch.getFloweringPlants();
             for (FloweringPlant& plant : plants)
             {
                 const fPos& pos = plant.getPosition();
 
-                ofs << "F," << gen << "," << plant.getId() << "," << plant.getSpeciesId()
-                    << "," << pos << "," << patch.getLocalityId();
+                PlantRecord plantRec {plant.getId(), plant.getSpeciesId(), pos.x, pos.y,
+                                      patch.getLocalityId(), pSnapshot->flowers.size(), 0};
 
                 if (true) //plant.pollinated())
                 {
-                    const std::vector<Flower>& flowers = plant.getFlowers();
+                    const FlowerVector& flowers = plant.getFlowers();
                     for (const Flower& flower : flowers)
                     {
                         pollenSourceMpMap.clear();
 
                         MarkerPoint thisLambda = flower.getCharacteristicWavelength();
-                        ofs << ",:," << flower.getId() << "," << (flower.pollinated() ? "P" : "N")
-                            << "," << thisLambda << ",~,";
+                        FlowerPollenRecord flowerRec {flower.getId(), flower.pollinated(), thisLambda,
+                                                      pSnapshot->sources.size(), 0};
 
                         const PollenVector& stigmaPollen = flower.getStigmaPollen();
                         for (const Pollen& pollen : stigmaPollen)
@@ -243,21 +445,21 @@ void Logger::logFlowersInterPhaseFull()
                         }
 
                         for (auto& info : pollenSourceMpMap) {
-                            // NB the final item in the output triplet is the unique idea of the pollen source
-                            // flower, but this only makes sense when there is just a single pollen grain of
-                            // a given species. If there is more than one pollen grain of the species present,
-                            // they may have come from various different source flowers.
-                            ofs << info.first << "," << info.second.first << "," << info.second.second << ",";
+                            pSnapshot->sources.push_back({info.first, info.second.first, info.second.second});
                         }
 
-                        ofs << "~";
+                        flowerRec.sourcesEnd = pSnapshot->sources.size();
+                        pSnapshot->flowers.push_back(flowerRec);
                     }
                 }
 
-                ofs << std::endl;
+                plantRec.flowersEnd = pSnapshot->flowers.size();
+                pSnapshot->plants.push_back(plantRec);
             }
         }
     }
+
+    submit(std::move(pSnapshot));
 }
 
 
@@ -267,7 +469,6 @@ void Logger::logFlowersInterPhaseFull()
 //
 void Logger::logFlowersInterPhaseSummary()
 {
-    std::ofstream ofs = openLogFile();
     auto gen = m_pModel->getGenNumber();
     std::vector<Patch>& patches = m_pEnv->getPatches();
 
@@ -284,7 +485,7 @@ void Logger::logFlowersInterPhaseSummary()
     {
         if (patch.hasFloweringPlants())
         {
-            PlantVector& plants = patch.getFloweringPlants();
+            PlantRange plants = patch.getFloweringPlants();
             for (FloweringPlant& plant : plants)
             {
                 speciesCounts[plant.getSpeciesId()].first++;
@@ -296,12 +497,16 @@ void Logger::logFlowersInterPhaseSummary()
         }
     }
 
+    auto pSnapshot = std::make_unique<SummaryCountsSnapshot>('f', gen, m_pModel->getStepNumber(), 2);
     for (auto& countInfo : speciesCounts)
     {
-        ofs << "f," << gen << "," << m_pModel->getStepNumber() << ","
-            << countInfo.first << "," << speciesInfoMap.at(countInfo.first)
-            << "," << countInfo.second.first << "," << countInfo.second.second << std::endl;
+        pSnapshot->keys.push_back(countInfo.first);
+        pSnapshot->names.push_back(speciesInfoMap.at(countInfo.first));
+        pSnapshot->values.push_back(countInfo.second.first);
+        pSnapshot->values.push_back(countInfo.second.second);
     }
+
+    submit(std::move(pSnapshot));
 }
 
 
@@ -311,24 +516,26 @@ void Logger::logFlowersInterPhaseSummary()
 //
 void Logger::logFlowersIntraPhaseFull()
 {
-    std::ofstream ofs = openLogFile();
     auto gen = m_pModel->getGenNumber();
     auto step = m_pModel->getStepNumber();
     std::vector<Patch>& patches = m_pEnv->getPatches();
 
+    auto pSnapshot = std::make_unique<FlowerStatesSnapshot>(gen, step);
+
     for (Patch& patch : patches)
     {
         if (patch.hasFloweringPlants())
         {
-            PlantVector& plants = patch.getFloweringPlants();
+            PlantRange plants = patch.getFloweringPlants();
             for (FloweringPlant& plant : plants)
             {
                 Flower* pFlower = plant.getFlower(0);
-                ofs << "G," << gen << "," << step << "," << pFlower->getStateString() << std::endl;
+                pSnapshot->records.push_back(pFlower->captureState());
             }
         }
     }
 
+    submit(std::move(pSnapshot));
 }
 
 
@@ -338,7 +545,6 @@ void Logger::logFlowersIntraPhaseFull()
 //
 void Logger::logFlowersIntraPhaseSummary()
 {
-    std::ofstream ofs = openLogFile();
     auto gen = m_pModel->getGenNumber();
     auto step = m_pModel->getStepNumber();
     std::vector<Patch>& patches = m_pEnv->getPatches();
@@ -356,7 +562,7 @@ void Logger::logFlowersIntraPhaseSummary()
     {
         if (patch.hasFloweringPlants())
         {
-            PlantVector& plants = patch.getFloweringPlants();
+            PlantRange plants = patch.getFloweringPlants();
             for (FloweringPlant& plant : plants)
             {
                 speciesCounts[plant.getSpeciesId()].first++;
@@ -368,11 +574,16 @@ void Logger::logFlowersIntraPhaseSummary()
         }
     }
 
+    auto pSnapshot = std::make_unique<SummaryCountsSnapshot>('g', gen, step, 2);
     for (auto& countInfo : speciesCounts)
     {
-        ofs << "g," << gen << "," << step << "," << countInfo.first << "," << speciesInfoMap.at(countInfo.first)
-            << "," << countInfo.second.first << "," << countInfo.second.second << std::endl;
+        pSnapshot->keys.push_back(countInfo.first);
+        pSnapshot->names.push_back(speciesInfoMap.at(countInfo.first));
+        pSnapshot->values.push_back(countInfo.second.first);
+        pSnapshot->values.push_back(countInfo.second.second);
     }
+
+    submit(std::move(pSnapshot));
 }
 
 
@@ -382,7 +593,6 @@ void Logger::logFlowersIntraPhaseSummary()
 //
 void Logger::logFlowerMPsInterPhaseSummary()
 {
-    std::ofstream ofs = openLogFile();
     auto gen = m_pModel->getGenNumber();
     std::vector<Patch>& patches = m_pEnv->getPatches();
 
@@ -400,7 +610,7 @@ void Logger::logFlowerMPsInterPhaseSummary()
         if (patch.hasFloweringPlants())
         {
             bool bCommunal = !(patch.refuge());
-            PlantVector& plants = patch.getFloweringPlants();
+            PlantRange plants = patch.getFloweringPlants();
             for (FloweringPlant& plant : plants)
             {
                 unsigned int pol = plant.pollinated() ? 1 : 0;
@@ -421,13 +631,17 @@ void Logger::logFlowerMPsInterPhaseSummary()
         }
     }
 
+    auto pSnapshot = std::make_unique<SummaryCountsSnapshot>('m', gen, m_pModel->getStepNumber(), 4);
     for (auto& countInfo : mpCounts)
     {
-        ofs << "m," << gen << "," << m_pModel->getStepNumber() << "," << countInfo.first
-            << "," << std::get<0>(countInfo.second) << "," << std::get<1>(countInfo.second)
-            << "," << std::get<2>(countInfo.second) << "," << std::get<3>(countInfo.second)
-            << std::endl;
+        pSnapshot->keys.push_back(countInfo.first);
+        pSnapshot->values.push_back(std::get<0>(countInfo.second));
+        pSnapshot->values.push_back(std::get<1>(countInfo.second));
+        pSnapshot->values.push_back(std::get<2>(countInfo.second));
+        pSnapshot->values.push_back(std::get<3>(countInfo.second));
     }
+
+    submit(std::move(pSnapshot));
 }
 
 
@@ -438,7 +652,6 @@ void Logger::logFlowerMPsInterPhaseSummary()
 //
 void Logger::logFlowerInfoInterPhaseSummary()
 {
-    std::ofstream ofs = openLogFile();
     auto gen = m_pModel->getGenNumber();
     std::vector<Patch>& patches = m_pEnv->getPatches();
 
@@ -459,7 +672,7 @@ void Logger::logFlowerInfoInterPhaseSummary()
         if (patch.hasFloweringPlants())
         {
             bool bCommunal = !(patch.refuge());
-            PlantVector& plants = patch.getFloweringPlants();
+            PlantRange plants = patch.getFloweringPlants();
             for (FloweringPlant& plant : plants)
             {
                 Flower* pFlower = plant.getFlower(); // assuming just one flower per plant
@@ -490,34 +703,89 @@ void Logger::logFlowerInfoInterPhaseSummary()
         }
     }
 
+    auto pSnapshot = std::make_unique<SummaryCountsSnapshot>('n', gen, m_pModel->getStepNumber(), 7);
     for (auto& countInfo : mpCounts)
     {
-        ofs << "n," << gen << "," << m_pModel->getStepNumber() << "," << countInfo.first
-            << "," << std::get<0>(countInfo.second) << "," << std::get<1>(countInfo.second)
-            << "," << std::get<2>(countInfo.second) << "," << std::get<3>(countInfo.second)
-            << "," << std::get<4>(countInfo.second) << "," << std::get<5>(countInfo.second)
-            << "," << std::get<6>(countInfo.second)
-            << std::endl;
+        pSnapshot->keys.push_back(countInfo.first);
+        pSnapshot->values.push_back(std::get<0>(countInfo.second));
+        pSnapshot->values.push_back(std::get<1>(countInfo.second));
+        pSnapshot->values.push_back(std::get<2>(countInfo.second));
+        pSnapshot->values.push_back(std::get<3>(countInfo.second));
+        pSnapshot->values.push_back(std::get<4>(countInfo.second));
+        pSnapshot->values.push_back(std::get<5>(countInfo.second));
+        pSnapshot->values.push_back(std::get<6>(countInfo.second));
     }
+
+    submit(std::move(pSnapshot));
+}
+
+
+// Log the number of steps taken by all pollinators during the foraging phase, so that runs
+// can be compared by the amount of work done rather than by the number of model steps
+//
+// This logging is designated by log-flags="s" in the JSON config file
+//
+void Logger::logPollinatorStepsInterPhaseSummary()
+{
+    auto gen = m_pModel->getGenNumber();
+    const PollinatorStepCounts& counts = m_pModel->getGenStepCounts();
+
+    auto pSnapshot = std::make_unique<SummaryCountsSnapshot>('s', gen, m_pModel->getStepNumber(), 4);
+    pSnapshot->keys.push_back(m_pEnv->getAllPollinators().size());
+    pSnapshot->values.push_back(counts.numSteps);
+    pSnapshot->values.push_back(counts.numFlowerVisits);
+    pSnapshot->values.push_back(counts.numLandingsDeclined);
+    pSnapshot->values.push_back(counts.numNoFlowerSeen);
+
+    submit(std::move(pSnapshot));
 }
 
 
-// private helper method to open the log file for appending
-// (the compiler should use the move assignment operator to efficiently return the ofstream object)
-std::ofstream Logger::openLogFile()
+// private helper method to open the main log file for appending, if it is not
+// already open. The file stays open (with a large output buffer) until finishWriting()
+// is called, so that we don't pay the cost of reopening and flushing it for every
+// set of log records.
+void Logger::openLogFile()
 {
     assert(ModelParams::logging());
 
-    // open log file for appending
-    std::ofstream ofs {m_MainLogFilePath, std::ofstream::app};
-    if (!ofs)
+    if (m_LogStream.is_open())
+    {
+        return;
+    }
+
+    bool bNewFile = !fs::exists(m_MainLogFilePath) || (fs::file_size(m_MainLogFilePath) == 0);
+
+    // NB the buffer must be set before the file is opened
+    m_LogStream.rdbuf()->pubsetbuf(m_LogBuffer.data(), m_LogBuffer.size());
+    m_LogStream.open(m_MainLogFilePath, std::ofstream::app);
+    if (!m_LogStream)
     {
         std::stringstream msg;
         msg << "Unable to open log file " << m_MainLogFilePath << " for writing";
         throw std::runtime_error(msg.str());
     }
 
-    return ofs; // the compiler should use the move assignment operator here
+    // a binary log file starts with a header describing its contents
+    if ((ModelParams::getLogFormat() == LogFormat::BINARY) && bNewFile)
+    {
+        std::string header;
+        BinaryLogSchema::writeHeader(header);
+        m_LogStream.write(header.data(), header.size());
+    }
+}
+
+
+// private helper method to flush the main log file
+void Logger::flushLogFile()
+{
+    m_LogStream.flush();
+    if (!m_LogStream)
+    {
+        std::stringstream msg;
+        msg << "Error writing to log file " << m_MainLogFilePath;
+        throw std::runtime_error(msg.str());
+    }
 }
 
 
@@ -525,6 +793,8 @@ std::ofstream Logger::openLogFile()
 // from this run from m_strLogDir to m_strLogFinalDir at the end of the run
 void Logger::transferFilesToFinalDir()
 {
+    finishWriting();
+
     const std::string& strLogFinalDir = ModelParams::getLogFinalDir();
 
     if (!strLogFinalDir.empty())
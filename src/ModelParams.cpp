@@ -40,7 +40,9 @@ bool   ModelParams::m_bLogFlowersIntraPhaseFull = false;
 bool   ModelParams::m_bLogFlowersIntraPhaseSummary = false;
 bool   ModelParams::m_bLogFlowerMPsInterPhaseSummary = false;
 bool   ModelParams::m_bLogFlowerInfoInterPhaseSummary = false;
+bool   ModelParams::m_bLogPollinatorStepsInterPhaseSummary = false;
 bool   ModelParams::m_bUseLogThreads = false;
+LogFormat ModelParams::m_LogFormat = LogFormat::TEXT;
 bool   ModelParams::m_bVerbose = true;
 bool   ModelParams::m_bCommandLineQuiet = false;
 bool   ModelParams::m_bPtdAutoDistribs = false;
@@ -61,6 +63,11 @@ std::string ModelParams::m_strLogDir {"output"};
 std::string ModelParams::m_strLogFinalDir {""};
 std::string ModelParams::m_strLogRunName {"run"};
 std::string ModelParams::m_strRngSeed {""};
+RngType ModelParams::m_RngType = RngType::MT19937;
+int   ModelParams::m_iPollinatorStepThreads = 0;
+bool  ModelParams::m_bPollinatorFastForward = true;
+int   ModelParams::m_iCheckpointPeriod = 0;
+std::string ModelParams::m_strResumeCheckpointFile {""};
 std::string ModelParams::m_strNoSpecies {"NOSPECIES"};
 std::vector<HiveConfig> ModelParams::m_Hives;
 std::vector<PlantTypeDistributionConfig> ModelParams::m_PlantDists;
@@ -68,6 +75,11 @@ std::vector<PlantTypeConfig> ModelParams::m_PlantTypes;
 std::vector<PollinatorConfig> ModelParams::m_PollinatorConfigs;
 ColourSystem ModelParams::m_ColourSystem = ColourSystem::REGULAR_MARKER_POINTS;
 unsigned int ModelParams::m_iTestNumber = 0;
+unsigned int ModelParams::m_iNumReplicates = 1;
+unsigned int ModelParams::m_iNumReplicateWorkers = 1;
+int   ModelParams::m_iBranchAtGen = 0;
+std::string ModelParams::m_strBranchesFile {""};
+unsigned int ModelParams::m_iBranchNumber = 0;
 bool   ModelParams::m_bSyntheticRegularMarkerPointsAdded = false;
 
 nlohmann::json ModelParams::m_Json;
@@ -237,6 +249,11 @@ void ModelParams::setLogFlags(const std::string& flags)
             m_bLogFlowerInfoInterPhaseSummary = true;
             break;
         }
+        case 's':
+        {
+            m_bLogPollinatorStepsInterPhaseSummary = true;
+            break;
+        }
         default:
         {
             std::cerr << "Warning: Ignoring unknown log flag '" << flag << "'" << std::endl;
@@ -328,6 +345,38 @@ void ModelParams::setRngSeedStr(const std::string& seed, bool bRewriteJsonEntry
     }
 }
 
+void ModelParams::setRngType(const std::string& typestr)
+{
+    if (typestr == "mt19937") {
+        m_RngType = RngType::MT19937;
+    }
+    else if (typestr == "philox") {
+        m_RngType = RngType::PHILOX;
+    }
+    else {
+        m_RngType = RngType::MT19937;
+        if (verbose()) {
+            std::cout << "Warning: unrecognised RNG type (" << typestr << "). Assuming mt19937." << std::endl;
+        }
+    }
+}
+
+void ModelParams::setPollinatorStepThreads(int threads)
+{
+    if (threads >= 0)
+    {
+        m_iPollinatorStepThreads = threads;
+    }
+}
+
+void ModelParams::setCheckpointPeriod(int p)
+{
+    if (p >= 0)
+    {
+        m_iCheckpointPeriod = p;
+    }
+}
+
 void ModelParams::setLogDir(const std::string& dir)
 {
     m_strLogDir = dir;
@@ -343,6 +392,22 @@ void ModelParams::setLogRunName(const std::string& name)
     m_strLogRunName = name;
 }
 
+void ModelParams::setLogFormat(const std::string& formatstr)
+{
+    if (formatstr == "text") {
+        m_LogFormat = LogFormat::TEXT;
+    }
+    else if (formatstr == "binary") {
+        m_LogFormat = LogFormat::BINARY;
+    }
+    else {
+        m_LogFormat = LogFormat::TEXT;
+        if (verbose()) {
+            std::cout << "Warning: unrecognised log format (" << formatstr << "). Assuming text." << std::endl;
+        }
+    }
+}
+
 void ModelParams::setInitialised()
 {
     m_bInitialised = true;
@@ -353,6 +418,51 @@ void ModelParams::setTestNumber(unsigned int num)
     m_iTestNumber = num;
 }
 
+void ModelParams::setNumReplicates(unsigned int num)
+{
+    if (num > 0)
+    {
+        m_iNumReplicates = num;
+    }
+}
+
+void ModelParams::setNumReplicateWorkers(unsigned int num)
+{
+    if (num > 0)
+    {
+        m_iNumReplicateWorkers = num;
+    }
+}
+
+void ModelParams::setBranchAtGen(int gen)
+{
+    if (gen > 0)
+    {
+        m_iBranchAtGen = gen;
+    }
+}
+
+void ModelParams::clearConfigSections()
+{
+    m_Hives.clear();
+    m_PlantDists.clear();
+    m_PlantTypes.clear();
+    m_PollinatorConfigs.clear();
+    m_sNextFreePtdcId = 1;
+    m_bSyntheticRegularMarkerPointsAdded = false;
+
+    m_bLogPollinatorsIntraPhaseFull = false;
+    m_bLogPollinatorsInterPhaseFull = false;
+    m_bLogPollinatorsInterPhaseSummary = false;
+    m_bLogFlowersInterPhaseFull = false;
+    m_bLogFlowersInterPhaseSummary = false;
+    m_bLogFlowersIntraPhaseFull = false;
+    m_bLogFlowersIntraPhaseSummary = false;
+    m_bLogFlowerMPsInterPhaseSummary = false;
+    m_bLogFlowerInfoInterPhaseSummary = false;
+    m_bLogPollinatorStepsInterPhaseSummary = false;
+}
+
 void ModelParams::addHiveConfig(HiveConfig& hc)
 {
     m_Hives.push_back(hc);
@@ -915,6 +1025,10 @@ void ModelParams::checkConsistency()
         }
     }
 
+    if ((m_iPollinatorStepThreads > 0) && (m_RngType != RngType::PHILOX))
+    {
+        throw std::runtime_error("Error: pollinator-step-threads > 0 requires rng-type to be set to 'philox'");
+    }
     switch (m_ColourSystem) {
         case ColourSystem::REGULAR_MARKER_POINTS:
         {
@@ -1013,6 +1127,61 @@ void ModelParams::pairPlantTypeConfigsToVisData()
 }
 
 
+// Find the index of the first entry in the pollinators' vis-data whose wavelength matches the
+// characteristic wavelength of the given stimulus. This is the vis-data held by Hymenoptera (taken
+// from the first pollinator config that defines any), so the index can be used to look up
+// entries in Hymenoptera's vis-data and visual preference vectors directly.
+// Returns -1 if there is no vis-data or no matching entry.
+int ModelParams::getVisDataIdx(const ReflectanceInfo& rinfo)
+{
+    auto itPC = std::find_if(m_PollinatorConfigs.begin(),
+                             m_PollinatorConfigs.end(),
+                             [](const PollinatorConfig& pc) {return pc.visDataDefined;});
+    if (itPC == m_PollinatorConfigs.end())
+    {
+        return -1;
+    }
+
+    const std::vector<VisualStimulusInfo>& visData = itPC->visData;
+
+    switch (m_ColourSystem)
+    {
+        case ColourSystem::REGULAR_MARKER_POINTS:
+        {
+            MarkerPoint mp = rinfo.getMarkerPoint();
+            if ((itPC->visDataMPStep == 0) ||
+                (mp < itPC->visDataMPMin) ||
+                (mp > itPC->visDataMPMax) ||
+                ((mp - itPC->visDataMPMin) % itPC->visDataMPStep != 0))
+            {
+                return -1;
+            }
+
+            std::size_t idx = (std::size_t)((mp - itPC->visDataMPMin) / itPC->visDataMPStep);
+            return (idx < visData.size()) ? (int)idx : -1;
+        }
+        case ColourSystem::ARBITRARY_DOMINANT_WAVELENGTHS:
+        {
+            const VisualStimulusInfo* pVSI = rinfo.getVisDataPtr();
+            if (pVSI == nullptr)
+            {
+                return -1;
+            }
+
+            Wavelength lambda = pVSI->getWavelength();
+            auto it = std::find_if(visData.begin(),
+                                   visData.end(),
+                                   [lambda](const VisualStimulusInfo& vsi) {return (vsi.getWavelength() == lambda);});
+            return (it != visData.end()) ? (int)(it - visData.begin()) : -1;
+        }
+        default:
+        {
+            throw std::runtime_error("Error: encountered unknown ColourSystem in ModelParams::getVisDataIdx(). Aborting!");
+        }
+    }
+}
+
+
 const std::vector<VisualStimulusInfo>& ModelParams::getVisData()
 {
     // this method is only designed to be used with ColourSystem::ARBITRARY_DOMINANT_WAVELENGTHS
@@ -0,0 +1,225 @@
+/**
+ * @file
+ *
+ * Implementation of the ParallelStepper class
+ */
+
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+#include "Environment.h"
+#include "Pollinator.h"
+#include "EvoBeeModel.h"
+#include "ParallelStepper.h"
+
+
+ParallelStepper::ParallelStepper(Environment* pEnv, unsigned int numThreads) :
+    m_pEnv(pEnv),
+    m_iNumThreads(std::max(numThreads, 1u)),
+    m_iTileSize(0),
+    m_iNumTilesX(0),
+    m_iNumTilesY(0),
+    m_iNextPhaseTile(0),
+    m_iPhaseCounter(0),
+    m_iNumBusyWorkers(0),
+    m_bShutdown(false)
+{
+    assert(m_pEnv != nullptr);
+
+    // Find the maximum reach of any pollinator in a single step. If any pollinator has
+    // an unbounded reach, the environment cannot be partitioned and we leave
+    // m_iTileSize at 0 to indicate that parallel stepping is not available.
+    float maxReach = 0.0;
+    for (const Pollinator* pPollinator : m_pEnv->getAllPollinators())
+    {
+        float reach = pPollinator->getMaxStepReach();
+        if (reach < 0.0)
+        {
+            return;
+        }
+        maxReach = std::max(maxReach, reach);
+    }
+
+    // A pollinator starting in a given patch can only touch flowers in patches at most
+    // ceil(maxReach) patches away in x and y (we add one extra patch as a guard against
+    // rounding). Tiles in the same phase are separated by one whole tile, so they can
+    // never touch the same patch if the tile size is at least twice this distance.
+    int patchReach = (int)std::ceil(maxReach) + 1;
+    m_iTileSize = 2 * patchReach;
+    m_iNumTilesX = (m_pEnv->getSizeXi() + m_iTileSize - 1) / m_iTileSize;
+    m_iNumTilesY = (m_pEnv->getSizeYi() + m_iTileSize - 1) / m_iTileSize;
+    m_TilePollinators.resize(m_iNumTilesX * m_iNumTilesY);
+    m_PhaseTiles.reserve(m_TilePollinators.size());
+
+    // Each worker thread gets its own copy of the (already seeded) model RNG engine.
+    // As every pollinator step selects its own stream, the results do not depend on
+    // which thread processes which tile.
+    for (unsigned int i = 1; i < m_iNumThreads; ++i)
+    {
+        m_Workers.emplace_back(&ParallelStepper::workerLoop, this, EvoBeeModel::m_sRngEngine);
+    }
+}
+
+
+ParallelStepper::~ParallelStepper()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_bShutdown = true;
+    }
+    m_cvStart.notify_all();
+
+    for (std::thread& worker : m_Workers)
+    {
+        if (worker.joinable())
+        {
+            worker.join();
+        }
+    }
+}
+
+
+void ParallelStepper::step(const std::vector<Pollinator*>& pollinators)
+{
+    assert(available());
+
+    // assign each pollinator to a tile according to its current position
+    for (std::vector<Pollinator*>& tile : m_TilePollinators)
+    {
+        tile.clear();
+    }
+
+    for (Pollinator* pPollinator : pollinators)
+    {
+        iPos ipos = Environment::getPatchCoordFromFloatPos(pPollinator->getPosition());
+        int tx = std::clamp(ipos.x / m_iTileSize, 0, m_iNumTilesX - 1);
+        int ty = std::clamp(ipos.y / m_iTileSize, 0, m_iNumTilesY - 1);
+        m_TilePollinators[tx + (m_iNumTilesX * ty)].push_back(pPollinator);
+    }
+
+    // now process the tiles in four checkerboard phases
+    for (int phase = 0; phase < 4; ++phase)
+    {
+        int px = phase % 2;
+        int py = phase / 2;
+
+        m_PhaseTiles.clear();
+        for (int ty = py; ty < m_iNumTilesY; ty += 2)
+        {
+            for (int tx = px; tx < m_iNumTilesX; tx += 2)
+            {
+                int idx = tx + (m_iNumTilesX * ty);
+                if (!m_TilePollinators[idx].empty())
+                {
+                    m_PhaseTiles.push_back(idx);
+                }
+            }
+        }
+
+        if (!m_PhaseTiles.empty())
+        {
+            runPhase();
+        }
+    }
+}
+
+
+// Process all tiles listed in m_PhaseTiles, sharing the work between the calling
+// thread and the worker threads, and return once they have all been processed.
+void ParallelStepper::runPhase()
+{
+    m_iNextPhaseTile = 0;
+
+    if (m_Workers.empty() || m_PhaseTiles.size() == 1)
+    {
+        processTiles();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_pException = nullptr;
+        m_iNumBusyWorkers = m_Workers.size();
+        ++m_iPhaseCounter;
+    }
+    m_cvStart.notify_all();
+
+    std::exception_ptr pMainException = nullptr;
+    try
+    {
+        processTiles();
+    }
+    catch (...)
+    {
+        pMainException = std::current_exception();
+    }
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_cvDone.wait(lock, [this]{ return m_iNumBusyWorkers == 0; });
+
+    if (pMainException)
+    {
+        std::rethrow_exception(pMainException);
+    }
+    if (m_pException)
+    {
+        std::rethrow_exception(m_pException);
+    }
+}
+
+
+// Repeatedly claim the next unprocessed tile of the current phase and step all of
+// its pollinators, until no tiles remain.
+void ParallelStepper::processTiles()
+{
+    std::size_t i;
+    while ((i = m_iNextPhaseTile.fetch_add(1)) < m_PhaseTiles.size())
+    {
+        for (Pollinator* pPollinator : m_TilePollinators[m_PhaseTiles[i]])
+        {
+            pPollinator->step();
+        }
+    }
+}
+
+
+void ParallelStepper::workerLoop(RngEngine rng)
+{
+    EvoBeeModel::m_sRngEngine = rng;
+
+    unsigned int lastPhase = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_cvStart.wait(lock, [this, lastPhase]{ return m_bShutdown || m_iPhaseCounter != lastPhase; });
+            if (m_bShutdown)
+            {
+                return;
+            }
+            lastPhase = m_iPhaseCounter;
+        }
+
+        std::exception_ptr pException = nullptr;
+        try
+        {
+            processTiles();
+        }
+        catch (...)
+        {
+            pException = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            if (pException && !m_pException)
+            {
+                m_pException = pException;
+            }
+            if (--m_iNumBusyWorkers == 0)
+            {
+                m_cvDone.notify_one();
+            }
+        }
+    }
+}
@@ -33,29 +33,6 @@ Patch::Patch(Environment* pEnv, int posIdx, MarkerPoint mp, float temp) :
 }
 
 
-// Add a plant to the patch based upon the given config, generating a brand new plant
-// in the process
-void Patch::addPlant(const PlantTypeConfig& typeConfig, const fPos& pos)
-{
-    m_FloweringPlants.emplace_back(typeConfig, pos, this);
-}
-
-
-// Add an existing plant to the patch.
-// A move constructor is used, so the instance of the plant passed in as a parameter
-// is wiped when the method is finished.
-void Patch::addPlant(FloweringPlant& plant)
-{
-    m_FloweringPlants.push_back(std::move(plant));
-}
-
-
-void Patch::killAllPlants()
-{
-    m_FloweringPlants.clear();
-}
-
-
 bool Patch::inReproRestrictionArea(const iPos& dest) const
 {
     // NB this method is currently unused??
@@ -0,0 +1,245 @@
+/**
+ * @file
+ *
+ * Implementation of the PollenStore class
+ */
+
+#include <random>
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+#include <cassert>
+#include "EvoBeeModel.h"
+#include "Checkpoint.h"
+#include "PollenStore.h"
+
+
+PollenStore::PollenStore() :
+    m_iNumGrains(0),
+    m_iNumVisits(0)
+{
+}
+
+
+void PollenStore::add(const Flower* pSource, unsigned int speciesId, int num)
+{
+    if (num > 0)
+    {
+        m_Cohorts.push_back({pSource, speciesId, m_iNumVisits, num});
+        m_iNumGrains += num;
+    }
+}
+
+
+// Cohorts are held in the order in which they were collected, so any whose grains
+// have exceeded the limit are all at the front of the store
+void PollenStore::removeGrainsWithLandingsOver(int maxLandings)
+{
+    auto itFirstKept = std::find_if(m_Cohorts.begin(),
+                                    m_Cohorts.end(),
+                                    [this, maxLandings](const PollenCohort& c) {return (m_iNumVisits - c.pickupVisit <= maxLandings);});
+
+    for (auto it = m_Cohorts.begin(); it != itFirstKept; ++it)
+    {
+        m_iNumGrains -= it->count;
+    }
+    m_Cohorts.erase(m_Cohorts.begin(), itFirstKept);
+}
+
+
+int PollenStore::removeRandomGrains(int num)
+{
+    num = std::min(num, m_iNumGrains);
+    if (num <= 0)
+    {
+        return 0;
+    }
+
+    if (num == m_iNumGrains)
+    {
+        m_Cohorts.clear();
+        m_iNumGrains = 0;
+        return num;
+    }
+
+    m_Weights.resize(m_Cohorts.size());
+    for (std::size_t i = 0; i < m_Cohorts.size(); ++i)
+    {
+        m_Weights[i] = m_Cohorts[i].count;
+    }
+
+    splitRandomGrains(num, m_iNumGrains);
+    for (std::size_t i = 0; i < m_Cohorts.size(); ++i)
+    {
+        m_Cohorts[i].count -= m_Weights[i];
+    }
+
+    m_iNumGrains -= num;
+    removeEmptyCohorts();
+    return num;
+}
+
+
+void PollenStore::clear()
+{
+    m_Cohorts.clear();
+    m_iNumGrains = 0;
+    m_iNumVisits = 0;
+}
+
+
+int PollenStore::getNumGrains(unsigned int speciesId) const
+{
+    int num = 0;
+    for (const PollenCohort& cohort : m_Cohorts)
+    {
+        if (cohort.speciesId == speciesId)
+        {
+            num += cohort.count;
+        }
+    }
+    return num;
+}
+
+
+void PollenStore::saveState(CheckpointWriter& writer) const
+{
+    writer.write(m_iNumVisits);
+    writer.write<std::uint64_t>(m_Cohorts.size());
+    for (const PollenCohort& cohort : m_Cohorts)
+    {
+        writer.writeFlowerHandle(cohort.pSource);
+        writer.write(cohort.speciesId);
+        writer.write(cohort.pickupVisit);
+        writer.write(cohort.count);
+    }
+}
+
+
+void PollenStore::loadState(CheckpointReader& reader)
+{
+    clear();
+    m_iNumVisits = reader.read<int>();
+    std::uint64_t numCohorts = reader.read<std::uint64_t>();
+    m_Cohorts.reserve(numCohorts);
+    for (std::uint64_t i = 0; i < numCohorts; ++i)
+    {
+        PollenCohort cohort;
+        cohort.pSource = reader.readFlowerHandle();
+        cohort.speciesId = reader.read<unsigned int>();
+        cohort.pickupVisit = reader.read<int>();
+        cohort.count = reader.read<int>();
+        m_Cohorts.push_back(cohort);
+        m_iNumGrains += cohort.count;
+    }
+}
+
+
+// The grains are split between the cohorts one cohort at a time: given that n grains
+// are still to be chosen from the remaining R eligible grains, the number chosen from a
+// cohort with w eligible grains follows a hypergeometric distribution with parameters
+// (n, w, R). This gives exactly the same distribution as choosing grains one by one.
+void PollenStore::splitRandomGrains(int num, int totalWeight)
+{
+    assert(num <= totalWeight);
+
+    int numLeft = num;
+    int weightLeft = totalWeight;
+    for (int& weight : m_Weights)
+    {
+        int w = weight;
+        weight = (numLeft > 0) ? sampleHypergeometric(numLeft, w, weightLeft) : 0;
+        numLeft -= weight;
+        weightLeft -= w;
+    }
+    assert(numLeft == 0);
+}
+
+
+// Sampling is by inversion of the cumulative distribution, visiting the possible values
+// outwards from the mode, so the expected number of values visited is of the order of the
+// distribution's standard deviation rather than its range
+int PollenStore::sampleHypergeometric(int numDraws, int numMarked, int populationSize)
+{
+    assert((numDraws <= populationSize) && (numMarked <= populationSize));
+
+    int lo = std::max(0, numDraws - (populationSize - numMarked));
+    int hi = std::min(numDraws, numMarked);
+    if (lo == hi)
+    {
+        return lo;
+    }
+
+    const double n = numDraws;
+    const double K = numMarked;
+    const double N = populationSize;
+
+    auto logChoose = [](double a, double b) {
+        return std::lgamma(a + 1.0) - std::lgamma(b + 1.0) - std::lgamma(a - b + 1.0);
+    };
+
+    // ratio of the probability of value k+1 to that of value k
+    auto ratioUp = [n, K, N](int k) {
+        return ((K - k) * (n - k)) / ((k + 1.0) * (N - K - n + k + 1.0));
+    };
+
+    int mode = (int)(((n + 1.0) * (K + 1.0)) / (N + 2.0));
+    mode = std::max(lo, std::min(hi, mode));
+    double pMode = std::exp(logChoose(K, mode) + logChoose(N - K, n - mode) - logChoose(N, n));
+
+    double u = EvoBeeModel::m_sUniformProbDistrib(EvoBeeModel::m_sRngEngine);
+    double cumulative = pMode;
+    if (u < cumulative)
+    {
+        return mode;
+    }
+
+    int left = mode;        // lowest value visited so far
+    int right = mode;       // highest value visited so far
+    double pLeft = pMode;   // probability of value left
+    double pRight = pMode;  // probability of value right
+    while ((left > lo) || (right < hi))
+    {
+        // extend the visited range by whichever neighbouring value is more likely
+        double pNextLeft = (left > lo) ? pLeft / ratioUp(left - 1) : -1.0;
+        double pNextRight = (right < hi) ? pRight * ratioUp(right) : -1.0;
+        if (pNextRight >= pNextLeft)
+        {
+            ++right;
+            pRight = pNextRight;
+            cumulative += pRight;
+            if (u < cumulative)
+            {
+                return right;
+            }
+        }
+        else
+        {
+            --left;
+            pLeft = pNextLeft;
+            cumulative += pLeft;
+            if (u < cumulative)
+            {
+                return left;
+            }
+        }
+    }
+
+    // only reached if rounding errors leave the total probability slightly below u
+    return mode;
+}
+
+
+void PollenStore::shuffleLastGrains(PollenVector& pollen, int num)
+{
+    std::shuffle(pollen.end() - num, pollen.end(), EvoBeeModel::m_sRngEngine);
+}
+
+
+void PollenStore::removeEmptyCohorts()
+{
+    m_Cohorts.erase(std::remove_if(m_Cohorts.begin(),
+                                   m_Cohorts.end(),
+                                   [](const PollenCohort& c) {return (c.count == 0);}),
+                    m_Cohorts.end());
+}
@@ -8,15 +8,17 @@
 #include <random>
 #include <cassert>
 #include <string>
-#include <sstream>
 #include <iomanip>
 #include <algorithm>
+#include <limits>
 #include <iostream>
 #include "tools.h"
 #include "ModelParams.h"
 #include "EvoBeeModel.h"
 #include "PollinatorConfig.h"
 #include "Pollinator.h"
+#include "LogSnapshot.h"
+#include "Checkpoint.h"
 
 // Initialise static data members
 unsigned int Pollinator::m_sNextFreeId = 1;
@@ -33,12 +35,14 @@ Pollinator::Pollinator(const PollinatorConfig& pc, AbstractHive* pHive) :
     m_pEnv(nullptr),
     m_pModel(nullptr),
     m_State(PollinatorState::UNINITIATED),
+    m_iNumFlowerlessSteps(0),
     m_iNumFlowersVisitedInBout(0),
     m_iCollectedNectar(0),
     m_ConstancyType(pc.constancyType),
     m_fConstancyParam(pc.constancyParam),
     m_PreviousLandingSpeciesId(0),
     m_uiVisitedFlowerMemorySize(pc.visitedFlowerMemorySize),
+    m_RecentlyVisitedFlowers(pc.visitedFlowerMemorySize),
     m_ForagingStrategy(pc.foragingStrategy),
     m_LearningStrategy(pc.learningStrategy),
     m_iPresetPrefVisDataID(pc.presetPrefVisDataID),
@@ -92,6 +96,7 @@ Pollinator::Pollinator(const Pollinator& other) :
     m_pEnv(other.m_pEnv),
     m_pModel(other.m_pModel),
     m_State(other.m_State),
+    m_iNumFlowerlessSteps(other.m_iNumFlowerlessSteps),
     m_iNumFlowersVisitedInBout(other.m_iNumFlowersVisitedInBout),
     m_iCollectedNectar(other.m_iCollectedNectar),
     m_PollenStore(other.m_PollenStore),
@@ -138,6 +143,7 @@ Pollinator::Pollinator(Pollinator&& other) noexcept :
     m_pEnv(other.m_pEnv),
     m_pModel(other.m_pModel),
     m_State(other.m_State),
+    m_iNumFlowerlessSteps(other.m_iNumFlowerlessSteps),
     m_iNumFlowersVisitedInBout(other.m_iNumFlowersVisitedInBout),
     m_iCollectedNectar(other.m_iCollectedNectar),
     m_PollenStore(std::move(other.m_PollenStore)),
@@ -203,6 +209,8 @@ void Pollinator::reset()
     m_iNumFlowersVisitedInBout = 0;
     m_iCollectedNectar = 0;
     m_PreviousLandingSpeciesId = 0;
+    m_LatestAction = PollinatorLatestAction(); // (don't keep pointers to the previous generation's flowers)
+    m_iNumFlowerlessSteps = 0;
     //m_iPresetPrefVisDataID = -1;
     //m_PresetPrefVisDataPtr = nullptr; // this is constant between generations, so only need to set it once in Hymenoptera constructor
     //m_TargetMP = NO_MARKER_POINT;
@@ -212,6 +220,8 @@ void Pollinator::reset()
     {
         perfInfo.second.reset();
     }
+    EvoBeeModel::m_sRngEngine.setStream(RngStreamPurpose::POLLINATOR_RESET,
+                                        m_pModel->getGenNumber(), 0, m_id);
     resetToStartPosition();
 }
 
@@ -386,6 +396,11 @@ void Pollinator::repositionInArea(fPos delta, float minx, float miny, float maxx
 //
 void Pollinator::step()
 {
+    // each step of each pollinator draws from its own random number stream
+    unsigned int stepnum = m_pModel->getStepNumber();
+    EvoBeeModel::m_sRngEngine.setStream(RngStreamPurpose::POLLINATOR_STEP,
+                                        m_pModel->getGenNumber(), stepnum, m_id);
+
     switch (m_State)
     {
         case (PollinatorState::UNINITIATED):
@@ -395,31 +410,74 @@ void Pollinator::step()
         }
         case (PollinatorState::FORAGING):
         {
-            switch (m_ForagingStrategy)
+            if (m_iNumFlowerlessSteps > 0)
+            {
+                // we already know that there are no flowers within range in this step
+                --m_iNumFlowerlessSteps;
+                forageFlowerless();
+            }
+            else
             {
-                case (PollinatorForagingStrategy::RANDOM):
+                switch (m_ForagingStrategy)
                 {
-                    forageRandom();
-                    break;
+                    case (PollinatorForagingStrategy::RANDOM):
+                    {
+                        forageRandom();
+                        break;
+                    }
+                    case (PollinatorForagingStrategy::NEAREST_FLOWER):
+                    {
+                        forageNearestFlower();
+                        break;
+                    }
+                    case (PollinatorForagingStrategy::RANDOM_FLOWER):
+                    {
+                        forageRandomFlower();
+                        break;
+                    }
+                    case (PollinatorForagingStrategy::RANDOM_GLOBAL):
+                    {
+                        forageRandomGlobal();
+                        break;
+                    }
+                    default:
+                    {
+                        throw std::runtime_error("Unknown pollinator foraging strategy encountered");
+                    }
                 }
-                case (PollinatorForagingStrategy::NEAREST_FLOWER):
+
+                // if the search came up empty, see how many of the following steps can
+                // be fast-forwarded because the pollinator is too far from any flower
+                if (ModelParams::pollinatorFastForward() &&
+                    (m_ForagingStrategy != PollinatorForagingStrategy::RANDOM_GLOBAL) &&
+                    (m_LatestAction.stepnum == (int)stepnum) &&
+                    (m_LatestAction.status == PollinatorCurrentStatus::NO_FLOWER_SEEN))
                 {
-                    forageNearestFlower();
-                    break;
+                    m_iNumFlowerlessSteps = countFlowerlessSteps();
                 }
-                case (PollinatorForagingStrategy::RANDOM_FLOWER):
+            }
+
+            // record the outcome of this step. (If the latest action was not updated in this
+            // step, the pollinator was unable to find any flower to consider.)
+            ++m_StepCounts.numSteps;
+            PollinatorCurrentStatus status = (m_LatestAction.stepnum == (int)stepnum) ?
+                m_LatestAction.status : PollinatorCurrentStatus::NO_FLOWER_SEEN;
+            switch (status)
+            {
+                case (PollinatorCurrentStatus::ON_FLOWER):
                 {
-                    forageRandomFlower();
+                    ++m_StepCounts.numFlowerVisits;
                     break;
                 }
-                case (PollinatorForagingStrategy::RANDOM_GLOBAL):
+                case (PollinatorCurrentStatus::DECLINED_FLOWER):
                 {
-                    forageRandomGlobal();
+                    ++m_StepCounts.numLandingsDeclined;
                     break;
                 }
-                default:
+                case (PollinatorCurrentStatus::NO_FLOWER_SEEN):
                 {
-                    throw std::runtime_error("Unknown pollinator foraging strategy encountered");
+                    ++m_StepCounts.numNoFlowerSeen;
+                    break;
                 }
             }
         }
@@ -436,6 +494,104 @@ void Pollinator::step()
 }
 
 
+void Pollinator::transferStepCounts(PollinatorStepCounts& totals)
+{
+    totals += m_StepCounts;
+    m_StepCounts.reset();
+}
+
+
+// The reach of a single step is bounded by the length of the move (if any) plus the
+// radius of the subsequent flower search. A Levy step is at most 20 x m_fStepLength
+// (see moveLevy()), and the local flower searches are restricted to a radius of 1.0.
+float Pollinator::getMaxStepReach() const
+{
+    if (m_ForagingStrategy == PollinatorForagingStrategy::RANDOM_GLOBAL)
+    {
+        return -1.0;
+    }
+
+    return getMaxMoveLength() + 1.0;
+}
+
+
+float Pollinator::getMaxMoveLength() const
+{
+    return (m_StepType == PollinatorStepType::LEVY) ? (20.0 * m_fStepLength) : m_fStepLength;
+}
+
+
+// The flower searches only look at the Moore neighbourhood of the pollinator's current
+// patch, so a search is certain to find nothing if the pollinator is at least two patches
+// (in Chebyshev distance) away from the nearest patch that holds a flower. Moving a
+// distance s changes each of the pollinator's patch coordinates by at most floor(s)+1,
+// and reflections at the edge of its allowed area only ever shorten the move, so after
+// n moves the pollinator is still out of range of every flower as long as n * maxMove
+// is less than the patch distance minus 2. (Flowers that the pollinator has recently
+// visited, or would fail to detect, only make it less likely to find anything.)
+int Pollinator::countFlowerlessSteps() const
+{
+    int patchDist = m_pEnv->getPatchFlowerDistance(m_Position);
+    if (patchDist < 2)
+    {
+        return 0;
+    }
+
+    // the largest number of moves that are guaranteed to keep the pollinator out of
+    // range (with a small margin to allow for rounding errors in the moves)
+    int maxMoves = std::numeric_limits<int>::max() / 2;
+    float maxMove = getMaxMoveLength();
+    float range = (float)(patchDist - 2) - 0.01f;
+    if (maxMove > EvoBee::SMALL_FLOAT_NUMBER)
+    {
+        maxMoves = std::max(0, (int)std::min(std::ceil(range / maxMove) - 1.0f, (float)maxMoves));
+    }
+
+    // forageRandom() moves before it searches, whereas the other strategies search first
+    // and then move, so their search in the next step is made from the current position
+    if (m_ForagingStrategy == PollinatorForagingStrategy::RANDOM)
+    {
+        return maxMoves;
+    }
+
+    return maxMoves + 1;
+}
+
+
+// A step of any of the local foraging strategies in which the flower search finds
+// nothing consists of a random move, followed by losing pollen to the air. The random
+// numbers are drawn in the same order as in the strategy's own method, so the outcome
+// is exactly the same as if the search had been made.
+void Pollinator::forageFlowerless()
+{
+    unsigned int stepnum = m_pModel->getStepNumber();
+
+    if (m_ForagingStrategy == PollinatorForagingStrategy::RANDOM_FLOWER)
+    {
+        moveRandom();
+    }
+    else
+    {
+        switch (m_StepType) {
+            case PollinatorStepType::CONSTANT: {
+                moveRandom();
+                break;
+            }
+            case PollinatorStepType::LEVY: {
+                moveLevy();
+                break;
+            }
+            default: {
+                throw std::runtime_error("Pollinator::forageFlowerless() encountered unrecognised step type. Aborting.");
+            }
+        }
+    }
+
+    m_LatestAction.update(stepnum, PollinatorCurrentStatus::NO_FLOWER_SEEN, nullptr, 0);
+    losePollenToAir(m_iPollenLossInAir);
+}
+
+
 // The Random foraging strategy involves first making a move in a random direction, then looking for
 // a nearby flower. If a flower is found, the pollinator then moves to that if it is a visit candidate.
 void Pollinator::forageRandom()
@@ -504,13 +660,9 @@ void Pollinator::forageRandomGlobal()
             // pick a random flower
             std::uniform_int_distribution<unsigned int> dist(0, allFlowerPtrVec.size()-1);
             pFlower = allFlowerPtrVec.at(dist(EvoBeeModel::m_sRngEngine));
-            unsigned int flowerID = pFlower->getId();
 
             // check whether it is on the recently visited list
-            if (std::find_if(m_RecentlyVisitedFlowers.begin(),
-                             m_RecentlyVisitedFlowers.end(),
-                             [flowerID](Flower* pOtherFlower){return (pOtherFlower->getId() == flowerID);})
-                != m_RecentlyVisitedFlowers.end())
+            if (m_RecentlyVisitedFlowers.contains(pFlower))
             {
                 // if so, reset pFlower to nullptr
                 pFlower = nullptr;
@@ -762,25 +914,7 @@ int Pollinator::visitFlower(Flower* pFlower)
 
     // update record of most recent landing to this one
     m_PreviousLandingSpeciesId = pFlower->getSpeciesId();
-    if (m_uiVisitedFlowerMemorySize == 1)
-    {
-        if (m_RecentlyVisitedFlowers.empty())
-        {
-            m_RecentlyVisitedFlowers.push_back(pFlower);
-        }
-        else
-        {
-            m_RecentlyVisitedFlowers[0] = pFlower;
-        }
-    }
-    else if (m_uiVisitedFlowerMemorySize > 1)
-    {
-        m_RecentlyVisitedFlowers.push_back(pFlower);
-        if (m_RecentlyVisitedFlowers.size() > m_uiVisitedFlowerMemorySize)
-        {
-            m_RecentlyVisitedFlowers.erase(m_RecentlyVisitedFlowers.begin());
-        }
-    }
+    m_RecentlyVisitedFlowers.remember(pFlower); // (forgets the oldest flower if memory is full)
 
     // update flower's count of number of landings
     pFlower->updatePollinatorLandingCount();
@@ -842,11 +976,11 @@ void Pollinator::moveLevy()
 }
 
 // for each Pollen grain in the store, update its landing count
+// (landing counts are implicit in the store's visit counter, so this is a
+// constant time operation)
 void Pollinator::updatePollenLandingCount()
 {
-    std::for_each( m_PollenStore.begin(),
-                   m_PollenStore.end(),
-                   [](Pollen& p){p.numLandings++;} );
+    m_PollenStore.recordLanding();
 }
 
 
@@ -857,12 +991,7 @@ void Pollinator::removeOldCarryoverPollen()
     // that no limit is to be imposed on carryover number of visits
     if (m_iPollenCarryoverNumVisits > 0)
     {
-        m_PollenStore.erase(
-            std::remove_if( m_PollenStore.begin(),
-                            m_PollenStore.end(),
-                            [this](Pollen& p) {return (p.numLandings > m_iPollenCarryoverNumVisits);} ),
-            m_PollenStore.end()
-        );
+        m_PollenStore.removeGrainsWithLandingsOver(m_iPollenCarryoverNumVisits);
     }
 }
 
@@ -901,31 +1030,22 @@ int Pollinator::depositPollenOnStigma(Flower* pFlower)
 
 
 // Collect pollen from flower if available, and add to our store
-// If any pollen is added, the contents of the store is shuffled so that
-// subsequent operations that act of randomly chosen grains from the store
-// can simply and efficiently pick off grains from the end of the store.
 // If the store's maxium capacity is exceeded, some random grains are
-// removed to bring it down to the maximum allowed size.
+// removed to bring it down to the maximum allowed size. (The store picks
+// grains at random whenever it removes them, so there is no need to
+// shuffle it when new pollen arrives.)
 //
 void Pollinator::collectPollenFromAnther(Flower* pFlower)
 {
     // transfer anther pollen from flower to our store
-    int num = pFlower->transferAntherPollenToPollinator(m_PollenStore);
-
-    // if some new grains have been added, shuffle the whole store now
-    // so that subsequent removals of pollen happen in a random order
-    if (num > 0)
-    {
-        std::shuffle(m_PollenStore.begin(), m_PollenStore.end(), EvoBeeModel::m_sRngEngine);
-    }
+    pFlower->transferAntherPollenToPollinator(m_PollenStore);
 
-    // finally, if the number of grains in our store now exceeds the
-    // maximum capacity, delete some. As we've just shuffled the store,
-    // we can just remove the required number from the end of the store
+    // if the number of grains in our store now exceeds the
+    // maximum capacity, delete some at random
     int xs = m_PollenStore.size() - m_iMaxPollenCapacity;
     if (xs > 0)
     {
-        m_PollenStore.erase(m_PollenStore.end()-xs, m_PollenStore.end());
+        m_PollenStore.removeRandomGrains(xs);
     }
 }
 
@@ -942,9 +1062,7 @@ int Pollinator::collectNectar(Flower* pFlower)
 // Lose the specified amount of pollen to the air
 int Pollinator::losePollenToAir(int num)
 {
-    num = std::min(num, (int)m_PollenStore.size());
-    m_PollenStore.erase(m_PollenStore.end()-num, m_PollenStore.end());
-    return num;
+    return m_PollenStore.removeRandomGrains(num);
 }
 
 
@@ -952,39 +1070,145 @@ int Pollinator::losePollenToAir(int num)
 // Note, if you are looking at this code to understand the contents of a log file,
 // remember that the Pollinator class is a virtual base class. Classes that
 // inherit from Pollinator may append additional information to this string,
-// e.g. see Hymenoptera::getStateString().
+// e.g. see Hymenoptera::captureState().
 std::string Pollinator::getStateString() const
 {
-    std::stringstream ssState;
+    PollinatorStatesSnapshot snapshot('Q', 0, 0);
+    captureState(snapshot);
+    std::string strState;
+    snapshot.writeRecord(strState, snapshot.records.back());
+    return strState;
+}
 
-    ssState << std::fixed << std::setprecision(3) << getTypeName() << ","
-        << m_id << "," << m_Position.x << "," << m_Position.y << "," << m_fHeading
-        << "," << m_iNumFlowersVisitedInBout
-        << "," << m_LatestAction.stepnum << ",";
 
-    switch (m_LatestAction.status) {
-    case PollinatorCurrentStatus::ON_FLOWER: {
+// Record the pollinator's current state for logging purposes. The format in which
+// the state is written out is defined by PollinatorStatesSnapshot::writeRecord().
+void Pollinator::captureState(PollinatorStatesSnapshot& snapshot) const
+{
+    PollinatorStateRecord rec;
+    rec.pTypeName = &getTypeName();
+    rec.id = m_id;
+    rec.x = m_Position.x;
+    rec.y = m_Position.y;
+    rec.heading = m_fHeading;
+    rec.numFlowersVisitedInBout = m_iNumFlowersVisitedInBout;
+    rec.latestActionStepnum = m_LatestAction.stepnum;
+    rec.latestActionStatus = m_LatestAction.status;
+    rec.latestActionFlowerLambda = 0;
+    if (m_LatestAction.status != PollinatorCurrentStatus::NO_FLOWER_SEEN)
+    {
         assert(m_LatestAction.pFlower != nullptr);
-        ssState << m_LatestAction.pFlower->getCharacteristicWavelength() << "," << m_LatestAction.rewardReceived << ","
-            << (m_LatestAction.bJudgedToMatchTarget ? "T" : "F");
-        break;
+        rec.latestActionFlowerLambda = m_LatestAction.pFlower->getCharacteristicWavelength();
     }
-    case PollinatorCurrentStatus::DECLINED_FLOWER: {
-        assert(m_LatestAction.pFlower != nullptr);
-        ssState << m_LatestAction.pFlower->getCharacteristicWavelength() << ",-1,"
-            << (m_LatestAction.bJudgedToMatchTarget ? "T" : "F");
-        break;
+    rec.latestActionReward = m_LatestAction.rewardReceived;
+    rec.latestActionJudgedToMatchTarget = m_LatestAction.bJudgedToMatchTarget;
+    rec.hasVisualState = false;
+    rec.targetWavelength = 0;
+    rec.prefsBegin = rec.prefsEnd = snapshot.prefs.size();
+    snapshot.records.push_back(rec);
+}
+
+
+// Write the pollinator's dynamic state to a checkpoint. Its constant parameters
+// are not saved, as they are recreated from the config when the model is built.
+// Remember that subclasses may append additional state (see Hymenoptera::saveState()).
+void Pollinator::saveState(CheckpointWriter& writer) const
+{
+    writer.write(m_id);
+    writer.write(m_Position.x);
+    writer.write(m_Position.y);
+    writer.write(m_fHeading);
+    writer.write(m_State);
+
+    writer.write(m_LatestAction.stepnum);
+    writer.write(m_LatestAction.status);
+    writer.writeFlowerHandle(m_LatestAction.pFlower);
+    writer.write(m_LatestAction.rewardReceived);
+    writer.write(m_LatestAction.bJudgedToMatchTarget);
+
+    writer.write(m_iNumFlowersVisitedInBout);
+    writer.write(m_iCollectedNectar);
+
+    m_PollenStore.saveState(writer);
+
+    writer.write(m_MovementAreaTopLeft.x);
+    writer.write(m_MovementAreaTopLeft.y);
+    writer.write(m_MovementAreaBottomRight.x);
+    writer.write(m_MovementAreaBottomRight.y);
+
+    writer.write(m_TargetReflectance.getMarkerPoint());
+    writer.writeVisDataHandle(m_TargetReflectance.getVisDataPtr());
+
+    writer.write(m_PreviousLandingSpeciesId);
+
+    writer.write<std::uint64_t>(m_RecentlyVisitedFlowers.size());
+    for (const Flower* pFlower : m_RecentlyVisitedFlowers)
+    {
+        writer.writeFlowerHandle(pFlower);
     }
-    case PollinatorCurrentStatus::NO_FLOWER_SEEN: {
-        ssState << "0,-2,F";
-        break;
+
+    writer.write<std::uint64_t>(m_PerformanceInfoMap.size());
+    for (auto& perfInfo : m_PerformanceInfoMap)
+    {
+        writer.write(perfInfo.first);
+        writer.write(perfInfo.second.numLandings);
+        writer.write(perfInfo.second.numPollinations);
     }
-    default: {
-        throw std::runtime_error("Unknown PollinatorCurrentStatus value in Pollinator::getStateString(). Aborting!");
+}
+
+
+void Pollinator::loadState(CheckpointReader& reader)
+{
+    if (reader.read<unsigned int>() != m_id)
+    {
+        throw std::runtime_error("Checkpoint pollinator ids do not match those of the current configuration");
     }
+
+    m_Position.x = reader.read<float>();
+    m_Position.y = reader.read<float>();
+    m_fHeading = reader.read<float>();
+    m_State = reader.read<PollinatorState>();
+
+    m_LatestAction.stepnum = reader.read<int>();
+    m_LatestAction.status = reader.read<PollinatorCurrentStatus>();
+    m_LatestAction.pFlower = reader.readFlowerHandle();
+    m_LatestAction.rewardReceived = reader.read<int>();
+    m_LatestAction.bJudgedToMatchTarget = reader.read<bool>();
+    m_iNumFlowerlessSteps = 0;
+
+    m_iNumFlowersVisitedInBout = reader.read<int>();
+    m_iCollectedNectar = reader.read<int>();
+
+    m_PollenStore.loadState(reader);
+
+    m_MovementAreaTopLeft.x = reader.read<int>();
+    m_MovementAreaTopLeft.y = reader.read<int>();
+    m_MovementAreaBottomRight.x = reader.read<int>();
+    m_MovementAreaBottomRight.y = reader.read<int>();
+
+    m_TargetReflectance.setMarkerPoint(reader.read<MarkerPoint>());
+    m_TargetReflectance.setVisDataPtr(reader.readVisDataHandle());
+
+    m_PreviousLandingSpeciesId = reader.read<unsigned int>();
+
+    // replaying the remembered flowers from oldest to newest leaves the memory
+    // in exactly the state in which it was saved
+    m_RecentlyVisitedFlowers.clear();
+    std::uint64_t numVisited = reader.read<std::uint64_t>();
+    for (std::uint64_t i = 0; i < numVisited; ++i)
+    {
+        m_RecentlyVisitedFlowers.remember(reader.readFlowerHandle());
     }
 
-    return ssState.str();
+    m_PerformanceInfoMap.clear();
+    std::uint64_t numPerfInfo = reader.read<std::uint64_t>();
+    for (std::uint64_t i = 0; i < numPerfInfo; ++i)
+    {
+        unsigned int speciesId = reader.read<unsigned int>();
+        PollinatorPerformanceInfo& perfInfo = m_PerformanceInfoMap[speciesId];
+        perfInfo.numLandings = reader.read<int>();
+        perfInfo.numPollinations = reader.read<int>();
+    }
 }
 
 
@@ -996,9 +1220,7 @@ const std::string& Pollinator::getTypeName() const
 
 int Pollinator::getNumPollenGrainsInStore(unsigned int speciesId) const
 {
-    return std::count_if( m_PollenStore.begin(),
-                          m_PollenStore.end(),
-                          [speciesId](const Pollen& p) {return (p.speciesId == speciesId);} );
+    return m_PollenStore.getNumGrains(speciesId);
 }
 
 
@@ -1016,8 +1238,6 @@ float Pollinator::confidenceMatchesTarget(const ReflectanceInfo& stimulus) const
     const float minConfidence = 0.05;
     */
 
-    float confidence = m_sVisMatchMinConfidence;
-
     float hexDistance;
 
     switch (ModelParams::getColourSystem())
@@ -1042,6 +1262,14 @@ float Pollinator::confidenceMatchesTarget(const ReflectanceInfo& stimulus) const
         }
     }
 
+    return getVisMatchConfidence(hexDistance);
+}
+
+
+float Pollinator::getVisMatchConfidence(float hexDistance)
+{
+    float confidence = m_sVisMatchMinConfidence;
+
     if (hexDistance <= m_sVisMatchMinHexDistance)
     {
         confidence = m_sVisMatchMaxConfidence;
@@ -0,0 +1,124 @@
+/**
+ * @file
+ *
+ * Implementation of the RngEngine class
+ */
+
+#include <sstream>
+#include <stdexcept>
+#include "Checkpoint.h"
+#include "RngEngine.h"
+
+namespace
+{
+    // Philox4x32 multipliers and Weyl sequence key increments
+    constexpr std::uint32_t PHILOX_M0 = 0xD2511F53;
+    constexpr std::uint32_t PHILOX_M1 = 0xCD9E8D57;
+    constexpr std::uint32_t PHILOX_W0 = 0x9E3779B9;
+    constexpr std::uint32_t PHILOX_W1 = 0xBB67AE85;
+    constexpr int PHILOX_ROUNDS = 10;
+}
+
+
+RngEngine::RngEngine() :
+    m_Type(RngType::MT19937),
+    m_Key{0, 0},
+    m_StreamKey{0, 0},
+    m_Counter{0, 0, 0, 0},
+    m_Buffer{0, 0, 0, 0},
+    m_iBufferPos(m_Buffer.size())
+{
+}
+
+
+void RngEngine::seed(std::seed_seq& seq)
+{
+    m_MtEngine.seed(seq);
+
+    // Derive the Philox key from the same seed sequence. Note that seed_seq::generate
+    // is deterministic and does not alter the sequence, so this does not affect the
+    // state of the Mersenne Twister engine seeded above.
+    seq.generate(m_Key.begin(), m_Key.end());
+
+    if (m_Type == RngType::PHILOX)
+    {
+        setStream(RngStreamPurpose::GLOBAL);
+    }
+}
+
+
+// Generate the next block of four 32-bit outputs using Philox4x32-10, as described
+// in Salmon et al. (2011) "Parallel random numbers: as easy as 1, 2, 3".
+// The first counter word is used as the block index within the current stream.
+void RngEngine::generateBlock()
+{
+    std::uint32_t c0 = m_Counter[0];
+    std::uint32_t c1 = m_Counter[1];
+    std::uint32_t c2 = m_Counter[2];
+    std::uint32_t c3 = m_Counter[3];
+    std::uint32_t k0 = m_StreamKey[0];
+    std::uint32_t k1 = m_StreamKey[1];
+
+    for (int round = 0; round < PHILOX_ROUNDS; ++round)
+    {
+        std::uint64_t p0 = static_cast<std::uint64_t>(PHILOX_M0) * c0;
+        std::uint64_t p1 = static_cast<std::uint64_t>(PHILOX_M1) * c2;
+
+        std::uint32_t n0 = static_cast<std::uint32_t>(p1 >> 32) ^ c1 ^ k0;
+        std::uint32_t n1 = static_cast<std::uint32_t>(p1);
+        std::uint32_t n2 = static_cast<std::uint32_t>(p0 >> 32) ^ c3 ^ k1;
+        std::uint32_t n3 = static_cast<std::uint32_t>(p0);
+
+        c0 = n0; c1 = n1; c2 = n2; c3 = n3;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+
+    m_Buffer = {c0, c1, c2, c3};
+    m_iBufferPos = 0;
+    ++m_Counter[0];
+}
+
+
+// The Mersenne Twister state is saved in its standard textual representation,
+// which fully determines the rest of its sequence
+void RngEngine::saveState(CheckpointWriter& writer) const
+{
+    writer.write<RngType>(m_Type);
+
+    std::stringstream mtState;
+    mtState << m_MtEngine;
+    writer.writeString(mtState.str());
+
+    writer.write(m_Key);
+    writer.write(m_StreamKey);
+    writer.write(m_Counter);
+    writer.write(m_Buffer);
+    writer.write<std::uint64_t>(m_iBufferPos);
+}
+
+
+void RngEngine::loadState(CheckpointReader& reader)
+{
+    if (reader.read<RngType>() != m_Type)
+    {
+        throw std::runtime_error("Checkpoint was written with a different rng-type");
+    }
+
+    std::stringstream mtState(reader.readString());
+    mtState >> m_MtEngine;
+    if (!mtState)
+    {
+        throw std::runtime_error("Invalid RNG state in checkpoint");
+    }
+
+    m_Key = reader.read<std::array<std::uint32_t, 2>>();
+    m_StreamKey = reader.read<std::array<std::uint32_t, 2>>();
+    m_Counter = reader.read<std::array<std::uint32_t, 4>>();
+    m_Buffer = reader.read<std::array<std::uint32_t, 4>>();
+    m_iBufferPos = reader.read<std::uint64_t>();
+    if (m_iBufferPos > m_Buffer.size())
+    {
+        throw std::runtime_error("Invalid RNG state in checkpoint");
+    }
+}
@@ -174,7 +174,7 @@ bool Visualiser::update()
         {
             if (p.hasFloweringPlants())
             {
-                PlantVector & fplants = p.getFloweringPlants();
+                PlantRange fplants = p.getFloweringPlants();
                 for (FloweringPlant & fplant : fplants)
                 {
                     ///@todo deal with multiple flowers on a plant?
@@ -0,0 +1,132 @@
+/**
+ * @file
+ *
+ * Implementation of the WeightedSampler class
+ */
+
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include "EvoBeeModel.h"
+#include "WeightedSampler.h"
+
+
+WeightedSampler::WeightedSampler(std::vector<unsigned int> weights) :
+    m_Weights(std::move(weights)),
+    m_iRemainingWeight(0),
+    m_iTableWeight(0)
+{
+    for (unsigned int w : m_Weights)
+    {
+        m_iRemainingWeight += w;
+    }
+
+    buildAliasTable();
+}
+
+
+// A proposal is made by picking one of the n*W slots of the table uniformly at random
+// (where W is the total weight of the table), which selects item i with probability
+// w[i]/W. This is then accepted with probability (remaining weight)/w[i], so overall each
+// attempt draws item i with probability (remaining weight of i)/W. At least half of the
+// table's weight remains, so on average fewer than two attempts are needed.
+std::size_t WeightedSampler::draw()
+{
+    if (empty())
+    {
+        throw std::runtime_error("Attempt to draw from an empty WeightedSampler");
+    }
+
+    if ((2 * m_iRemainingWeight) <= m_iTableWeight)
+    {
+        buildAliasTable();
+    }
+
+    std::uniform_int_distribution<std::uint64_t> slotDist(0, (m_TableItems.size() * m_iTableWeight) - 1);
+
+    while (true)
+    {
+        std::uint64_t slot = slotDist(EvoBeeModel::m_sRngEngine);
+        std::size_t col = (std::size_t)(slot / m_iTableWeight);
+        std::size_t entry = ((slot % m_iTableWeight) < m_Thresholds[col]) ? col : m_Aliases[col];
+
+        std::size_t item = m_TableItems[entry];
+        unsigned int remaining = m_Weights[item];
+        unsigned int tableWeight = m_TableWeights[entry];
+
+        bool accept = (remaining == tableWeight);
+        if ((!accept) && (remaining > 0))
+        {
+            std::uniform_int_distribution<unsigned int> acceptDist(0, tableWeight - 1);
+            accept = (acceptDist(EvoBeeModel::m_sRngEngine) < remaining);
+        }
+
+        if (accept)
+        {
+            --m_Weights[item];
+            --m_iRemainingWeight;
+            return item;
+        }
+    }
+}
+
+
+// Vose's version of the alias method, using integer arithmetic throughout so that the
+// probabilities are exact. Each entry's weight is scaled by the number of entries n, so
+// that the scaled weights sum to n*W, and each column of the table holds W slots.
+void WeightedSampler::buildAliasTable()
+{
+    m_TableItems.clear();
+    m_TableWeights.clear();
+    for (std::size_t i = 0; i < m_Weights.size(); ++i)
+    {
+        if (m_Weights[i] > 0)
+        {
+            m_TableItems.push_back(i);
+            m_TableWeights.push_back(m_Weights[i]);
+        }
+    }
+    m_iTableWeight = m_iRemainingWeight;
+
+    std::size_t n = m_TableItems.size();
+    m_Thresholds.assign(n, m_iTableWeight);
+    m_Aliases.resize(n);
+
+    std::vector<std::uint64_t> scaled(n);
+    std::vector<std::size_t> small;
+    std::vector<std::size_t> large;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        m_Aliases[i] = i;
+        scaled[i] = (std::uint64_t)m_TableWeights[i] * n;
+        if (scaled[i] < m_iTableWeight)
+        {
+            small.push_back(i);
+        }
+        else
+        {
+            large.push_back(i);
+        }
+    }
+
+    while (!small.empty() && !large.empty())
+    {
+        std::size_t s = small.back();
+        small.pop_back();
+        std::size_t l = large.back();
+
+        // column s is topped up with slots belonging to entry l
+        m_Thresholds[s] = scaled[s];
+        m_Aliases[s] = l;
+        scaled[l] -= (m_iTableWeight - scaled[s]);
+
+        if (scaled[l] < m_iTableWeight)
+        {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+
+    // any entries left over fill their own columns exactly (m_Thresholds is already
+    // set to m_iTableWeight for these)
+}
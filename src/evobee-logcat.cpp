@@ -0,0 +1,191 @@
+/**
+ * @file
+ *
+ * Implementation of the evobee-logcat tool. This converts one or more binary log files
+ * (written by EvoBee when the log-format config option is set to "binary") into the
+ * standard comma separated text log format, exactly as it would have been written by
+ * EvoBee with log-format set to "text".
+ *
+ * Usage: evobee-logcat [-o OUTFILE] [-f FLAGS] LOGFILE...
+ */
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdexcept>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <boost/program_options.hpp>
+#include "evobeeConfig.h"
+#include "LogBinary.h"
+#include "LogSnapshot.h"
+
+namespace po = boost::program_options;
+
+
+// The MappedFile class maps a file read-only into memory for the lifetime of the object
+class MappedFile {
+public:
+    MappedFile(const std::string& path) : m_pData(nullptr), m_iSize(0)
+    {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw std::runtime_error("Unable to open log file " + path);
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+        {
+            close(fd);
+            throw std::runtime_error("Unable to read log file " + path);
+        }
+        m_iSize = st.st_size;
+
+        if (m_iSize > 0)
+        {
+            void* p = mmap(nullptr, m_iSize, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED)
+            {
+                close(fd);
+                throw std::runtime_error("Unable to map log file " + path);
+            }
+            m_pData = static_cast<const char*>(p);
+            madvise(p, m_iSize, MADV_SEQUENTIAL);
+        }
+        close(fd);
+    }
+
+    ~MappedFile()
+    {
+        if (m_pData != nullptr)
+        {
+            munmap(const_cast<char*>(m_pData), m_iSize);
+        }
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const {return m_pData;}
+    std::size_t size() const {return m_iSize;}
+
+private:
+    const char* m_pData;
+    std::size_t m_iSize;
+};
+
+
+// Convert a binary log file to text, writing the output to os. If flags is not
+// empty, only records whose log-flag appears in flags are output.
+void convertFile(const std::string& path, std::ostream& os, const std::string& flags)
+{
+    MappedFile file(path);
+
+    std::size_t pos = BinaryLogSchema::readHeader(file.data(), file.size());
+
+    std::string buf;
+    while (pos < file.size())
+    {
+        BinaryChunkReader reader(file.data() + pos, file.size() - pos);
+
+        if (flags.empty() || (flags.find(reader.getTag()) != std::string::npos))
+        {
+            std::unique_ptr<LogSnapshot> pSnapshot = LogSnapshot::readBinary(reader);
+            buf.clear();
+            pSnapshot->write(buf);
+            os.write(buf.data(), buf.size());
+        }
+
+        pos += reader.getChunkSize();
+    }
+}
+
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        std::string outfile;
+        std::string flags;
+        std::vector<std::string> infiles;
+
+        po::options_description generic("Allowed options");
+        generic.add_options()
+            ("version,v", "display program version number")
+            ("help,h", "display this help message")
+            ("output,o", po::value<std::string>(&outfile), "write output to the specified file instead of stdout")
+            ("flags,f", po::value<std::string>(&flags), "only output records with the specified log-flags (e.g. \"Qf\")");
+
+        po::options_description hidden("Hidden options");
+        hidden.add_options()
+            ("input-file", po::value<std::vector<std::string>>(&infiles), "binary log file");
+
+        po::options_description cmdline_options;
+        cmdline_options.add(generic).add(hidden);
+
+        po::positional_options_description p;
+        p.add("input-file", -1);
+
+        po::variables_map vm;
+        store(po::command_line_parser(argc, argv).options(cmdline_options).positional(p).run(), vm);
+        notify(vm);
+
+        if (vm.count("help") || infiles.empty())
+        {
+            std::cout << "Usage: evobee-logcat [options] LOGFILE..." << std::endl
+                      << "Convert EvoBee binary log files to the standard text log format" << std::endl
+                      << generic << std::endl;
+            return vm.count("help") ? 0 : 1;
+        }
+
+        if (vm.count("version"))
+        {
+            std::cout << "evobee-logcat version " << evobee_VERSION_MAJOR << "." << evobee_VERSION_MINOR << "."
+                 << evobee_VERSION_PATCH << "." << evobee_VERSION_TWEAK << std::endl;
+            return 0;
+        }
+
+        std::vector<char> streamBuffer(1 << 20);
+        std::ofstream ofs;
+        if (!outfile.empty())
+        {
+            ofs.rdbuf()->pubsetbuf(streamBuffer.data(), streamBuffer.size());
+            ofs.open(outfile, std::ofstream::binary);
+            if (!ofs)
+            {
+                std::cerr << "Unable to open output file " << outfile << " for writing" << std::endl;
+                return 1;
+            }
+        }
+        else
+        {
+            std::ios::sync_with_stdio(false);
+        }
+        std::ostream& os = outfile.empty() ? std::cout : ofs;
+
+        for (const std::string& infile : infiles)
+        {
+            convertFile(infile, os, flags);
+        }
+
+        os.flush();
+        if (!os)
+        {
+            std::cerr << "Error writing output" << std::endl;
+            return 1;
+        }
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "evobee-logcat: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
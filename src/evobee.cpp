@@ -25,6 +25,13 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <filesystem>
+#include <unistd.h>
+#include <sys/wait.h>
 #include <boost/program_options.hpp>
 #include <nlohmann/json.hpp>
 #include "evobeeConfig.h"
@@ -45,7 +52,10 @@ using json = nlohmann::json;
 // forward declaration of functions in this file
 void processConfigOptions(int argc, char **argv);
 void processJsonFile(std::ifstream& ifs);
+void processJsonParams();
 void extractVisDataFromPollinatorConfig(const json& j, PollinatorConfig& p);
+int runReplicates();
+int runBranches();
 
 
 std::string strCurrentJsonSubSctName;
@@ -340,6 +350,17 @@ int main(int argc, char **argv)
     try
     {
         processConfigOptions(argc, argv);
+
+        if (ModelParams::getNumReplicates() > 1)
+        {
+            return runReplicates();
+        }
+
+        if (ModelParams::branching())
+        {
+            return runBranches();
+        }
+
         EvoBeeModel::seedRng();
         ModelParams::postprocess();
         ModelParams::checkConsistency();
@@ -364,6 +385,11 @@ void processConfigOptions(int argc, char **argv)
     {
         std::string config_file;
         unsigned int iTestNum = 0;
+        unsigned int iNumReplicates = 1;
+        unsigned int iNumReplicateWorkers = 1;
+        std::string resume_file;
+        int iBranchAtGen = 0;
+        std::string branches_file;
 
         // Declare a group of options that will be allowed only on command line
         po::options_description generic("Generic options");
@@ -372,7 +398,12 @@ void processConfigOptions(int argc, char **argv)
             ("help,h", "display this help message")
             ("config,c", po::value<std::string>(&config_file)->default_value("evobee.cfg.json"), "configuration file")
             ("quiet,q", "disable verbose progress messages on stdout")
-            ("test,t", po::value<unsigned int>(&iTestNum)->default_value(0), "Perform test number N instead of regular run");
+            ("test,t", po::value<unsigned int>(&iTestNum)->default_value(0), "Perform test number N instead of regular run")
+            ("replicates,r", po::value<unsigned int>(&iNumReplicates)->default_value(1), "Perform N independent replicate runs of the configuration")
+            ("threads,j", po::value<unsigned int>(&iNumReplicateWorkers)->default_value(1), "Perform up to N replicate or branch runs concurrently")
+            ("resume", po::value<std::string>(&resume_file), "Continue a run from the specified checkpoint file")
+            ("branch-at-gen", po::value<int>(&iBranchAtGen), "Run generations before G once, then run each branch from generation G")
+            ("branches", po::value<std::string>(&branches_file), "File of config overrides for each branch (used with --branch-at-gen)");
 
         po::options_description cmdline_options;
         cmdline_options.add(generic);
@@ -420,6 +451,36 @@ void processConfigOptions(int argc, char **argv)
             ModelParams::setTestNumber(iTestNum);
         }
 
+        ModelParams::setNumReplicates(iNumReplicates);
+        ModelParams::setNumReplicateWorkers(iNumReplicateWorkers);
+
+        if (!resume_file.empty())
+        {
+            if (iNumReplicates > 1)
+            {
+                std::cerr << "The --resume option cannot be used together with --replicates" << std::endl;
+                exit(1);
+            }
+            ModelParams::setResumeCheckpointFile(resume_file);
+        }
+
+        if (vm.count("branch-at-gen") || vm.count("branches"))
+        {
+            if ((iBranchAtGen < 1) || branches_file.empty())
+            {
+                std::cerr << "The --branch-at-gen option requires a value of at least 1, "
+                          << "and must be used together with --branches" << std::endl;
+                exit(1);
+            }
+            if ((iNumReplicates > 1) || !resume_file.empty())
+            {
+                std::cerr << "The --branch-at-gen option cannot be used together with --replicates or --resume" << std::endl;
+                exit(1);
+            }
+            ModelParams::setBranchAtGen(iBranchAtGen);
+            ModelParams::setBranchesFile(branches_file);
+        }
+
         // process the contents of the configuration file
         processJsonFile(ifs);
 
@@ -444,8 +505,6 @@ void processConfigOptions(int argc, char **argv)
 
 void processJsonFile(std::ifstream& ifs)
 {
-    bool verbose = ModelParams::verbose();
-
     json& j = ModelParams::getJson();
 
     try
@@ -463,6 +522,18 @@ void processJsonFile(std::ifstream& ifs)
         exit(1);
     }
 
+    processJsonParams();
+}
+
+
+// Set the parameters in ModelParams from the JSON configuration held in
+// ModelParams::getJson()
+void processJsonParams()
+{
+    bool verbose = ModelParams::verbose();
+
+    json& j = ModelParams::getJson();
+
     try
     {
         auto itSP = j.find("SimulationParams");
@@ -504,6 +575,30 @@ void processJsonFile(std::ifstream& ifs)
                     }
                     ModelParams::setRngSeedStr(it.value());
                 }
+                else if (it.key() == "rng-type" && it.value().is_string()) {
+                    if (verbose) {
+                        std::cout << "RNG type -> '" << it.value() << "'" << std::endl;
+                    }
+                    ModelParams::setRngType(it.value());
+                }
+                else if (it.key() == "pollinator-step-threads" && it.value().is_number_integer()) {
+                    if (verbose) {
+                        std::cout << "Pollinator step threads -> '" << it.value() << "'" << std::endl;
+                    }
+                    ModelParams::setPollinatorStepThreads(it.value());
+                }
+                else if (it.key() == "pollinator-fast-forward" && it.value().is_boolean()) {
+                    if (verbose) {
+                        std::cout << "Pollinator fast-forward -> '" << it.value() << "'" << std::endl;
+                    }
+                    ModelParams::setPollinatorFastForward(it.value());
+                }
+                else if (it.key() == "checkpoint-period" && it.value().is_number_integer()) {
+                    if (verbose) {
+                        std::cout << "Checkpoint period -> '" << it.value() << "'" << std::endl;
+                    }
+                    ModelParams::setCheckpointPeriod(it.value());
+                }
                 else if (it.key() == "logging" && it.value().is_boolean()) {
                     if (verbose) {
                         std::cout << "Logging -> '" << it.value() << "'" << std::endl;
@@ -552,6 +647,12 @@ void processJsonFile(std::ifstream& ifs)
                     }
                     ModelParams::setLogThreads(it.value());
                 }
+                else if (it.key() == "log-format" && it.value().is_string()) {
+                    if (verbose) {
+                        std::cout << "Log format -> '" << it.value() << "'" << std::endl;
+                    }
+                    ModelParams::setLogFormat(it.value());
+                }
                 else if (it.key() == "verbose" && it.value().is_boolean()) {
                     if (verbose) {
                         std::cout << "Verbose -> " << it.value() << std::endl;
@@ -840,4 +941,386 @@ void processJsonFile(std::ifstream& ifs)
         j.push_back(el);
     }
     */
-}
\ No newline at end of file
+}
+
+
+/**
+ * Run the function fn in a child process forked from this one, so it starts
+ * with its own copy of the fully initialised ModelParams (and of all other
+ * static model state). The child exits with status 0 if fn returns normally,
+ * or 1 if it throws an exception, in which case the exception message is
+ * reported on stderr prefixed with runDesc.
+ *
+ * Returns the pid of the child, or -1 if it could not be started.
+ */
+pid_t forkRun(const std::function<void()>& fn, const std::string& runDesc)
+{
+    // flush output streams so buffered output is not duplicated in the child
+    std::cout.flush();
+    std::cerr.flush();
+
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        std::cerr << "Unable to start " << runDesc << ". Aborting!" << std::endl;
+        return -1;
+    }
+    else if (pid == 0)
+    {
+        // in the child process, so perform the run
+        int exitCode = 0;
+        try
+        {
+            fn();
+        }
+        catch (std::exception &e)
+        {
+            std::cerr << runDesc << " aborting after problem encountered: " << e.what() << std::endl;
+            exitCode = 1;
+        }
+        std::cout.flush();
+        std::cerr.flush();
+        _exit(exitCode);
+    }
+
+    return pid;
+}
+
+
+/**
+ * Wait for any one child process started by forkRun() to finish. Returns false
+ * if there are no children left to wait for, otherwise true, with bSucceeded
+ * set according to whether the child completed successfully.
+ */
+bool waitForRun(bool& bSucceeded)
+{
+    int status = 0;
+    if (wait(&status) <= 0)
+    {
+        return false;
+    }
+    bSucceeded = (WIFEXITED(status) && (WEXITSTATUS(status) == 0));
+    return true;
+}
+
+
+/**
+ * Perform the number of replicate runs of the configuration requested with the
+ * --replicates option, running up to the number requested with the --threads
+ * option concurrently.
+ *
+ * The configuration file and visual data have already been read in by the time
+ * this is called. Each replicate is then run in a child process forked from
+ * this one, so it starts with its own copy of the fully initialised ModelParams
+ * (and of all other static model state) without having to parse anything again.
+ * Replicate i (counting from 1) uses the log run name <log-run-name>-rep<i>,
+ * and, if an rng-seed was specified, the seed string <rng-seed>R<i>; otherwise
+ * each replicate generates its own random seed.
+ *
+ * Returns 0 if all replicates completed successfully, or 1 otherwise.
+ */
+int runReplicates()
+{
+    const unsigned int numReplicates = ModelParams::getNumReplicates();
+    const unsigned int numWorkers = ModelParams::getNumReplicateWorkers();
+    const std::string baseSeed = ModelParams::getRngSeedStr();
+    const std::string baseRunName = ModelParams::getLogRunName();
+
+    if (ModelParams::getVisualisation())
+    {
+        std::cerr << "Warning: visualisation is not available when performing replicate runs, "
+                  << "so it will be turned off." << std::endl;
+        ModelParams::setVisualisation(false);
+    }
+
+    unsigned int numRunning = 0;
+    unsigned int numFailed = 0;
+
+    // wait for any one replicate to finish, and record whether it succeeded
+    auto waitForReplicate = [&numRunning, &numFailed]() {
+        bool bSucceeded = false;
+        if (waitForRun(bSucceeded))
+        {
+            --numRunning;
+            if (!bSucceeded)
+            {
+                ++numFailed;
+            }
+        }
+    };
+
+    for (unsigned int rep = 1; rep <= numReplicates; ++rep)
+    {
+        while (numRunning >= numWorkers)
+        {
+            waitForReplicate();
+        }
+
+        pid_t pid = forkRun([rep, &baseSeed, &baseRunName]() {
+                ModelParams::setLogRunName(baseRunName + "-rep" + std::to_string(rep));
+                ModelParams::getJson()["SimulationParams"]["log-run-name"] = ModelParams::getLogRunName();
+                if (!baseSeed.empty())
+                {
+                    ModelParams::setRngSeedStr(baseSeed + "R" + std::to_string(rep), true);
+                }
+
+                EvoBeeModel::seedRng();
+                ModelParams::postprocess();
+                ModelParams::checkConsistency();
+                EvoBeeExperiment expt;
+                expt.run();
+            },
+            "Replicate " + std::to_string(rep));
+
+        if (pid < 0)
+        {
+            ++numFailed;
+            break;
+        }
+
+        ++numRunning;
+    }
+
+    while (numRunning > 0)
+    {
+        waitForReplicate();
+    }
+
+    if (numFailed > 0)
+    {
+        std::cerr << numFailed << " of " << numReplicates << " replicates did not complete successfully" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Read the file of branch overrides specified with the --branches option. This
+ * must contain a JSON array with one entry per branch. Each entry is a JSON
+ * object with the same structure as the configuration file, holding just those
+ * parameters that are to be changed in that branch, and optionally a
+ * "branch-name" entry. The overrides are returned with the names removed, and
+ * the names are returned in branchNames (branches without a name are called
+ * branch<i>, where i counts from 1).
+ */
+std::vector<json> readBranchOverrides(std::vector<std::string>& branchNames)
+{
+    const std::string& path = ModelParams::getBranchesFile();
+    std::ifstream ifs(path);
+    if (!ifs)
+    {
+        throw std::runtime_error("Unable to open branches file " + path);
+    }
+
+    json branches;
+    try
+    {
+        ifs >> branches;
+    }
+    catch (json::exception &e)
+    {
+        throw std::runtime_error("Unable to parse branches file " + path + ": " + e.what());
+    }
+
+    if (!branches.is_array() || branches.empty())
+    {
+        throw std::runtime_error("Branches file " + path + " must contain a non-empty array of config overrides");
+    }
+
+    std::vector<json> overrides;
+    for (json& branch : branches)
+    {
+        if (!branch.is_object())
+        {
+            throw std::runtime_error("Each entry in branches file " + path + " must be a JSON object");
+        }
+
+        std::string name = "branch" + std::to_string(overrides.size() + 1);
+        auto itName = branch.find("branch-name");
+        if (itName != branch.end())
+        {
+            if (!itName->is_string() || itName->get<std::string>().empty() ||
+                (itName->get<std::string>().find('/') != std::string::npos))
+            {
+                throw std::runtime_error("Invalid branch-name in branches file " + path + ": " + itName->dump());
+            }
+            name = itName->get<std::string>();
+            branch.erase(itName);
+        }
+
+        if (std::find(branchNames.begin(), branchNames.end(), name) != branchNames.end())
+        {
+            throw std::runtime_error("Duplicate branch-name in branches file " + path + ": " + name);
+        }
+
+        branchNames.push_back(name);
+        overrides.push_back(branch);
+    }
+
+    return overrides;
+}
+
+
+/**
+ * Perform a branched experiment, as requested with the --branch-at-gen and
+ * --branches options.
+ *
+ * Generations 0 to G-1 (where G is the --branch-at-gen value) form a prefix
+ * that is shared by all branches. This is run once, in a child process, using
+ * the configuration as it was read in, and its logs are written under the
+ * configured log-dir and log-run-name. A checkpoint is saved at the end of
+ * generation G-1.
+ *
+ * Each branch is then run in its own child process forked from this one, which
+ * has not been altered by running the prefix. The child applies the branch's
+ * overrides to the JSON configuration (as a JSON merge patch, so only the
+ * parameters mentioned in the overrides are changed), processes the modified
+ * configuration again from scratch, and continues from generation G by resuming
+ * from the prefix's checkpoint. Branch i (counting from 1) named <name> writes
+ * its logs to <log-dir>/<name> using the run name <log-run-name>-<name>, and,
+ * if an rng-seed was specified, uses the seed string <rng-seed>B<i>; otherwise
+ * each branch generates its own random seed. Up to the number of branches
+ * requested with the --threads option are run concurrently.
+ *
+ * Branches may only change parameters that do not alter the structure of the
+ * model stored in the checkpoint (e.g. the number of pollinators, plant types
+ * or patches); an attempt to do so causes that branch to fail when it tries to
+ * resume from the checkpoint.
+ *
+ * Returns 0 if the prefix and all branches completed successfully, or 1 otherwise.
+ */
+int runBranches()
+{
+    const int branchGen = ModelParams::getBranchAtGen();
+    const unsigned int numWorkers = ModelParams::getNumReplicateWorkers();
+
+    std::vector<std::string> branchNames;
+    const std::vector<json> overrides = readBranchOverrides(branchNames);
+    const unsigned int numBranches = overrides.size();
+
+    if (branchGen >= ModelParams::getSimTerminationNumGens())
+    {
+        std::cerr << "The --branch-at-gen value (" << branchGen << ") must be less than sim-termination-num-gens ("
+                  << ModelParams::getSimTerminationNumGens() << ")" << std::endl;
+        return 1;
+    }
+
+    if (ModelParams::getVisualisation())
+    {
+        std::cerr << "Warning: visualisation is not available when performing branched runs, "
+                  << "so it will be turned off." << std::endl;
+        ModelParams::setVisualisation(false);
+        ModelParams::getJson()["SimulationParams"]["visualisation"] = false;
+    }
+
+    // run the shared prefix, saving a checkpoint at its end
+    const std::string checkpointPath = EvoBeeExperiment::getCheckpointPath(branchGen - 1);
+
+    pid_t pid = forkRun([branchGen]() {
+            ModelParams::setSimTerminationNumGens(branchGen);
+            ModelParams::getJson()["SimulationParams"]["sim-termination-num-gens"] = branchGen;
+            ModelParams::setCheckpointPeriod(branchGen);
+
+            EvoBeeModel::seedRng();
+            ModelParams::postprocess();
+            ModelParams::checkConsistency();
+            EvoBeeExperiment expt;
+            expt.run();
+        },
+        "Shared prefix of branched run");
+
+    bool bSucceeded = false;
+    if ((pid < 0) || !waitForRun(bSucceeded) || !bSucceeded)
+    {
+        std::cerr << "Shared prefix of branched run did not complete successfully" << std::endl;
+        return 1;
+    }
+
+    // now run each of the branches from the prefix's checkpoint
+    unsigned int numRunning = 0;
+    unsigned int numFailed = 0;
+
+    auto waitForBranch = [&numRunning, &numFailed]() {
+        bool bSucceeded = false;
+        if (waitForRun(bSucceeded))
+        {
+            --numRunning;
+            if (!bSucceeded)
+            {
+                ++numFailed;
+            }
+        }
+    };
+
+    for (unsigned int branch = 1; branch <= numBranches; ++branch)
+    {
+        while (numRunning >= numWorkers)
+        {
+            waitForBranch();
+        }
+
+        const std::string& name = branchNames[branch-1];
+        const json& branchOverrides = overrides[branch-1];
+
+        pid_t pid = forkRun([branch, &name, &branchOverrides, &checkpointPath]() {
+                json& j = ModelParams::getJson();
+                j.merge_patch(branchOverrides);
+                ModelParams::clearConfigSections();
+                processJsonParams();
+                if (ModelParams::commandLineQuiet())
+                {
+                    ModelParams::setVerbose(false);
+                }
+
+                std::filesystem::path logDir {ModelParams::getLogDir()};
+                ModelParams::setLogDir((logDir / name).string());
+                j["SimulationParams"]["log-dir"] = ModelParams::getLogDir();
+                if (ModelParams::logFinalDirSet())
+                {
+                    std::filesystem::path logFinalDir {ModelParams::getLogFinalDir()};
+                    ModelParams::setLogFinalDir((logFinalDir / name).string());
+                    j["SimulationParams"]["log-final-dir"] = ModelParams::getLogFinalDir();
+                }
+                ModelParams::setLogRunName(ModelParams::getLogRunName() + "-" + name);
+                j["SimulationParams"]["log-run-name"] = ModelParams::getLogRunName();
+
+                if (!ModelParams::getRngSeedStr().empty())
+                {
+                    ModelParams::setRngSeedStr(ModelParams::getRngSeedStr() + "B" + std::to_string(branch), true);
+                }
+
+                ModelParams::setBranchNumber(branch);
+                ModelParams::setResumeCheckpointFile(checkpointPath);
+
+                EvoBeeModel::seedRng();
+                ModelParams::postprocess();
+                ModelParams::checkConsistency();
+                EvoBeeExperiment expt;
+                expt.run();
+            },
+            "Branch " + name);
+
+        if (pid < 0)
+        {
+            ++numFailed;
+            break;
+        }
+
+        ++numRunning;
+    }
+
+    while (numRunning > 0)
+    {
+        waitForBranch();
+    }
+
+    if (numFailed > 0)
+    {
+        std::cerr << numFailed << " of " << numBranches << " branches did not complete successfully" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}